@@ -0,0 +1,109 @@
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <jansson.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "frame.h"
+
+/**
+ * Protocollo binario compatto, scelto dal client al login con {"username": ..., "protocol": "binary"}.
+ * Usa lo stesso prefisso di lunghezza dei messaggi json: il primo byte del messaggio è il codice del messaggio,
+ * sempre minore di BINARY_OPCODE_LIMIT, mentre un json inizia con { o con uno spazio. Gli interi sono in network byte order.
+ *
+ *  BINARY_MOVE         client -> server   [codice][game_id u64][x u8][y u8]
+ *  BINARY_MOVE_ERROR   server -> client   [codice][errore u8][game_id u64]
+ *  BINARY_GAME_UPDATE  server -> client   [codice][flag u8][game_id u64][state u8][turn u8][winner u8][x_mask u16][o_mask u16]
+ *  BINARY_LOBBY_EVENT  server -> client   [codice][evento u8][game_id u64][state u8][len u8][player1][len u8][player2]
+ *
+ * La board è data dalle bitboard x_mask e o_mask (bit x * 3 + y), turn e winner da BINARY_PLAYER_*.
+ * Tutti gli altri messaggi restano in json anche per i client che hanno scelto il protocollo binario.
+ */
+#define BINARY_OPCODE_LIMIT 0x09        // Primo spazio ammesso all'inizio di un json
+#define BINARY_REQUEST_MAX 16           // Lunghezza massima di una richiesta binaria del client
+
+#define BINARY_MOVE 0x01
+#define BINARY_MOVE_ERROR 0x02
+#define BINARY_GAME_UPDATE 0x03
+#define BINARY_LOBBY_EVENT 0x04
+
+#define BINARY_MOVE_LEN 11
+#define BINARY_MOVE_ERROR_LEN 10
+#define BINARY_GAME_UPDATE_LEN 17
+
+#define BINARY_UPDATE_OWN_MOVE 0x01     // Flag: risposta alla mossa del destinatario, altrimenti mossa dell'avversario
+
+#define BINARY_PLAYER_NONE 0
+#define BINARY_PLAYER1 1
+#define BINARY_PLAYER2 2
+
+#define BINARY_STATE_UNKNOWN 0xFF       // Stato degli eventi che riportano solo l'id della partita
+
+/**
+ * Errori di BINARY_MOVE_ERROR: i primi quattro corrispondono ai codici di make_move cambiati di segno
+ */
+typedef enum {
+    BINARY_ERROR_NOT_ONGOING = 1,
+    BINARY_ERROR_NOT_YOUR_TURN = 2,
+    BINARY_ERROR_CELL_TAKEN = 3,
+    BINARY_ERROR_INVALID_CELL = 4,
+    BINARY_ERROR_GAME_NOT_FOUND = 5,
+    BINARY_ERROR_SERVER = 6
+} binary_move_error_t;
+
+/**
+ * Eventi di BINARY_LOBBY_EVENT, corrispondenti agli eventi broadcast json con lo stesso nome
+ */
+typedef enum {
+    BINARY_EVENT_NEW_GAME_AVAILABLE = 1,
+    BINARY_EVENT_GAME_NOT_AVAILABLE = 2,
+    BINARY_EVENT_GAME_ENDED = 3,
+    BINARY_EVENT_GAME_REMOVED = 4
+} binary_event_t;
+
+typedef struct {
+    size_t game_id;
+    int x;
+    int y;
+} binary_move_t;
+
+/**
+ * Verifica se il messaggio ricevuto o da inviare è in formato binario.
+ * Ritorna true se il primo byte è un codice del protocollo binario, false se il messaggio è un json
+ */
+bool binary_is_message(const char* payload, size_t len);
+
+/**
+ * Decodifica una richiesta BINARY_MOVE.
+ * Ritorna true se il messaggio è una mossa ben formata, false altrimenti
+ */
+bool binary_decode_move(const char* payload, size_t len, binary_move_t* move);
+
+/**
+ * Crea il frame BINARY_MOVE_ERROR per la mossa rifiutata sulla partita game_id.
+ * Ritorna il frame, NULL in caso di errore
+ */
+frame_t* binary_move_error(size_t game_id, binary_move_error_t error);
+
+/**
+ * Crea il frame BINARY_GAME_UPDATE con lo stato della partita. own_move indica che il destinatario ha appena mosso.
+ * Da chiamare con il lock della partita acquisito. Ritorna il frame, NULL in caso di errore
+ */
+frame_t* binary_game_update(const game_t* game, bool own_move);
+
+/**
+ * Crea il frame BINARY_LOBBY_EVENT dell'evento broadcast event_type a partire dalla partita.
+ * Da chiamare con il lock della partita acquisito. Ritorna il frame, NULL se l'evento non ha una forma binaria o in caso di errore
+ */
+frame_t* binary_lobby_event(const char* event_type, const game_t* game);
+
+/**
+ * Crea il frame BINARY_LOBBY_EVENT dell'evento broadcast event_type a partire dal json della partita
+ * (o del solo game_id). Ritorna il frame, NULL se l'evento non ha una forma binaria o in caso di errore
+ */
+frame_t* binary_lobby_event_from_json(const char* event_type, const json_t* data);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include <stdint.h>
+
+#include "player.h"
+
+#define BOT_USERNAME "Bot"          // Username riservato all'avversario del server: nessun client può usarlo al login
+#define BOT_STATES 19683            // 3^9 board: la cella i (bit x * 3 + y) vale 0 se vuota, 1 se X, 2 se O, con peso 3^i
+
+// Esito per il giocatore al tratto della mossa in ogni cella, 2 bit per cella (bit 2 * i) in bot_outcomes
+#define BOT_OUTCOME_NONE 0          // Cella occupata o posizione finale
+#define BOT_OUTCOME_LOSS 1
+#define BOT_OUTCOME_DRAW 2
+#define BOT_OUTCOME_WIN 3
+
+/**
+ * Livello del bot: BOT_HARD gioca sempre la mossa migliore, gli altri livelli scelgono a caso tra le mosse
+ * con l'esito migliore e, con una probabilità che cresce al diminuire del livello, tra quelle con un esito peggiore
+ */
+typedef enum {
+    BOT_NONE,                       // Avversario umano
+    BOT_EASY,
+    BOT_MEDIUM,
+    BOT_HARD
+} bot_level_t;
+
+/**
+ * Tabelle generate durante la compilazione da tools/bot_table_gen.c, che risolve tutte le posizioni del tris.
+ * L'indice di una posizione è bot_ternary[x_mask] + 2 * bot_ternary[o_mask]; bot_best contiene la mossa
+ * che vince il prima possibile (o perde il più tardi possibile) per il giocatore al tratto
+ */
+extern const uint16_t bot_ternary[512];
+extern const uint32_t bot_outcomes[BOT_STATES];
+extern const uint8_t bot_best[BOT_STATES];
+
+/**
+ * Registra l'username del bot, così che le partite contro il bot abbiano un player2
+ */
+void bot_init(void);
+
+/**
+ * Ritorna l'id del bot nel registro dei giocatori
+ */
+player_id_t bot_player(void);
+
+/**
+ * Converte il nome del livello ("easy", "medium", "hard") nel livello corrispondente, BOT_HARD se name è NULL.
+ * Ritorna il livello, BOT_NONE se il nome non è valido
+ */
+bot_level_t bot_level_from_string(const char* name);
+
+/**
+ * Sceglie la mossa del bot nella posizione indicata con una sola lettura delle tabelle, senza ricerca.
+ * Ritorna la cella scelta (x * 3 + y), -1 se non ci sono mosse
+ */
+int bot_choose_move(uint16_t x_mask, uint16_t o_mask, bot_level_t level);
+
+#endif
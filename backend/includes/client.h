@@ -1,65 +1,111 @@
-#ifndef CLIENT_H
-#define CLIENT_H
-
-#include <pthread.h>
-#include <stdbool.h>
-#include <server.h>
-
-typedef struct {
-    ssize_t socket;
-    char username[64];
-} client_t;
-
-typedef struct client_node {
-    client_t client;
-    struct client_node* next;
-} client_node_t;
-
-typedef struct {
-    client_node_t* head;
-    size_t count;
-} client_list_t;
-
-extern client_list_t* connected_clients;
-
-/**
- * Inizializza le strutture utili per gestire i client connessi
- */
-void client_init(server_t* server);
-
-/**
- * Libera la memoria allocata per gestire i client connessi 
- */
-void client_cleanup(server_t* server);
-
-/**
- * Aggiunge un client alla lista di client connessi al server
- * Ritorna true se il client è stato aggiunto correttamente, false altrimenti
- */
-bool client_add(server_t* server, const client_t* client);
-
-/**
- * Rimuove il client dalla lista di client connessi.
- * Ritorna verso se il client è stato rimosso, false altrimenti
- */
-bool client_remove(server_t* server, const ssize_t sock);
-
-/**
- * Cerca la in numero di socket del client in base all'username (univoco) del player. 
- * Ritorna il numero della socket a cui è connesso il client se il player esiste, -1 altrimenti 
- */
-ssize_t find_client_by_username(server_t* server, const char* username);
-
-/**
- * Cerca l'username (univoco) del player in base al numero di socket. 
- * Ritorna il numero l'username del player se esiste, NULL altrimenti 
- */
-const char* find_username_by_client(server_t* server, const ssize_t sock);
-
-/**
- * Verifica se l'username è univoco. 
- * Ritorna vero se l'username è univoco, false altrimenti
- */
-bool is_username_unique(server_t* server, const char* username);
-
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <server.h>
+
+#include "player.h"
+
+/**
+ * Formato dei messaggi scelto dal client al login: json per tutti i messaggi, oppure binario compatto
+ * (vedi binary.h) per mosse, aggiornamenti della partita ed eventi della lobby
+ */
+typedef enum {
+    PROTOCOL_JSON,
+    PROTOCOL_BINARY
+} client_protocol_t;
+
+typedef struct {
+    ssize_t socket;
+    char username[64];
+    player_id_t player;             // Id dell'username nel registro dei giocatori, usato dalle partite
+    client_protocol_t protocol;
+    bool delta_updates;             // Aggiornamenti della partita incrementali (solo json) invece dello stato completo
+} client_t;
+
+#define CLIENT_INDEX_MIN_BUCKETS 64
+#define CLIENT_SLAB_CHUNK 64
+
+typedef struct client_node {
+    client_t client;
+    struct client_node* next;
+    struct client_node* prev;
+    struct client_node* next_by_username;   // Catena del bucket nell'indice per username
+    struct client_node* next_by_socket;     // Catena del bucket nell'indice per socket
+} client_node_t;
+
+/**
+ * Lista dei client connessi con due indici hash (username -> client e socket -> client)
+ * mantenuti insieme alla lista, così che le ricerche non debbano scorrerla.
+ * Il numero di bucket è una potenza di 2 e raddoppia quando i client superano i bucket.
+ */
+typedef struct {
+    client_node_t* head;
+    size_t count;
+    client_node_t** by_username;
+    client_node_t** by_socket;
+    size_t buckets;
+} client_list_t;
+
+extern client_list_t* connected_clients;
+
+/**
+ * Inizializza le strutture utili per gestire i client connessi
+ */
+void client_init(server_t* server);
+
+/**
+ * Libera la memoria allocata per gestire i client connessi 
+ */
+void client_cleanup(server_t* server);
+
+/**
+ * Aggiunge il client connesso alla socket sock con l'username e il formato dei messaggi indicati alla lista di client connessi al server.
+ * delta_updates indica che il client riceve gli aggiornamenti della partita in forma incrementale
+ * Ritorna true se il client è stato aggiunto correttamente, false altrimenti
+ */
+bool client_add(server_t* server, const ssize_t sock, const char* username, client_protocol_t protocol, bool delta_updates);
+
+/**
+ * Rimuove il client dalla lista di client connessi.
+ * Ritorna verso se il client è stato rimosso, false altrimenti
+ */
+bool client_remove(server_t* server, const ssize_t sock);
+
+/**
+ * Cerca la in numero di socket del client in base all'username (univoco) del player. 
+ * Ritorna il numero della socket a cui è connesso il client se il player esiste, -1 altrimenti 
+ */
+ssize_t find_client_by_username(server_t* server, const char* username);
+
+/**
+ * Cerca l'id del player in base al numero di socket.
+ * Ritorna l'id del player se esiste, PLAYER_NONE altrimenti
+ */
+player_id_t find_player_by_client(server_t* server, const ssize_t sock);
+
+/**
+ * Cerca il formato dei messaggi scelto dal client connesso alla socket sock.
+ * Ritorna il formato del client, PROTOCOL_JSON se il client non ha ancora effettuato il login
+ */
+client_protocol_t find_protocol_by_client(server_t* server, const ssize_t sock);
+
+/**
+ * Verifica se l'username è univoco. 
+ * Ritorna vero se l'username è univoco, false altrimenti
+ */
+bool is_username_unique(server_t* server, const char* username);
+
+/**
+ * Cerca il client connesso con l'username indicato. Da chiamare con clients_mutex acquisito.
+ * Ritorna il client se esiste, NULL altrimenti
+ */
+client_t* client_lookup_username(const char* username);
+
+/**
+ * Hash FNV-1a dell'username
+ */
+size_t username_hash(const char* username);
+
 #endif
\ No newline at end of file
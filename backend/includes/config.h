@@ -0,0 +1,26 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdbool.h>
+#include <server.h>
+
+/**
+ * Imposta un'opzione di configurazione del server a partire dal nome (senza "--") e dal valore testuale.
+ * Ritorna true se l'opzione esiste e il valore è valido, false altrimenti
+ */
+bool config_set(server_t* server, const char* key, const char* value);
+
+/**
+ * Legge un file di configurazione composto da righe "chiave = valore"; le righe vuote e quelle che iniziano con # vengono ignorate.
+ * Ritorna true se tutte le opzioni sono valide, false altrimenti
+ */
+bool config_load_file(server_t* server, const char* path);
+
+/**
+ * Legge le opzioni da riga di comando nella forma "--chiave valore". L'opzione --config carica un file
+ * di configurazione: le opzioni che la seguono sulla riga di comando hanno la precedenza.
+ * Ritorna true se le opzioni sono valide, false altrimenti
+ */
+bool config_load_args(server_t* server, int argc, char* argv[]);
+
+#endif
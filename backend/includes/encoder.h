@@ -0,0 +1,46 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Scrittura diretta di json compatto in un buffer fornito dal chiamante, senza costruire l'albero jansson.
+ * Stringhe e numeri vengono scritti esattamente come li serializza json_dumps con JSON_COMPACT.
+ * Se il buffer non basta overflow diventa true e le scritture successive vengono ignorate.
+ */
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    bool overflow;
+} encoder_t;
+
+/**
+ * Prepara l'encoder a scrivere nel buffer data di capacity byte
+ */
+void encoder_init(encoder_t* encoder, char* data, size_t capacity);
+
+/**
+ * Scrive length byte così come sono, ad esempio chiavi e punteggiatura o json già serializzato
+ */
+void encoder_raw(encoder_t* encoder, const char* bytes, size_t length);
+
+/**
+ * Scrive un intero in notazione decimale
+ */
+void encoder_integer(encoder_t* encoder, long long value);
+
+/**
+ * Scrive text come stringa json tra virgolette, con gli stessi escape di jansson.
+ * Ritorna false senza scrivere nulla se text non è UTF-8 valido (json_string ritornerebbe NULL), true altrimenti
+ */
+bool encoder_string(encoder_t* encoder, const char* text);
+
+/**
+ * Scrive un campo stringa preceduto da key (chiave già racchiusa tra virgolette, con i due punti e l'eventuale virgola).
+ * Come json_object_set_new con un valore NULL, il campo viene omesso se text non è UTF-8 valido
+ */
+void encoder_string_field(encoder_t* encoder, const char* key, const char* text);
+
+#endif
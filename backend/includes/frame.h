@@ -0,0 +1,109 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <jansson.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define FRAME_HEADER_SIZE 4       // Byte di lunghezza che precedono ogni messaggio
+#define FRAME_READ_CHUNK 4096     // Spazio libero minimo offerto a ogni lettura
+#define FRAME_READER_SHRINK 65536 // Capacità oltre la quale il buffer di ricezione vuoto viene liberato
+
+/**
+ * Messaggio pronto per l'invio: 4 byte di lunghezza (network byte order) seguiti dal json serializzato.
+ * Il frame viene costruito una sola volta e condiviso tra tutti i destinatari tramite il contatore
+ * di riferimenti: l'ultimo frame_release libera la memoria.
+ */
+typedef struct {
+    atomic_size_t refs;
+    size_t length;                  // Lunghezza totale, prefisso compreso
+    char bytes[];
+} frame_t;
+
+/**
+ * Buffer di ricezione riutilizzabile di una connessione. Ogni lettura riempie lo spazio libero in coda
+ * e frame_reader_next estrae uno dopo l'altro i frame completi direttamente dal buffer, senza copiarli,
+ * così che più richieste arrivate con la stessa lettura vengano gestite subito.
+ * Il buffer cresce solo quando il frame in corso non ci sta per intero.
+ */
+typedef struct {
+    char* data;
+    size_t start;                   // Inizio del primo frame non ancora estratto
+    size_t length;                  // Byte ricevuti presenti nel buffer
+    size_t capacity;
+    size_t max_payload;             // Lunghezza massima accettata per un messaggio
+} frame_reader_t;
+
+/**
+ * Alloca un frame in grado di contenere fino a capacity byte di json, da scrivere a partire da frame_payload
+ * e da completare con frame_finish. Ritorna il frame con un riferimento, NULL in caso di errore
+ */
+frame_t* frame_alloc(size_t capacity);
+
+/**
+ * Completa un frame ottenuto da frame_alloc scrivendo il prefisso per un json di length byte
+ */
+void frame_finish(frame_t* frame, size_t length);
+
+/**
+ * Crea un frame a partire dal json già serializzato payload di length byte.
+ * Ritorna il frame con un riferimento, NULL in caso di errore
+ */
+frame_t* frame_create(const char* payload, size_t length);
+
+/**
+ * Crea un frame serializzando json con JSON_COMPACT.
+ * Ritorna il frame con un riferimento, NULL in caso di errore
+ */
+frame_t* frame_from_json(json_t* json);
+
+/**
+ * Acquisisce un riferimento al frame. Ritorna il frame stesso
+ */
+frame_t* frame_retain(frame_t* frame);
+
+/**
+ * Rilascia un riferimento al frame, liberandolo se era l'ultimo
+ */
+void frame_release(frame_t* frame);
+
+/**
+ * Ritorna il json serializzato contenuto nel frame, senza prefisso
+ */
+char* frame_payload(frame_t* frame);
+
+/**
+ * Ritorna la lunghezza del json serializzato contenuto nel frame, senza prefisso
+ */
+size_t frame_payload_length(const frame_t* frame);
+
+/**
+ * Inizializza un buffer di ricezione vuoto che accetta messaggi lunghi al più max_payload byte
+ */
+void frame_reader_init(frame_reader_t* reader, size_t max_payload);
+
+/**
+ * Prepara lo spazio libero per la lettura successiva, spostando in testa il frame incompleto e
+ * ingrandendo il buffer se il frame non ci sta per intero. I messaggi estratti in precedenza non sono più validi.
+ * Ritorna il puntatore allo spazio libero e ne scrive la dimensione in space, NULL in caso di errore di allocazione
+ */
+char* frame_reader_space(frame_reader_t* reader, size_t* space);
+
+/**
+ * Registra received byte letti nello spazio restituito da frame_reader_space
+ */
+void frame_reader_commit(frame_reader_t* reader, size_t received);
+
+/**
+ * Estrae il prossimo frame completo presente nel buffer, scrivendo in payload e payload_len il messaggio
+ * senza prefisso. Il messaggio resta valido fino alla successiva frame_reader_space.
+ * Ritorna 1 se un frame è stato estratto, 0 se servono altri dati, -1 se la lunghezza del frame non è valida
+ */
+int frame_reader_next(frame_reader_t* reader, const char** payload, size_t* payload_len);
+
+/**
+ * Libera la memoria del buffer di ricezione
+ */
+void frame_reader_free(frame_reader_t* reader);
+
+#endif
@@ -1,104 +1,253 @@
-#ifndef GAME_H
-#define GAME_H
-
-#include "jansson.h"
-#include "server.h"
-
-typedef enum {
-    GAME_WAITING,
-    GAME_ONGOING,
-    GAME_OVER
-} game_state_t;
-
-typedef struct {
-    size_t id;
-    char player1[64];
-    char player2[64];
-    char board[3][3];
-    char turn[64];
-    game_state_t state;
-    char winner[64];    //Vincitore oppure (game_state = GAME_OVER e winner vuoto ) se è pareggio
-    unsigned short int rematch;     // 1 = player 1 vuole la rivincita, 2 = player 2 vuole la rivincita, 3 = entrambi vogliono la rivincita, 0 altrimenti
-} game_t;
-
-typedef struct{
-    game_t* game;
-    server_t* server;
-    char username[64];
-}timeout_args_t;
-
-typedef struct game_node {
-    game_t game;
-    struct game_node* next;
-} game_node_t;
-
-typedef struct {
-    game_node_t* head;
-    size_t count;
-} game_list_t;
-
-extern game_list_t* game_list;
-
-/**
- * Inizializza le strutture utili per gestire le partite esistenti
- */
-void game_init(server_t* server);
-
-/**
- * Libera la memoria allocata per gestire le partite esistenti 
- */
-void game_cleanup(server_t* server);
-
-/**
- * Crea una nuova partita.
- * Ritorna l'id della partita creata, altrimenti -1 in caso di errore 
- */
-ssize_t create_game(server_t* server, const char* player1);
-
-/**
- * Invia al creatore della partita la richiesta di join da parte di un utente per una determinata partita.
- * Ritorna 0 se la richiesta è avvenuta con successo, -1 se game_id non è valido, -2 se la partita non è più disponibile
- */
-short request_join_game(server_t* server, size_t game_id, const char *player2);
-
-/**
- * Invia all'avversario la notifica che la partita è stata accettata e che sta per essere avviata.
- * Ritorna 0 se l'invio è avvenuto con successo, -1 se game_id non è valido, 
- * -2 se la partita non è più disponibile, -4 se l'avversario non è più disponibile
- */
-short accept_join_request(server_t* server, size_t game_id, const char* player2);
-
-/**
- * Metodo che gestisce la mossa, quindi, aggiorna lo stato della board, verifica se è stato fatto un tris e cambia il turno.
- * Ritorna 0 se la mossa è stata fatta con successo, -1 se la parita non è nello stato GAME_ONGOING
- */
-short make_move(server_t* server, game_t* game, const char *username, int x, int y);
-
-/**
- * Cerca una partita a partire dall'id.
- * Ritorna un oggetto di tipo game_t se la partita è stata trovata, NULL altrimenti
- */
-game_t* find_game_by_id(server_t* server,size_t game_id);
-
-/**
- * Serializza la struttura game_t in json
- */
-json_t* create_json(server_t* server, size_t id, bool already_locked);
-
-/**
- * Ritorna un json con tutte le partite create da un giocatore, altrimenti NULL
- */
-json_t* list_games(server_t* server, const char* username);
-
-
-/**
- * Gestione abbandono partita. Notifica il player in gioco che ha l'avversario ha abbandonato e dunque ha vinto la partita.
- * Ritorna 0 se lo stato della partita e l'invio della notifica vanno a buon fine, -1 se la partita non è in corso, -2 errore invio notifica
- */
-short quit(server_t* server, game_t* game, const char* username);
-
-/**
- * Rimuove tutte le partite associate ad un giocatore
- */
-void remove_games_by_username(server_t* server, const char* username, const size_t sock);
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "jansson.h"
+#include "server.h"
+#include "player.h"
+#include "bot.h"
+
+typedef enum {
+    GAME_WAITING,
+    GAME_ONGOING,
+    GAME_OVER
+} game_state_t;
+
+#define BOARD_SIZE 3
+#define BOARD_FULL_MASK 0x1FF
+#define BOARD_CELL(x, y) ((uint16_t)(1u << ((x) * BOARD_SIZE + (y))))
+/**
+ * Vincitore della partita: GAME_WINNER_NONE finché la partita è in corso o se è finita in pareggio
+ */
+typedef enum {
+    GAME_WINNER_NONE,
+    GAME_WINNER_PLAYER1,
+    GAME_WINNER_PLAYER2
+} game_winner_t;
+
+#define GAME_JSON_MAX 2048      // Json di una partita nel caso peggiore: quattro nomi da 63 byte con ogni carattere sostituito da \u00XX
+#define GAME_DELTA_MAX 512      // Json di un aggiornamento incrementale nel caso peggiore: il nome del vincitore con ogni carattere sostituito
+
+/**
+ * Stato di una partita. I giocatori sono id del registro (vedi player.h): i nomi vengono risolti solo
+ * durante la serializzazione, quindi la partita occupa meno di una linea di cache.
+ */
+typedef struct {
+    size_t id;
+    player_id_t player1;
+    player_id_t player2;            // PLAYER_NONE finché nessun avversario è stato accettato
+    uint32_t seq;                   // Mosse applicate alla partita: numera gli aggiornamenti incrementali
+    uint16_t x_mask;                // Bitboard delle celle occupate da X (player1): bit x * 3 + y
+    uint16_t o_mask;                // Bitboard delle celle occupate da O (player2)
+    game_state_t state;
+    uint8_t last_cell;              // Cella dell'ultima mossa (x * 3 + y), valida se seq > 0
+    uint8_t rematch;                // 1 = player 1 vuole la rivincita, 2 = player 2 vuole la rivincita, 3 = entrambi vogliono la rivincita, 0 altrimenti
+    unsigned int turn : 1;          // 0 = turno di player1, 1 = turno di player2
+    unsigned int winner : 2;        // game_winner_t
+    unsigned int bot : 2;           // bot_level_t: player2 è il bot del server, BOT_NONE se è un giocatore
+} game_t;
+
+_Static_assert(sizeof(game_t) <= 64, "game_t deve restare entro una linea di cache");
+
+/**
+ * Ritorna il giocatore di turno
+ */
+static inline player_id_t game_turn_player(const game_t* game) {
+    return game->turn ? game->player2 : game->player1;
+}
+
+/**
+ * Ritorna il vincitore della partita, PLAYER_NONE se la partita è in corso o è finita in pareggio
+ */
+static inline player_id_t game_winner_player(const game_t* game) {
+    switch (game->winner) {
+        case GAME_WINNER_PLAYER1: return game->player1;
+        case GAME_WINNER_PLAYER2: return game->player2;
+        default:                  return PLAYER_NONE;
+    }
+}
+
+typedef struct{
+    game_t* game;
+    server_t* server;
+    char username[64];
+}timeout_args_t;
+
+/**
+ * Posizione della tabella delle partite. La generazione viene incrementata ogni volta che la partita
+ * viene rimossa, così che il suo id non corrisponda più alla partita che riuserà lo slot.
+ * lock protegge lo stato della partita; in_use e generation vengono modificati solo tenendo sia
+ * games_mutex sia lock, quindi possono essere letti tenendo uno dei due o senza lock con game_get.
+ * Gli slot non vengono mai liberati: refs conta i riferimenti ottenuti con game_get, e lo slot di una partita
+ * rimossa torna tra i liberi solo quando nessuno ne possiede più uno (retired fino ad allora).
+ */
+typedef struct {
+    game_t game;                    // Primo campo: lo slot è recuperabile dalla partita
+    pthread_mutex_t lock;
+    atomic_uint generation;
+    atomic_bool in_use;
+    atomic_uint refs;
+    atomic_bool retired;            // Partita rimossa con riferimenti ancora attivi
+    size_t next_free;               // Prossimo slot libero, GAME_SLOT_NONE se è l'ultimo
+} game_slot_t;
+
+#define GAME_SLOT_NONE ((size_t)-1)
+#define PLAYER_INDEX_MIN_BUCKETS 64
+
+/**
+ * Partite create o giocate da un giocatore, nell'indice per giocatore della tabella
+ */
+typedef struct player_games {
+    player_id_t player;
+    size_t* ids;
+    size_t count;
+    size_t capacity;
+    struct player_games* next;      // Catena del bucket
+} player_games_t;
+
+/**
+ * Tabella densa delle partite, allocata una sola volta con max_games slot.
+ * L'id di una partita è generation * capacity + indice dello slot: la ricerca per id è O(1)
+ * e gli slot liberati vengono riusati senza allocare memoria.
+ */
+typedef struct {
+    game_slot_t* slots;
+    size_t capacity;
+    size_t count;                   // Partite presenti
+    size_t used;                    // Slot utilizzati almeno una volta: oltre questo indice sono tutti liberi
+    size_t free_head;               // Pila degli slot liberati
+    player_games_t** players;       // Indice giocatore -> partite del giocatore, protetto da games_mutex
+    size_t player_buckets;
+    size_t player_count;
+} game_table_t;
+
+extern game_table_t* game_table;
+
+/**
+ * Inizializza le strutture utili per gestire le partite esistenti
+ */
+void game_init(server_t* server);
+
+/**
+ * Libera la memoria allocata per gestire le partite esistenti 
+ */
+void game_cleanup(server_t* server);
+
+/**
+ * Crea una nuova partita.
+ * Ritorna l'id della partita creata, altrimenti -1 in caso di errore 
+ */
+ssize_t create_game(server_t* server, player_id_t player1);
+
+/**
+ * Invia al creatore della partita la richiesta di join da parte di un utente per una determinata partita.
+ * Ritorna 0 se la richiesta è avvenuta con successo, -1 se game_id non è valido, -2 se la partita non è più disponibile
+ */
+short request_join_game(server_t* server, size_t game_id, player_id_t player2);
+
+/**
+ * Invia all'avversario la notifica che la partita è stata accettata e che sta per essere avviata.
+ * Ritorna 0 se l'invio è avvenuto con successo, -1 se game_id non è valido, 
+ * -2 se la partita non è più disponibile, -3 in caso di errore interno, -4 se l'avversario non è più disponibile
+ */
+short accept_join_request(server_t* server, size_t game_id, const char* player2);
+
+/**
+ * Verifica se l'avversario è ancora disponibile per giocare la partita.
+ * already_locked indica che il chiamante possiede games_mutex; non deve possedere il lock di alcuna partita.
+ * Ritorna true se è ancora disponibile, false altrimenti
+ */
+bool is_opponent_available(server_t* server, player_id_t player2, bool already_locked);
+
+/**
+ * Crea una partita tra due giocatori abbinati dal matchmaking e la avvia subito, senza passare dallo stato di attesa:
+ * entrambi ricevono la notifica game_started. player1 (X) è il giocatore che attendeva e muove per primo.
+ * Ritorna l'id della partita, -1 se player1 si è disconnesso o è impegnato in un'altra partita,
+ * -2 se player2 è impegnato in un'altra partita, -3 se il server è pieno o in caso di errore interno
+ */
+ssize_t start_game(server_t* server, player_id_t player1, player_id_t player2);
+
+/**
+ * Crea una partita contro il bot del server con il livello indicato e la avvia subito: player1 (X) muove per primo,
+ * il bot risponde a ogni mossa con bot_move. Il bot non viene aggiunto all'indice per giocatore, così che possa
+ * giocare più partite contemporaneamente.
+ * Ritorna l'id della partita, -1 se il giocatore è impegnato in un'altra partita, -2 se il server è pieno o in caso di errore interno
+ */
+ssize_t create_bot_game(server_t* server, player_id_t player, bot_level_t level);
+
+/**
+ * Metodo che gestisce la mossa, quindi, aggiorna lo stato della board, verifica se è stato fatto un tris e cambia il turno.
+ * Ritorna 0 se la mossa è stata fatta con successo, -1 se la parita non è nello stato GAME_ONGOING,
+ * -2 se non è il turno del giocatore, -3 se la cella è già occupata, -4 se la cella non esiste
+ */
+short make_move(server_t* server, game_t* game, player_id_t player, int x, int y);
+
+/**
+ * Esegue la risposta del bot, letta dalla tabella delle mosse, se è il turno del bot nella partita.
+ * Ritorna 0 se il bot ha mosso, -1 se la partita non è contro il bot, non è in corso o non è il turno del bot
+ */
+short bot_move(server_t* server, game_t* game);
+
+/**
+ * Cerca una partita a partire dall'id senza acquisire lock e ne ottiene un riferimento, da rilasciare con game_put.
+ * Finché il riferimento è attivo lo slot non viene riusato: se la partita viene rimossa nel frattempo resta nello stato GAME_OVER.
+ * Ritorna la partita se è stata trovata, NULL altrimenti
+ */
+game_t* game_get(server_t* server, size_t game_id);
+
+/**
+ * Rilascia un riferimento ottenuto con game_get. Da chiamare senza games_mutex né il lock della partita acquisiti
+ */
+void game_put(server_t* server, game_t* game);
+
+/**
+ * Acquisisce il lock della singola partita. Vedi server_t per l'ordine di acquisizione dei lock
+ */
+void game_lock(game_t* game);
+
+/**
+ * Rilascia il lock della singola partita
+ */
+void game_unlock(game_t* game);
+
+/**
+ * Serializza la struttura game_t in json.
+ * already_locked indica che il chiamante possiede già il lock della partita
+ */
+json_t* create_json(server_t* server, size_t id, bool already_locked);
+
+/**
+ * Serializza la partita direttamente nel buffer riservato al thread chiamante, senza allocare memoria.
+ * Il risultato è identico a create_json serializzato con JSON_COMPACT. Da chiamare con il lock della partita acquisito.
+ * Ritorna il json, valido fino alla successiva chiamata dallo stesso thread, e ne scrive la lunghezza in len, NULL in caso di errore
+ */
+const char* game_encode(const game_t* game, size_t* len);
+
+/**
+ * Serializza l'ultima mossa della partita come aggiornamento incrementale nel buffer riservato al thread chiamante:
+ * {"game_id":id,"seq":seq,"x":x,"y":y,"mark":"X"}, seguito da "state" e "winner" se la mossa ha concluso la partita.
+ * Da chiamare con il lock della partita acquisito, dopo almeno una mossa.
+ * Ritorna il json, valido fino alla successiva chiamata dallo stesso thread, e ne scrive la lunghezza in len, NULL in caso di errore
+ */
+const char* game_encode_delta(const game_t* game, size_t* len);
+
+/**
+ * Serializza la partita insieme al numero di sequenza della sua ultima mossa, letti sotto lo stesso lock
+ * così che lo stato corrisponda a seq. Usato dai client con aggiornamenti incrementali per risincronizzarsi.
+ * Ritorna il json {"seq":seq,"game":partita}, NULL se la partita non esiste
+ */
+json_t* create_resync_json(server_t* server, size_t id);
+
+/**
+ * Gestione abbandono partita. Notifica il player in gioco che ha l'avversario ha abbandonato e dunque ha vinto la partita,
+ * dopo aver rilasciato il lock della partita.
+ * Ritorna 0 se lo stato della partita e l'invio della notifica vanno a buon fine, -1 se la partita non è in corso, -2 errore creazione notifica
+ */
+short quit(server_t* server, game_t* game, player_id_t player);
+
+/**
+ * Rimuove tutte le partite create da un giocatore
+ */
+void remove_games_by_player(server_t* server, player_id_t player, const size_t sock);
 #endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef LOBBY_H
+#define LOBBY_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <server.h>
+
+#include "game.h"
+
+/**
+ * Vista della lobby di una partita: il json compatto della partita, serializzato una sola volta
+ * a ogni cambio di stato e riusato da tutte le richieste list_games successive.
+ */
+typedef struct {
+    size_t game_id;
+    player_id_t owner;
+    char* json;
+    size_t json_len;
+} lobby_entry_t;
+
+/**
+ * Lobby mantenuta in modo incrementale alla creazione, all'avvio, alla fine e alla rimozione delle partite:
+ * le mosse non la aggiornano, quindi la griglia di una partita in corso è quella del suo avvio.
+ * Le viste sono contigue in entries; position associa a ogni slot della
+ * tabella delle partite la posizione della sua vista (GAME_SLOT_NONE se la partita non è in lobby).
+ * mutex è una foglia nell'ordine dei lock: mentre è acquisito non si acquisiscono altri lock.
+ */
+typedef struct {
+    lobby_entry_t* entries;
+    size_t count;
+    size_t* position;
+    size_t capacity;
+    size_t bytes;                   // Somma delle lunghezze delle viste
+    pthread_mutex_t mutex;
+} lobby_t;
+
+/**
+ * Inizializza la lobby per al più max_games partite
+ */
+void lobby_init(server_t* server);
+
+/**
+ * Libera la memoria allocata per la lobby
+ */
+void lobby_cleanup(void);
+
+/**
+ * Serializza la partita e ne aggiorna la vista nella lobby, aggiungendola se non è presente.
+ * Da chiamare con il lock della partita acquisito
+ */
+void lobby_update(game_t* game);
+
+/**
+ * Aggiorna la vista della partita nella lobby con il json encoded già serializzato dal chiamante,
+ * aggiungendola se non è presente. Da chiamare con il lock della partita acquisito
+ */
+void lobby_store(game_t* game, const char* encoded, size_t json_len);
+
+/**
+ * Rimuove dalla lobby la vista della partita game_id
+ */
+void lobby_remove(size_t game_id);
+
+/**
+ * Compone l'array json delle partite in lobby escluse quelle create da player, copiando le viste già serializzate.
+ * Ritorna la stringa allocata (da liberare con free) e ne scrive la lunghezza in len, NULL in caso di errore
+ */
+char* lobby_list(player_id_t player, size_t* len);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LOG_RECORD_SIZE 512             // Byte massimi di un messaggio, quelli in eccesso vengono troncati
+#define LOG_RING_SLOTS 128              // Messaggi in attesa per thread, potenza di due
+#define LOG_DRAIN_INTERVAL_MS 50        // Attesa massima del thread di scrittura tra due svuotamenti
+#define LOG_WRITE_BUFFER 65536          // Byte scritti al più con una sola write
+
+typedef enum {
+    LOG_LEVEL_ERROR,        // Solo gli errori
+    LOG_LEVEL_INFO,         // Errori ed eventi del server (default)
+    LOG_LEVEL_DEBUG         // Anche il contenuto di ogni messaggio inviato
+} log_level_t;
+
+typedef struct {
+    size_t length;
+    char text[LOG_RECORD_SIZE];
+} log_record_t;
+
+/**
+ * Buffer circolare dei messaggi di un thread: il thread proprietario scrive in head, il thread di scrittura
+ * legge da tail, quindi nessuno dei due acquisisce lock. Alla terminazione del thread il buffer viene
+ * rilasciato (owned = false) e può essere riusato da un nuovo thread, dopo che i messaggi rimasti sono stati scritti.
+ */
+typedef struct log_ring {
+    log_record_t records[LOG_RING_SLOTS];
+    atomic_size_t head;
+    atomic_size_t tail;
+    atomic_bool owned;
+    struct log_ring* next;
+} log_ring_t;
+
+/**
+ * Avvia il thread che scrive su standard output i messaggi accodati dagli altri thread.
+ * Prima di logger_init e dopo logger_cleanup i messaggi vengono scritti direttamente dal chiamante.
+ * Ritorna true se il thread è stato avviato, false altrimenti
+ */
+bool logger_init(log_level_t level);
+
+/**
+ * Scrive i messaggi rimasti, termina il thread di scrittura e libera i buffer dei thread.
+ * Da chiamare dopo la terminazione di tutti gli altri thread
+ */
+void logger_cleanup(void);
+
+/**
+ * Imposta il livello massimo dei messaggi scritti
+ */
+void logger_set_level(log_level_t level);
+
+/**
+ * Verifica se i messaggi del livello indicato vengono scritti.
+ * Ritorna true se il livello è abilitato, false altrimenti
+ */
+bool log_enabled(log_level_t level);
+
+/**
+ * Accoda un messaggio di errore di where (nella forma "modulo.funzione")
+ */
+void log_error(const char* where, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * Accoda un messaggio informativo di where (nella forma "modulo.funzione")
+ */
+void log_info(const char* where, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * Accoda un messaggio di debug di where (nella forma "modulo.funzione"), scritto solo con il livello LOG_LEVEL_DEBUG
+ */
+void log_debug(const char* where, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef MATCHMAKING_H
+#define MATCHMAKING_H
+
+#include <stdatomic.h>
+#include <server.h>
+
+#include "player.h"
+
+/**
+ * Abbinamento automatico dei giocatori (quick_match). Un abbinamento richiede al più un giocatore in attesa,
+ * quindi la coda si riduce a un solo slot atomico: chi arriva con lo slot vuoto vi si inserisce con una CAS,
+ * chi lo trova occupato lo svuota con una CAS e avvia la partita con il giocatore che attendeva.
+ * Nessun lock viene acquisito per l'abbinamento e due giocatori non possono restare in attesa contemporaneamente.
+ */
+typedef struct {
+    _Atomic(player_id_t) waiting;       // Giocatore in attesa di un avversario (con un riferimento al suo id), PLAYER_NONE se nessuno
+} matchmaking_t;
+
+/**
+ * Abbina il giocatore a quello in attesa e avvia subito la partita (vedi start_game), altrimenti lo mette in attesa.
+ * Ritorna 0 se la partita è stata avviata e ne scrive l'id in game_id, 1 se il giocatore è in attesa di un avversario,
+ * -1 se il giocatore è impegnato in un'altra partita, -2 se il server è pieno o in caso di errore interno
+ */
+short quick_match(server_t* server, player_id_t player, ssize_t* game_id);
+
+/**
+ * Toglie il giocatore dall'attesa, se vi si trova. Da chiamare alla disconnessione del client
+ */
+void matchmaking_cancel(player_id_t player);
+
+#endif
@@ -1,59 +1,162 @@
-#ifndef MESSAGES_H
-#define MESSAGES_H
-
-#include <jansson.h>
-#include <stdbool.h>
-#include <server.h>
-
-#include "game.h"
-
-#define MAX_JSON_SIZE 1048576  // 1 MB
-
-/**
- * Invia i dati di aggiornamento della partita. 
- * Il parametro username indica chi ha effettuato la mossa, dunque invia lo stato della 
- * partita aggiornata come risposta a quest'ultimo e all'avversario una richiesta allo 
- * scopo di aggiornare i dati che ha.
- * Ritorna true se il messaggio è stato inviato correttamente ad entrambi i giocatori, false altrimenti.
- */
-bool send_game_update(server_t* server, game_t* game, const char* username);
-
-/**
- * Invia un messaggio in broadcast a tutti i client connessi esclusi exclude_client1 e exclude_client2.
- * Ritorna ture se il messaggio è stato inviato a tutti i client connessi, false altrimenti.
- */
-bool send_broadcast(server_t* server, const char* event_type, json_t* data, const ssize_t exclude_client1, const ssize_t exclude_client2);
-
-/**
- * Invia un messaggio ad uno specifico player.
- * Ritorna true se il messaggio è stato inviato correttamente, false altrimenti.
- */
-bool send_to_player(server_t* server, json_t* json_data, const char* username, bool already_locked);
-
-/**
- * Invia un messaggio Json aggiungendo un delimitatore di fine (come \n) assicurandosi che l'intero messaggio venga inviato
- * anche se la rete o la connessione non permettono di inviarlo tutto in un'unica volta.
- * Ritorna ture se il messaggio è stato inviato correttamente, false altrimenti.
- */
-bool send_json_message(json_t* json_data, const size_t sock);
-
-/**
- * Crea una richiesta standard in formato json specificando il tipo di richiesta e una descrizione.
- * Ritorna la richiesta json il caso di corretta creazione, NULL altrimenti.
- */
-json_t* create_request(const char* request_type, const char* description, json_t* data);
-
-/**
- * Crea una risposta standard in formato json specificando il tipo di risposta e una descrizione.
- * Ritorna la risposta json il caso di corretta creazione, NULL altrimenti.
- */
-json_t* create_response(const char* response_type, bool status, const char* description, json_t* data);
-
-
-/**
- * Gestisce la ricezione di un messaggio. 
- * Il metodo si aspetta prima la lunghezza del messaggio e successivamente il messaggio.
- * Ritorna il file json se la ricezione è avvenuta correttamente, NULL altrimenti.
- */
-json_t* receive_json(const size_t socket);
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include <jansson.h>
+#include <stdbool.h>
+#include <server.h>
+
+#include "game.h"
+#include "frame.h"
+
+#define MAX_JSON_SIZE 1048576  // 1 MB
+#define OUTBOX_MAX 8            // Notifiche raccolte al più da una singola operazione su una partita
+
+/**
+ * Notifica raccolta in un outbox: un frame (o un json da serializzare all'invio) per un giocatore,
+ * per una socket oppure per tutti i client connessi esclusi exclude[0] e exclude[1]
+ */
+typedef struct {
+    frame_t* frame;
+    frame_t* binary;            // Frame dei broadcast per i client con protocollo binario, NULL se non previsto
+    json_t* json;               // Messaggio serializzato solo all'invio, se frame è NULL
+    char username[64];          // Destinatario cercato all'invio, vuoto se è indicata la socket
+    ssize_t sock;
+    ssize_t exclude[2];
+    bool broadcast;
+} outbox_entry_t;
+
+/**
+ * Notifiche prodotte da un'operazione su una partita. Vengono raccolte mentre i lock delle partite sono acquisiti
+ * e inviate con outbox_send dopo averli rilasciati, così che nessun lock di partita sia tenuto durante gli invii.
+ */
+typedef struct {
+    outbox_entry_t entries[OUTBOX_MAX];
+    size_t count;
+} outbox_t;
+
+/**
+ * Inizializza un outbox vuoto
+ */
+void outbox_init(outbox_t* outbox);
+
+/**
+ * Aggiunge all'outbox il frame per il giocatore username, la cui socket viene cercata all'invio.
+ * L'outbox diventa proprietario del riferimento al frame. Ritorna true se la notifica è stata aggiunta, false altrimenti
+ */
+bool outbox_frame_to_player(outbox_t* outbox, const char* username, frame_t* frame);
+
+/**
+ * Aggiunge all'outbox il messaggio json per il giocatore username, serializzato solo all'invio.
+ * L'outbox diventa proprietario del json. Ritorna true se la notifica è stata aggiunta, false altrimenti
+ */
+bool outbox_json_to_player(outbox_t* outbox, const char* username, json_t* json);
+
+/**
+ * Aggiunge all'outbox il frame per la socket sock.
+ * L'outbox diventa proprietario del riferimento al frame. Ritorna true se la notifica è stata aggiunta, false altrimenti
+ */
+bool outbox_frame_to_socket(outbox_t* outbox, const ssize_t sock, frame_t* frame);
+
+/**
+ * Aggiunge all'outbox il broadcast del frame json, o del frame binary ai client con protocollo binario se non è NULL,
+ * a tutti i client connessi esclusi exclude_client1 e exclude_client2. L'outbox diventa proprietario dei riferimenti ai frame.
+ * Ritorna true se la notifica è stata aggiunta, false altrimenti
+ */
+bool outbox_broadcast(outbox_t* outbox, frame_t* json, frame_t* binary, const ssize_t exclude_client1, const ssize_t exclude_client2);
+
+/**
+ * Invia le notifiche dell'outbox con una sola acquisizione di clients_mutex e lo svuota.
+ * Da chiamare senza games_mutex né lock di partita acquisiti.
+ * Ritorna true se tutte le notifiche sono state accodate, false altrimenti
+ */
+bool outbox_send(server_t* server, outbox_t* outbox);
+
+/**
+ * Crea il frame di un evento broadcast il cui campo data è il json già serializzato data di data_len byte.
+ * Ritorna il frame, NULL in caso di errore.
+ */
+frame_t* create_broadcast_frame(const char* event_type, const char* data, size_t data_len);
+
+/**
+ * Invia i dati di aggiornamento della partita. 
+ * Il parametro mover indica chi ha effettuato la mossa, dunque invia lo stato della 
+ * partita aggiornata come risposta a quest'ultimo e all'avversario una richiesta allo 
+ * scopo di aggiornare i dati che ha. I client con protocollo binario ricevono BINARY_GAME_UPDATE,
+ * quelli con aggiornamenti incrementali la sola mossa (vedi game_encode_delta) al posto dell'intera partita.
+ * I frame vengono composti con il lock della partita e inviati dopo averlo rilasciato.
+ * Se la mossa ha concluso la partita ne aggiorna anche la vista nella lobby.
+ * Ritorna true se il messaggio è stato inviato correttamente ad entrambi i giocatori (al solo player1 nelle partite contro il bot),
+ * false altrimenti.
+ */
+bool send_game_update(server_t* server, game_t* game, player_id_t mover);
+
+/**
+ * Invia un messaggio in broadcast a tutti i client connessi esclusi exclude_client1 e exclude_client2.
+ * Il messaggio viene serializzato una sola volta e lo stesso frame viene scritto a ogni destinatario.
+ * La funzione diventa proprietaria di data.
+ * Ritorna ture se il messaggio è stato inviato a tutti i client connessi, false altrimenti.
+ */
+bool send_broadcast(server_t* server, const char* event_type, json_t* data, const ssize_t exclude_client1, const ssize_t exclude_client2);
+
+/**
+ * Invia in broadcast a tutti i client connessi esclusi exclude_client1 e exclude_client2 un messaggio il cui campo data
+ * è il json già serializzato data di data_len byte. Il frame viene costruito una sola volta per tutti i destinatari.
+ * Se game non è NULL i client con protocollo binario ricevono l'evento costruito dalla partita, il cui lock deve essere acquisito.
+ * Ritorna ture se il messaggio è stato inviato a tutti i client connessi, false altrimenti.
+ */
+bool send_broadcast_raw(server_t* server, const char* event_type, const char* data, const size_t data_len, const game_t* game, const ssize_t exclude_client1, const ssize_t exclude_client2);
+
+/**
+ * Invia un messaggio ad uno specifico player.
+ * Ritorna true se il messaggio è stato inviato correttamente, false altrimenti.
+ */
+bool send_to_player(server_t* server, json_t* json_data, const char* username, bool already_locked);
+
+/**
+ * Invia un messaggio Json aggiungendo un delimitatore di fine (come \n) assicurandosi che l'intero messaggio venga inviato
+ * anche se la rete o la connessione non permettono di inviarlo tutto in un'unica volta.
+ * Ritorna ture se il messaggio è stato inviato correttamente, false altrimenti.
+ */
+bool send_json_message(json_t* json_data, const size_t sock);
+
+/**
+ * Accoda un frame già costruito (prefisso di lunghezza compreso) sulla coda di uscita del socket sock.
+ * L'invio avviene con scritture non bloccanti al termine della richiesta in corso.
+ * Ritorna true se il frame è stato accodato correttamente, false altrimenti.
+ */
+bool send_frame(frame_t* frame, const size_t sock);
+
+/**
+ * Crea una richiesta standard in formato json specificando il tipo di richiesta e una descrizione.
+ * Ritorna la richiesta json il caso di corretta creazione, NULL altrimenti.
+ */
+json_t* create_request(const char* request_type, const char* description, json_t* data);
+
+/**
+ * Crea una risposta standard in formato json specificando il tipo di risposta e una descrizione.
+ * Ritorna la risposta json il caso di corretta creazione, NULL altrimenti.
+ */
+json_t* create_response(const char* response_type, bool status, const char* description, json_t* data);
+
+/**
+ * Crea direttamente il frame di una risposta standard il cui campo data è il json serializzato data di data_len byte
+ * (omesso se data è NULL), senza costruire l'albero json. Il contenuto è identico a quello di create_response serializzato con JSON_COMPACT.
+ * Ritorna il frame, NULL in caso di errore.
+ */
+frame_t* create_response_frame(const char* response_type, bool status, const char* description, const char* data, size_t data_len);
+
+/**
+ * Crea direttamente il frame di una richiesta standard il cui campo data è il json serializzato data di data_len byte
+ * (omesso se data è NULL), senza costruire l'albero json. Il contenuto è identico a quello di create_request serializzato con JSON_COMPACT.
+ * Ritorna il frame, NULL in caso di errore.
+ */
+frame_t* create_request_frame(const char* request_type, const char* description, const char* data, size_t data_len);
+
+/**
+ * Gestisce la ricezione di un messaggio dalla socket, usando reader come buffer di ricezione della connessione.
+ * Se il buffer contiene già un frame completo (più richieste arrivate con la stessa lettura) non legge dalla socket,
+ * altrimenti legge dalla socket, ricevendo a ogni lettura tutti i dati disponibili, finché il frame non è completo.
+ * Ritorna il messaggio senza prefisso, valido fino alla ricezione successiva, e ne scrive la lunghezza in len, NULL in caso di errore.
+ */
+const char* receive_frame(const size_t socket, frame_reader_t* reader, size_t* len);
 #endif
\ No newline at end of file
@@ -0,0 +1,188 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <server.h>
+
+#include "frame.h"
+
+#define OUTPUT_BLOCK_SIZE 256           // Code di uscita allocate insieme, indicizzate per numero di socket
+#define OUTPUT_MAX_EVENTS 64
+#define OUTPUT_IOV_MAX 64               // Frame scritti al più con una sola sendmsg
+#define OUTPUT_STALL_SECONDS 5          // Tempo massimo oltre la soglia di attenzione prima della disconnessione
+#define OUTPUT_SWEEP_MS 1000            // Intervallo tra due controlli delle code oltre la soglia di attenzione
+
+/**
+ * Scritture di un reactor io_uring. Le code delle socket registrate con un output_ring_t non vengono scritte dal thread
+ * che accoda i frame: vengono collegate a ready_head e il reactor, risvegliato con wake_fd se necessario, le invia
+ * con IORING_OP_SENDMSG insieme alle altre operazioni del ring. lock protegge la lista e i campi ready e next_ready delle code
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    int ready_head;                     // Code con frame da inviare, collegate tramite next_ready
+    bool wake_pending;                  // wake_fd già segnalato e non ancora consumato dal reactor
+    int wake_fd;
+} output_ring_t;
+
+/**
+ * Messaggio di una sendmsg eseguita dal ring: resta valido finché la scrittura non è completata
+ */
+typedef struct {
+    struct msghdr message;
+    struct iovec iov[OUTPUT_IOV_MAX];
+} output_ring_send_t;
+
+/**
+ * Coda di uscita di una connessione. I frame vengono accodati sotto lock e scritti insieme con sendmsg non bloccanti
+ * da un solo thread alla volta (writing), che rilascia il lock durante ogni scrittura. Se la socket non
+ * accetta altri dati la coda viene ripresa dal thread di output quando torna scrivibile.
+ * scheduled e next_scheduled collegano la coda alla lista delle code da svuotare del thread che l'ha
+ * riempita, e vengono toccati solo da quel thread finché scheduled è true.
+ * watched e next_watched collegano la coda alla lista delle code oltre la soglia di attenzione, controllata
+ * periodicamente dal thread di output e protetta da watch_mutex.
+ * Se ring non è NULL la coda viene scritta dal reactor io_uring che possiede la socket, e writing indica una
+ * sendmsg del ring ancora in corso.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t idle;                // Segnalata quando il thread che scrive rilascia la coda
+    frame_t** frames;                   // Buffer circolare dei frame da inviare
+    size_t head;
+    size_t count;
+    size_t capacity;
+    size_t offset;                      // Byte già inviati del primo frame
+    size_t queued_bytes;                // Byte ancora da inviare
+    time_t above_since;                 // Istante in cui la coda ha superato la soglia di attenzione, 0 se sotto
+    bool registered;
+    bool writing;
+    bool evicted;                       // Client disconnesso perché troppo lento: i nuovi frame vengono scartati
+    bool in_epoll;                      // Socket presente nell'istanza epoll del thread di output
+    bool scheduled;
+    int next_scheduled;
+    bool watched;
+    int next_watched;
+    output_ring_t* ring;
+    output_ring_send_t* ring_send;       // Allocato alla prima scrittura tramite ring
+    bool ready;
+    int next_ready;
+} output_queue_t;
+
+typedef struct {
+    output_queue_t queues[OUTPUT_BLOCK_SIZE];
+} output_block_t;
+
+/**
+ * Code di uscita di tutte le connessioni. I blocchi vengono allocati alla prima socket che ne ha bisogno
+ * e non vengono liberati fino a output_cleanup, così che le code possano essere lette senza lock globali.
+ * Il thread di output attende con epoll le sole socket che non hanno accettato tutti i dati in coda
+ * e disconnette i client rimasti oltre la soglia di attenzione per troppo tempo, anche se non ricevono nuovi frame.
+ */
+typedef struct {
+    _Atomic(output_block_t*)* blocks;
+    size_t block_count;
+    pthread_mutex_t blocks_mutex;       // Serializza solo l'allocazione dei blocchi
+    size_t high_water;                  // Soglia di attenzione in byte
+    size_t limit;                       // Byte massimi in coda per connessione
+    int epoll_fd;
+    int wake_fd;                        // eventfd usato da output_cleanup per risvegliare il thread di output
+    pthread_mutex_t watch_mutex;
+    int watch_head;                     // Code oltre la soglia di attenzione, collegate tramite next_watched
+    pthread_t thread;
+    bool started;
+    atomic_bool stopping;
+    atomic_size_t stalls;
+    atomic_size_t evictions;
+    atomic_size_t writes;               // Chiamate a sendmsg andate a buon fine
+    atomic_size_t frames_written;
+} output_t;
+
+/**
+ * Inizializza le code di uscita e avvia il thread che completa gli invii rimasti in sospeso.
+ * Ritorna true se l'inizializzazione è andata a buon fine, false altrimenti
+ */
+bool output_init(server_t* server);
+
+/**
+ * Termina il thread di output e libera le code. Da chiamare dopo la chiusura di tutte le connessioni
+ */
+void output_cleanup(void);
+
+/**
+ * Registra la coda di uscita della socket sock appena accettata. Se ring non è NULL i frame vengono inviati
+ * dal reactor io_uring che possiede ring, altrimenti con sendmsg dal thread che li accoda.
+ * Ritorna true se la coda è stata registrata, false in caso di errore di allocazione
+ */
+bool output_register(int sock, output_ring_t* ring);
+
+/**
+ * Scarta i frame ancora in coda per sock, attendendo il thread che sta eventualmente scrivendo.
+ * Una sendmsg del ring ancora in corso viene interrotta con shutdown, perché la connessione viene comunque chiusa.
+ * Da chiamare prima di chiudere la socket, così che nessuna scrittura possa raggiungere un descrittore riassegnato
+ */
+void output_unregister(int sock);
+
+/**
+ * Accoda il frame sulla socket sock acquisendone un riferimento. L'invio avviene alla successiva
+ * output_flush_pending del thread chiamante, quindi la funzione può essere chiamata con qualsiasi lock acquisito.
+ * Se la coda supera il limite, o resta oltre la soglia di attenzione per troppo tempo, il client viene disconnesso.
+ * Ritorna true se il frame è stato accodato, false altrimenti
+ */
+bool output_send(frame_t* frame, int sock);
+
+/**
+ * Scrive i frame accodati dal thread chiamante. Da chiamare senza alcun lock acquisito
+ */
+void output_flush_pending(void);
+
+/**
+ * Inizializza le scritture di un reactor io_uring, che viene risvegliato con wake_fd quando altri thread accodano frame
+ */
+void output_ring_init(output_ring_t* ring, int wake_fd);
+
+/**
+ * Libera le risorse di ring. Da chiamare dopo aver rimosso tutte le socket registrate con ring
+ */
+void output_ring_destroy(output_ring_t* ring);
+
+/**
+ * Indica che il thread chiamante è il reactor che possiede ring: i frame che accoda per le sue socket
+ * non richiedono di risvegliarlo
+ */
+void output_ring_attach(output_ring_t* ring);
+
+/**
+ * Estrae la prossima socket con frame da inviare tramite ring.
+ * Ritorna la socket, -1 se non ce ne sono
+ */
+int output_ring_next(output_ring_t* ring);
+
+/**
+ * Prepara l'invio dei frame in coda per sock con una sola sendmsg e segna la coda in scrittura.
+ * Ritorna il messaggio da passare a IORING_OP_SENDMSG, NULL se non c'è nulla da inviare
+ */
+struct msghdr* output_ring_prepare(int sock);
+
+/**
+ * Completa la sendmsg del ring per sock con il risultato result (byte inviati o -errno) e, se restano frame,
+ * rimette la coda tra quelle da inviare
+ */
+void output_ring_completed(int sock, int result);
+
+/**
+ * Ritorna true se una sendmsg del ring per sock è ancora in corso: la socket non può essere chiusa fino al suo completamento
+ */
+bool output_ring_busy(int sock);
+
+/**
+ * Stampa i frame inviati e le scritture usate per inviarli, il numero di attese di socket scrivibile
+ * e di client disconnessi perché troppo lenti
+ */
+void output_report(void);
+
+#endif
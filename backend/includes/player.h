@@ -0,0 +1,80 @@
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "server.h"
+
+typedef uint32_t player_id_t;
+
+#define PLAYER_NONE 0                   // Nessun giocatore: i giocatori registrati hanno id a partire da 1
+#define PLAYER_NAME_SIZE 64
+#define PLAYER_CHUNK_SIZE 256           // Nomi allocati insieme
+#define PLAYER_REGISTRY_MIN_BUCKETS 64
+
+typedef struct {
+    char name[PLAYER_NAME_SIZE];
+    player_id_t next;                   // Catena del bucket nell'indice per nome, o della lista degli id liberi
+    atomic_uint refs;                   // Client, partite e attese che usano l'id: a 0 l'id torna libero
+} player_entry_t;
+
+/**
+ * Registro degli username: ogni username riceve al login un id intero che le partite usano al posto del nome.
+ * Ogni id ha un contatore di riferimenti (il client connesso, le partite che lo contengono, l'attesa del matchmaking):
+ * quando arriva a 0 il nome esce dall'indice e l'id viene riusato dal successivo username registrato.
+ * I chunk dei nomi non vengono mai spostati né liberati fino a player_cleanup, e un nome cambia solo quando
+ * il suo id torna libero, quindi player_name lo legge senza lock finché il chiamante possiede un riferimento.
+ * mutex protegge l'indice nome -> id, la lista degli id liberi e l'azzeramento dei contatori.
+ */
+typedef struct {
+    _Atomic(player_entry_t*)* chunks;
+    size_t chunk_count;                 // Dimensionato sui limiti del server: gli id vivi non possono superarli
+    player_id_t count;                  // Prossimo id mai assegnato
+    player_id_t free_head;              // Id tornati liberi, collegati tramite next
+    player_id_t* buckets;
+    size_t bucket_count;
+    pthread_mutex_t mutex;
+} player_registry_t;
+
+/**
+ * Inizializza il registro degli username, dimensionato sul numero massimo di client e di partite del server
+ */
+void player_init(server_t* server);
+
+/**
+ * Libera la memoria del registro. Da chiamare dopo la terminazione di tutti i thread che usano gli id
+ */
+void player_cleanup(void);
+
+/**
+ * Ritorna l'id dell'username acquisendone un riferimento, registrandolo se non è in uso.
+ * Ritorna PLAYER_NONE se il registro è pieno o in caso di errore di allocazione
+ */
+player_id_t player_intern(const char* username);
+
+/**
+ * Cerca l'id di un username senza registrarlo e, se lo trova, ne acquisisce un riferimento da rilasciare con player_release.
+ * Ritorna l'id, PLAYER_NONE se l'username non è registrato
+ */
+player_id_t player_lookup(const char* username);
+
+/**
+ * Acquisisce un ulteriore riferimento all'id. Il chiamante deve già possederne uno
+ */
+void player_retain(player_id_t id);
+
+/**
+ * Rilascia un riferimento all'id: con l'ultimo l'username esce dal registro e l'id può essere riusato
+ */
+void player_release(player_id_t id);
+
+/**
+ * Ritorna il nome del giocatore senza acquisire lock, una stringa vuota per PLAYER_NONE.
+ * Il nome resta valido finché il chiamante possiede un riferimento all'id
+ */
+const char* player_name(player_id_t id);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <server.h>
+
+#include "worker_pool.h"
+#include "uring.h"
+#include "slab.h"
+#include "frame.h"
+#include "output.h"
+
+#define REACTOR_MAX_EVENTS 256
+#define CONNECTION_SLAB_CHUNK 64
+
+/**
+ * Stato di lettura di una connessione gestita dal reactor.
+ * Un frame è composto da 4 byte di lunghezza (network byte order) seguiti dal messaggio json.
+ * Entrambi i backend ricevono nello stesso buffer riutilizzabile, da cui vengono estratti tutti i frame completi.
+ */
+typedef struct {
+    pool_stream_t stream;           // Primo campo: la connessione è recuperabile dallo stream del pool
+    server_t* server;
+    slab_t* slab;                   // Pool del reactor da cui è stata allocata la connessione
+    frame_reader_t input;
+    bool closing;                   // Chiusura rimandata al completamento della sendmsg del ring in corso
+} connection_t;
+
+typedef struct {
+    server_t* server;
+    int listen_fd;
+    int epoll_fd;
+    int wake_fd;                    // eventfd usato da reactor_stop per risvegliare epoll_wait
+    atomic_bool stopping;
+    connection_t** connections;     // Connessioni di questo reactor, indicizzate per numero di socket
+    size_t capacity;
+    worker_pool_t* pool;            // NULL se le richieste vengono eseguite dal thread del reactor
+    bool use_uring;                 // true se il reactor usa io_uring al posto di epoll
+    uring_t ring;
+    output_ring_t output;           // Code di uscita delle connessioni scritte tramite il ring
+    size_t pending_sends;           // sendmsg inviate al ring e non ancora completate
+    slab_t connections_slab;        // Pool delle connessioni, con mutex: i worker le liberano da altri thread
+} reactor_t;
+
+/**
+ * Inizializza il reactor: crea l'istanza epoll e registra la socket di ascolto listen_fd in modalità edge-triggered.
+ * Se il server è configurato con il backend io_uring e il kernel lo supporta usa io_uring al posto di epoll.
+ * Se pool non è NULL le richieste vengono eseguite dai worker del pool invece che dal reactor.
+ * Ritorna true se l'inizializzazione è andata a buon fine, false altrimenti
+ */
+bool reactor_init(reactor_t* reactor, server_t* server, int listen_fd, worker_pool_t* pool);
+
+/**
+ * Callback del pool invocata dopo l'ultima richiesta di una connessione chiusa dal reactor:
+ * esegue la pulizia del client, chiude la socket e libera la connessione
+ */
+void reactor_release_connection(pool_stream_t* stream);
+
+/**
+ * Loop principale del reactor. Accetta le nuove connessioni, legge i frame in modo non bloccante
+ * e passa ogni messaggio completo a handle_request (o al pool). Termina dopo una chiamata a reactor_stop.
+ */
+void reactor_run(reactor_t* reactor);
+
+/**
+ * Chiede al reactor di terminare il loop principale. Può essere chiamata da qualsiasi thread.
+ */
+void reactor_stop(reactor_t* reactor);
+
+/**
+ * Chiude tutte le connessioni ancora aperte e libera la memoria allocata dal reactor
+ */
+void reactor_cleanup(reactor_t* reactor);
+
+#endif
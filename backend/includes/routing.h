@@ -1,13 +1,28 @@
-#ifndef ROUTING_H
-#define ROUTING_H
-
-#include <jansson.h>
-#include <stdbool.h>
-#include <server.h>
-
-/** 
- * Gestisce le varie richieste inviate dal client 
-*/
-void handle_request(server_t* server, const int client_sock, const json_t* json_request);
-
+#ifndef ROUTING_H
+#define ROUTING_H
+
+#include <jansson.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <server.h>
+
+/** 
+ * Gestisce le varie richieste inviate dal client.
+ * I messaggi prodotti dalla richiesta vengono inviati solo al termine, quando nessun lock è più acquisito
+*/
+void handle_request(server_t* server, const int client_sock, const json_t* json_request);
+
+/**
+ * Gestisce una richiesta in formato binario, ammessa solo dai client che hanno scelto il protocollo binario al login.
+ * Come per handle_request i messaggi prodotti vengono inviati solo al termine.
+ * Ritorna false se il messaggio è troppo lungo per essere una richiesta binaria e la connessione va chiusa, true altrimenti
+ */
+bool handle_binary_request(server_t* server, const int client_sock, const char* payload, size_t len);
+
+/**
+ * Gestisce la disconnessione di un client: rimuove le partite da lui create e lo elimina dalla lista dei client connessi.
+ * La chiusura della socket resta a carico del chiamante.
+ */
+void handle_disconnect(server_t* server, const int client_sock);
+
 #endif
\ No newline at end of file
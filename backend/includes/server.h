@@ -1,38 +1,79 @@
-#ifndef SERVER_H
-#define SERVER_H
-
-#include <pthread.h>
-#include <netinet/in.h>
-#include <sys/socket.h>
-#include <stdbool.h>
-
-#define MAX_CLIENTS 20
-#define MAX_GAMES 10
-#define DEFAULT_PORT 8080
-#define DISCONNECT_MESSAGE "!DISCONNECT"
-
-typedef struct {
-    ssize_t socket_fd;
-    bool running;
-    struct sockaddr_in address;
-    pthread_mutex_t clients_mutex;
-    pthread_mutex_t games_mutex;
-} server_t;
-
-/**
- * Inizializza le variabili utili a gestire le informazioni del server
- */
-void server_init(server_t *server, int port);
-
-/**
- * Crea una socket di tipo STREAM per il dominio TCP/IP, la imposta in modalità
- * SO_REUSEADDR in modo da consentire il riutilizzo degli indirizzi.
- */
-bool server_start(server_t *server);
-
-/**
- * Libera la memoria e imposta i campi della struttura ai valori di default prima di chiudere il server
- */
-void server_close(server_t *server);
-
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <stdbool.h>
+
+#include "logger.h"
+
+#define DEFAULT_MAX_CLIENTS 20
+#define DEFAULT_MAX_GAMES 10
+#define DEFAULT_BACKLOG 128
+#define DEFAULT_QUEUE_SIZE 4096
+#define DEFAULT_OUTPUT_HIGH_WATER 65536         // 64 KiB
+#define DEFAULT_OUTPUT_LIMIT 4194304            // 4 MiB
+#define DEFAULT_PORT 8080
+#define DISCONNECT_MESSAGE "!DISCONNECT"
+
+typedef enum {
+    SERVER_MODE_THREADS,    // Un thread dedicato per ogni client connesso
+    SERVER_MODE_EPOLL,      // Un unico reactor epoll edge-triggered per tutte le connessioni
+    SERVER_MODE_REUSEPORT   // Un reactor per core, ognuno con la propria socket di ascolto SO_REUSEPORT
+} server_mode_t;
+
+typedef enum {
+    IO_BACKEND_EPOLL,       // Notifica di disponibilità con epoll e recv non bloccanti
+    IO_BACKEND_URING        // Recv e accept asincrone con io_uring, se supportato dal kernel
+} io_backend_t;
+
+typedef struct {
+    ssize_t socket_fd;
+    bool running;
+    server_mode_t mode;
+    io_backend_t io_backend;
+    size_t workers;         // Worker che eseguono le richieste in modalità epoll, 0 = eseguite dal reactor
+    size_t queue_size;      // Numero massimo di richieste in coda per i worker
+    size_t listeners;       // Socket di ascolto (e reactor) in modalità reuseport
+    size_t max_clients;     // Client connessi contemporaneamente
+    size_t max_games;       // Partite presenti contemporaneamente
+    int backlog;            // Connessioni in attesa di accept sulla socket di ascolto
+    size_t output_high_water;   // Byte in uscita oltre i quali un client che non si svuota viene disconnesso
+    size_t output_limit;        // Byte massimi in uscita per client, oltre i quali viene disconnesso subito
+    log_level_t log_level;      // Livello massimo dei messaggi di log scritti
+    struct sockaddr_in address;
+    /*
+     * Ordine di acquisizione dei lock: games_mutex -> lock di una partita -> clients_mutex.
+     * games_mutex protegge la tabella delle partite e la lobby, il lock della partita il suo stato.
+     * Più lock di partita possono essere tenuti insieme solo da chi possiede games_mutex.
+     */
+    pthread_mutex_t clients_mutex;
+    pthread_mutex_t games_mutex;
+} server_t;
+
+/**
+ * Inizializza le variabili utili a gestire le informazioni del server
+ */
+void server_init(server_t *server, int port);
+
+/**
+ * Crea una socket di tipo STREAM per il dominio TCP/IP, la imposta in modalità
+ * SO_REUSEADDR in modo da consentire il riutilizzo degli indirizzi.
+ * In modalità reuseport la socket viene aperta anche con SO_REUSEPORT.
+ */
+bool server_start(server_t *server);
+
+/**
+ * Apre un'ulteriore socket di ascolto sulla stessa porta con SO_REUSEPORT: il kernel distribuisce
+ * le nuove connessioni tra tutte le socket aperte in questo modo.
+ * Ritorna il descrittore della socket, -1 in caso di errore
+ */
+int server_open_listener(server_t *server);
+
+/**
+ * Libera la memoria e imposta i campi della struttura ai valori di default prima di chiudere il server
+ */
+void server_close(server_t *server);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct slab_chunk {
+    struct slab_chunk* next;
+} slab_chunk_t;
+
+typedef struct slab_object {
+    struct slab_object* next;
+} slab_object_t;
+
+/**
+ * Pool di oggetti di dimensione fissa. Gli oggetti vengono ricavati da chunk di per_chunk oggetti
+ * e, una volta liberati, restano nella lista dei liberi del pool invece di tornare a malloc.
+ * Un pool con locked = false non ha un proprio mutex: è il chiamante a garantire che sia usato
+ * sotto un lock che già possiede (ad esempio quello della struttura che contiene gli oggetti).
+ */
+typedef struct slab {
+    const char* name;
+    size_t object_size;
+    size_t per_chunk;
+    bool locked;
+    pthread_mutex_t mutex;
+    slab_object_t* free_list;
+    slab_chunk_t* chunks;
+
+    // Contatori, leggibili da qualsiasi thread senza acquisire il lock del pool
+    atomic_size_t allocs;
+    atomic_size_t frees;
+    atomic_size_t in_use;
+    atomic_size_t peak_in_use;
+    atomic_size_t chunk_allocs;     // Chiamate a malloc: a regime non deve più crescere
+    size_t reported_chunk_allocs;
+    struct slab* next_registered;   // Pool registrati per slab_report_all
+} slab_t;
+
+/**
+ * Inizializza un pool di oggetti da object_size byte, allocati a gruppi di per_chunk, e lo registra per i report
+ */
+void slab_init(slab_t* slab, const char* name, size_t object_size, size_t per_chunk, bool locked);
+
+/**
+ * Preleva un oggetto azzerato dal pool, allocando un nuovo chunk solo se non ci sono oggetti liberi.
+ * Ritorna l'oggetto, NULL in caso di errore di allocazione
+ */
+void* slab_alloc(slab_t* slab);
+
+/**
+ * Restituisce l'oggetto al pool da cui è stato prelevato
+ */
+void slab_free(slab_t* slab, void* object);
+
+/**
+ * Stampa i contatori del pool e il numero di chunk allocati dall'ultimo report
+ */
+void slab_report(slab_t* slab);
+
+/**
+ * Stampa i contatori di tutti i pool registrati
+ */
+void slab_report_all(void);
+
+/**
+ * Libera tutti i chunk del pool e lo rimuove dai report. Gli oggetti del pool non devono più essere in uso
+ */
+void slab_destroy(slab_t* slab);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef URING_H
+#define URING_H
+
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define URING_ENTRIES 4096
+
+/**
+ * Istanza io_uring gestita senza liburing: le code di submission e completion sono
+ * mappate in memoria e condivise con il kernel.
+ */
+typedef struct {
+    int ring_fd;
+    unsigned int entries;
+
+    // Coda di submission
+    unsigned int* sq_head;
+    unsigned int* sq_tail;
+    unsigned int* sq_mask;
+    unsigned int* sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned int sq_local_tail;     // SQE preparate ma non ancora rese visibili al kernel
+    unsigned int to_submit;
+
+    // Coda di completion
+    unsigned int* cq_head;
+    unsigned int* cq_tail;
+    unsigned int* cq_mask;
+    struct io_uring_cqe* cqes;
+
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} uring_t;
+
+/**
+ * Verifica a runtime che il kernel supporti io_uring e le operazioni usate dal server (accept, recv, sendmsg, poll).
+ * Ritorna true se il supporto è disponibile, false altrimenti
+ */
+bool uring_supported(void);
+
+/**
+ * Crea un'istanza io_uring con entries posizioni nella coda di submission.
+ * Ritorna true se l'istanza è stata creata, false altrimenti
+ */
+bool uring_init(uring_t* ring, unsigned int entries);
+
+/**
+ * Ritorna una SQE libera e azzerata, inviando al kernel quelle già preparate se la coda è piena.
+ * Ritorna NULL se non è stato possibile liberare spazio
+ */
+struct io_uring_sqe* uring_get_sqe(uring_t* ring);
+
+/**
+ * Invia al kernel con un'unica system call tutte le SQE preparate e attende almeno wait_nr completamenti.
+ * Ritorna il numero di SQE inviate, -1 in caso di errore (errno impostato)
+ */
+int uring_submit_and_wait(uring_t* ring, unsigned int wait_nr);
+
+/**
+ * Ritorna il prossimo completamento disponibile senza consumarlo, NULL se non ce ne sono
+ */
+struct io_uring_cqe* uring_peek_cqe(uring_t* ring);
+
+/**
+ * Segna come consumato il completamento restituito da uring_peek_cqe
+ */
+void uring_cqe_seen(uring_t* ring);
+
+/**
+ * Chiude l'istanza io_uring e rimuove le mappature di memoria
+ */
+void uring_cleanup(uring_t* ring);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <jansson.h>
+#include <server.h>
+
+#include "slab.h"
+#include "binary.h"
+
+#define POOL_JOB_SLAB_CHUNK 256
+
+typedef struct pool_job {
+    json_t* request;            // NULL indica la disconnessione del client, se binary_len è 0
+    unsigned char binary[BINARY_REQUEST_MAX];   // Richiesta binaria, copiata nel job senza allocazioni
+    size_t binary_len;
+    struct pool_job* next;
+} pool_job_t;
+
+/**
+ * Stato di una connessione rispetto al pool:
+ * - IDLE: nessuna richiesta in attesa
+ * - QUEUED: la connessione è nella coda dei pronti
+ * - RUNNING: un worker sta eseguendo una sua richiesta
+ * Una connessione è in mano ad al più un worker alla volta, quindi le sue richieste vengono eseguite in ordine.
+ */
+typedef enum {
+    STREAM_IDLE,
+    STREAM_QUEUED,
+    STREAM_RUNNING
+} stream_state_t;
+
+typedef struct pool_stream {
+    int socket;
+    stream_state_t state;
+    pool_job_t* head;
+    pool_job_t* tail;
+    struct pool_stream* next_ready;
+} pool_stream_t;
+
+typedef void (*stream_close_fn)(pool_stream_t* stream);
+
+typedef struct {
+    server_t* server;
+    pthread_t* threads;
+    size_t workers;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pool_stream_t* ready_head;      // Coda condivisa delle connessioni con richieste da eseguire
+    pool_stream_t* ready_tail;
+    size_t pending;                 // Richieste in coda non ancora eseguite
+    size_t max_pending;
+    size_t peak_pending;
+    size_t processed;
+    bool stopping;
+    stream_close_fn on_close;
+    slab_t jobs;                    // Pool dei job, usato solo con il mutex del pool acquisito
+} worker_pool_t;
+
+/**
+ * Avvia workers thread che eseguono le richieste accodate. La coda accetta al più queue_size richieste,
+ * oltre le quali worker_pool_submit si blocca finché un worker non libera spazio.
+ * on_close viene invocata da un worker dopo l'ultima richiesta di una connessione chiusa.
+ * Ritorna true se il pool è stato avviato, false altrimenti
+ */
+bool worker_pool_init(worker_pool_t* pool, server_t* server, size_t workers, size_t queue_size, stream_close_fn on_close);
+
+/**
+ * Accoda una richiesta della connessione. Il pool diventa proprietario del json.
+ * Ritorna true se la richiesta è stata accodata, false altrimenti
+ */
+bool worker_pool_submit(worker_pool_t* pool, pool_stream_t* stream, json_t* request);
+
+/**
+ * Accoda una richiesta binaria della connessione, copiandola nel job.
+ * Ritorna true se la richiesta è stata accodata, false se è troppo lunga o in caso di errore
+ */
+bool worker_pool_submit_binary(worker_pool_t* pool, pool_stream_t* stream, const char* payload, size_t len);
+
+/**
+ * Accoda la chiusura della connessione, eseguita dopo tutte le sue richieste ancora in coda
+ */
+bool worker_pool_close_stream(worker_pool_t* pool, pool_stream_t* stream);
+
+/**
+ * Stampa la profondità attuale e massima della coda e il numero di richieste eseguite
+ */
+void worker_pool_report(worker_pool_t* pool);
+
+/**
+ * Esegue le richieste ancora in coda, termina i worker e libera la memoria allocata dal pool
+ */
+void worker_pool_destroy(worker_pool_t* pool);
+
+#endif
@@ -0,0 +1,172 @@
+#include "binary.h"
+
+#include <string.h>
+
+//============ METODI PRIVATI ==================//
+/**
+ * Scrive value in network byte order a partire da out
+ */
+static void put_u64(unsigned char* out, uint64_t value) {
+    for (int i = 7; i >= 0; i--) {
+        out[i] = (unsigned char)(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+/**
+ * Scrive value in network byte order a partire da out
+ */
+static void put_u16(unsigned char* out, uint16_t value) {
+    out[0] = (unsigned char)(value >> 8);
+    out[1] = (unsigned char)(value & 0xFF);
+}
+
+/**
+ * Legge un intero a 64 bit in network byte order a partire da in
+ */
+static uint64_t get_u64(const unsigned char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+/**
+ * Converte il nome di un evento broadcast nel codice binario corrispondente.
+ * Ritorna il codice, 0 se l'evento non ha una forma binaria
+ */
+static uint8_t event_code(const char* event_type) {
+    if (strcmp(event_type, "new_game_available") == 0) return BINARY_EVENT_NEW_GAME_AVAILABLE;
+    if (strcmp(event_type, "game_not_available") == 0) return BINARY_EVENT_GAME_NOT_AVAILABLE;
+    if (strcmp(event_type, "game_ended") == 0) return BINARY_EVENT_GAME_ENDED;
+    if (strcmp(event_type, "game_removed") == 0) return BINARY_EVENT_GAME_REMOVED;
+    return 0;
+}
+
+/**
+ * Converte lo stato della partita serializzato in json nel valore di game_state_t.
+ * Ritorna lo stato, BINARY_STATE_UNKNOWN se state è NULL o non riconosciuto
+ */
+static uint8_t state_code(const char* state) {
+    if (!state) return BINARY_STATE_UNKNOWN;
+    if (strcmp(state, "GAME_WAITING") == 0) return GAME_WAITING;
+    if (strcmp(state, "GAME_ONGOING") == 0) return GAME_ONGOING;
+    if (strcmp(state, "GAME_OVER") == 0) return GAME_OVER;
+    return BINARY_STATE_UNKNOWN;
+}
+
+/**
+ * Compone il frame BINARY_LOBBY_EVENT. player1 e player2 possono essere NULL.
+ * Ritorna il frame, NULL in caso di errore
+ */
+static frame_t* build_lobby_event(uint8_t event, uint64_t game_id, uint8_t state, const char* player1, const char* player2) {
+    size_t len1 = player1 ? strlen(player1) : 0;
+    size_t len2 = player2 ? strlen(player2) : 0;
+    if (len1 > UINT8_MAX) len1 = UINT8_MAX;
+    if (len2 > UINT8_MAX) len2 = UINT8_MAX;
+
+    frame_t* frame = frame_alloc(13 + len1 + len2);
+    if (!frame) return NULL;
+
+    unsigned char* out = (unsigned char*)frame_payload(frame);
+    out[0] = BINARY_LOBBY_EVENT;
+    out[1] = event;
+    put_u64(out + 2, game_id);
+    out[10] = state;
+
+    out[11] = (unsigned char)len1;
+    if (len1 > 0) memcpy(out + 12, player1, len1);
+    out[12 + len1] = (unsigned char)len2;
+    if (len2 > 0) memcpy(out + 13 + len1, player2, len2);
+
+    frame_finish(frame, 13 + len1 + len2);
+    return frame;
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Verifica se il messaggio ricevuto o da inviare è in formato binario.
+ * Ritorna true se il primo byte è un codice del protocollo binario, false se il messaggio è un json
+ */
+bool binary_is_message(const char* payload, size_t len) {
+    return len > 0 && (unsigned char)payload[0] < BINARY_OPCODE_LIMIT;
+}
+
+/**
+ * Decodifica una richiesta BINARY_MOVE.
+ * Ritorna true se il messaggio è una mossa ben formata, false altrimenti
+ */
+bool binary_decode_move(const char* payload, size_t len, binary_move_t* move) {
+    const unsigned char* in = (const unsigned char*)payload;
+    if (len != BINARY_MOVE_LEN || in[0] != BINARY_MOVE) return false;
+
+    move->game_id = (size_t)get_u64(in + 1);
+    move->x = in[9];
+    move->y = in[10];
+    return true;
+}
+
+/**
+ * Crea il frame BINARY_MOVE_ERROR per la mossa rifiutata sulla partita game_id.
+ * Ritorna il frame, NULL in caso di errore
+ */
+frame_t* binary_move_error(size_t game_id, binary_move_error_t error) {
+    frame_t* frame = frame_alloc(BINARY_MOVE_ERROR_LEN);
+    if (!frame) return NULL;
+
+    unsigned char* out = (unsigned char*)frame_payload(frame);
+    out[0] = BINARY_MOVE_ERROR;
+    out[1] = (unsigned char)error;
+    put_u64(out + 2, game_id);
+
+    frame_finish(frame, BINARY_MOVE_ERROR_LEN);
+    return frame;
+}
+
+/**
+ * Crea il frame BINARY_GAME_UPDATE con lo stato della partita. own_move indica che il destinatario ha appena mosso.
+ * Da chiamare con il lock della partita acquisito. Ritorna il frame, NULL in caso di errore
+ */
+frame_t* binary_game_update(const game_t* game, bool own_move) {
+    frame_t* frame = frame_alloc(BINARY_GAME_UPDATE_LEN);
+    if (!frame) return NULL;
+
+    unsigned char* out = (unsigned char*)frame_payload(frame);
+    out[0] = BINARY_GAME_UPDATE;
+    out[1] = own_move ? BINARY_UPDATE_OWN_MOVE : 0;
+    put_u64(out + 2, game->id);
+    out[10] = (unsigned char)game->state;
+    out[11] = game->turn ? BINARY_PLAYER2 : BINARY_PLAYER1;
+    out[12] = game->winner == GAME_WINNER_PLAYER1 ? BINARY_PLAYER1 : game->winner == GAME_WINNER_PLAYER2 ? BINARY_PLAYER2 : BINARY_PLAYER_NONE;
+    put_u16(out + 13, game->x_mask);
+    put_u16(out + 15, game->o_mask);
+
+    frame_finish(frame, BINARY_GAME_UPDATE_LEN);
+    return frame;
+}
+
+/**
+ * Crea il frame BINARY_LOBBY_EVENT dell'evento broadcast event_type a partire dalla partita.
+ * Da chiamare con il lock della partita acquisito. Ritorna il frame, NULL se l'evento non ha una forma binaria o in caso di errore
+ */
+frame_t* binary_lobby_event(const char* event_type, const game_t* game) {
+    uint8_t event = event_code(event_type);
+    if (!event) return NULL;
+
+    return build_lobby_event(event, game->id, (uint8_t)game->state, player_name(game->player1), player_name(game->player2));
+}
+
+/**
+ * Crea il frame BINARY_LOBBY_EVENT dell'evento broadcast event_type a partire dal json della partita
+ * (o del solo game_id). Ritorna il frame, NULL se l'evento non ha una forma binaria o in caso di errore
+ */
+frame_t* binary_lobby_event_from_json(const char* event_type, const json_t* data) {
+    uint8_t event = event_code(event_type);
+    if (!event || !json_is_integer(json_object_get(data, "game_id"))) return NULL;
+
+    return build_lobby_event(event, (uint64_t)json_integer_value(json_object_get(data, "game_id")),
+        state_code(json_string_value(json_object_get(data, "state"))),
+        json_string_value(json_object_get(data, "player1")),
+        json_string_value(json_object_get(data, "player2")));
+}
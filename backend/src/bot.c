@@ -0,0 +1,107 @@
+#include "bot.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "logger.h"
+
+static player_id_t bot_id = PLAYER_NONE;
+static _Thread_local uint32_t random_state = 0;
+
+/**
+ * Probabilità (in percentuale) che il bot scelga una mossa con un esito peggiore di quello migliore, per livello
+ */
+static const unsigned int BOT_MISTAKE_PERCENT[] = {
+    [BOT_NONE] = 0,
+    [BOT_EASY] = 60,
+    [BOT_MEDIUM] = 25,
+    [BOT_HARD] = 0
+};
+
+//============ METODI PRIVATI ==================//
+/**
+ * Generatore xorshift del thread chiamante, inizializzato al primo uso
+ */
+static uint32_t next_random(void) {
+    if (random_state == 0) {
+        random_state = (uint32_t)time(NULL) ^ (uint32_t)(uintptr_t)&random_state;
+        if (random_state == 0) random_state = 1;
+    }
+
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+/**
+ * Sceglie a caso una cella il cui esito è compreso tra min_outcome e max_outcome.
+ * Ritorna la cella, -1 se nessuna cella ha un esito nell'intervallo
+ */
+static int pick_random(uint32_t outcomes, unsigned int min_outcome, unsigned int max_outcome) {
+    int cells[9];
+    int count = 0;
+
+    for (int cell = 0; cell < 9; cell++) {
+        unsigned int outcome = (outcomes >> (cell * 2)) & 3u;
+        if (outcome != BOT_OUTCOME_NONE && outcome >= min_outcome && outcome <= max_outcome) {
+            cells[count++] = cell;
+        }
+    }
+
+    return count > 0 ? cells[next_random() % (uint32_t)count] : -1;
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Registra l'username del bot, così che le partite contro il bot abbiano un player2
+ */
+void bot_init(void) {
+    // Il riferimento acquisito non viene mai rilasciato: l'id del bot resta lo stesso per tutta la vita del server
+    bot_id = player_intern(BOT_USERNAME);
+    if (bot_id == PLAYER_NONE) {
+        log_error("bot.bot_init", "Impossibile registrare il bot");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Ritorna l'id del bot nel registro dei giocatori
+ */
+player_id_t bot_player(void) {
+    return bot_id;
+}
+
+/**
+ * Converte il nome del livello ("easy", "medium", "hard") nel livello corrispondente, BOT_HARD se name è NULL.
+ * Ritorna il livello, BOT_NONE se il nome non è valido
+ */
+bot_level_t bot_level_from_string(const char* name) {
+    if (!name || strcmp(name, "hard") == 0) return BOT_HARD;
+    if (strcmp(name, "medium") == 0) return BOT_MEDIUM;
+    if (strcmp(name, "easy") == 0) return BOT_EASY;
+    return BOT_NONE;
+}
+
+/**
+ * Sceglie la mossa del bot nella posizione indicata con una sola lettura delle tabelle, senza ricerca.
+ * Ritorna la cella scelta (x * 3 + y), -1 se non ci sono mosse
+ */
+int bot_choose_move(uint16_t x_mask, uint16_t o_mask, bot_level_t level) {
+    size_t state = bot_ternary[x_mask & 0x1FF] + 2u * bot_ternary[o_mask & 0x1FF];
+    uint32_t outcomes = bot_outcomes[state];
+    if (outcomes == 0) return -1;
+
+    int best = bot_best[state];
+    if (level == BOT_HARD) return best;
+
+    // Gli altri livelli campionano dalla stessa tabella: un errore è una mossa con un esito peggiore della migliore
+    unsigned int best_outcome = (outcomes >> (best * 2)) & 3u;
+    if (next_random() % 100 < BOT_MISTAKE_PERCENT[level]) {
+        int cell = pick_random(outcomes, BOT_OUTCOME_LOSS, best_outcome - 1);
+        if (cell >= 0) return cell;
+    }
+
+    return pick_random(outcomes, best_outcome, best_outcome);
+}
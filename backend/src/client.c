@@ -1,199 +1,328 @@
-#include "client.h"
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <sys/socket.h>
-#include <arpa/inet.h>
-
-client_list_t* connected_clients = NULL;
-
-//============ INTERFACCIA PUBBLICA ==================//
-/**
- * Inizializza le strutture utili per gestire i client connessi
- */
-void client_init(server_t* server) {
-    pthread_mutex_lock(&server->clients_mutex);
-
-    if (connected_clients == NULL) {
-        connected_clients = (client_list_t*)malloc(sizeof(client_list_t));
-        if (!connected_clients) {
-            printf("[Errore - client.client_init] Impossibile allocare memoria per la lista dei client connessi\n");
-            exit(EXIT_FAILURE);
-        }
-        
-        connected_clients->head = NULL;
-        connected_clients->count = 0;
-    }
-
-    pthread_mutex_unlock(&server->clients_mutex);
-}
-
-/**
- * Libera la memoria allocata per gestire i client connessi 
- */
-void client_cleanup(server_t* server) {
-    pthread_mutex_lock(&server->clients_mutex);
-    
-    client_node_t* current = connected_clients->head;
-    while (current) {
-        client_node_t* next = current->next;
-        free(current);
-        current = next;
-    }
-    
-    free(connected_clients);
-    connected_clients = NULL;
-    
-    pthread_mutex_unlock(&server->clients_mutex);
-}
-
-/**
- * Aggiunge un client alla lista di client connessi al server
- * Ritorna true se il client è stato aggiunto correttamente, false altrimenti
- */
-bool client_add(server_t* server, const client_t* client) {
-    pthread_mutex_lock(&server->clients_mutex);
-    
-    // Controllo disponibilità slot client 
-    if(connected_clients->count >= MAX_CLIENTS){
-        pthread_mutex_unlock(&server->clients_mutex);
-        printf("[Errore - client.client_add] Impossibile aggiungere client, il server è pieno\n");
-        return false;
-    }
-
-    // Alloca memoria per il nuovo client
-    client_node_t* new_node = (client_node_t*)malloc(sizeof(client_node_t));
-    if (!new_node) {
-        printf("[Errore - client.client_add] Impossibile allocare memoria un nuovo client\n");
-
-        pthread_mutex_unlock(&server->clients_mutex);
-        return false;
-    }
-
-    // Aggiungo il client alla struttura
-    new_node->client = *client;
-    new_node->next = connected_clients->head;
-    connected_clients->head = new_node;
-    connected_clients->count++;
-    
-
-    printf("[Info - client.client_add] Nuovo client connesso: %s (socket %ld)\n", client->username, client->socket);
-    pthread_mutex_unlock(&server->clients_mutex);
-    return true;
-}
-
-/**
- * Rimuove il client dalla lista di client connessi.
- * Ritorna verso se il client è stato rimosso, false altrimenti
- */
-bool client_remove(server_t* server, const ssize_t socket) {
-    pthread_mutex_lock(&server->clients_mutex);
-    
-    client_node_t** pp = &connected_clients->head;
-    client_node_t* current = connected_clients->head;
-    
-    while (current) {
-        if (current->client.socket == socket) {
-            *pp = current->next;
-            
-            printf("[Info - client.client_remove] Client disconnesso: %s (socket %ld)\n", current->client.username, current->client.socket);
-            close(current->client.socket);
-            memset(&current->client, 0, sizeof(client_t));
-            
-            free(current);
-
-            connected_clients->count--;
-
-            pthread_mutex_unlock(&server->clients_mutex);
-            return true;
-        }
-        pp = &current->next;
-        current = current->next;
-    }
-    
-    pthread_mutex_unlock(&server->clients_mutex);
-
-    printf("[Errore - client.client_remove] Il client che si sta cercando di rimuovere non esiste\n");
-    return false;
-}
-
-/**
- * Cerca la in numero di socket del client in base all'username (univoco) del player. 
- * Ritorna il numero della socket a cui è connesso il client se il player esiste, -1 altrimenti 
- */
-ssize_t find_client_by_username(server_t* server, const char* username) {
-    if (strlen(username) == 0){
-        printf("[Errore - client.find_client_by_username] Il nome del giocatore non valido\n");
-        return -1;
-    }
-
-    pthread_mutex_lock(&server->clients_mutex);
-    
-    client_node_t* current = connected_clients->head;
-    while (current) {
-        if (strcmp(current->client.username, username) == 0) {
-            int socket = current->client.socket;
-            pthread_mutex_unlock(&server->clients_mutex);
-
-            return socket;
-        }
-        current = current->next;
-    }
-    
-    pthread_mutex_unlock(&server->clients_mutex);
-    printf("[Errore - client.find_client_by_username] Il client associato giocatore %s non esiste\n", username);
-    return -1;
-}
-
-/**
- * Cerca l'username (univoco) del player in base al numero di socket. 
- * Ritorna il numero l'username del player se esiste, NULL altrimenti 
- */
-const char* find_username_by_client(server_t* server, const ssize_t sock) {
-    if (sock == -1){
-        printf("[Errore - client.find_username_by_client] Client non valido\n");
-        return NULL;
-    }
-    
-    pthread_mutex_lock(&server->clients_mutex);
-    
-    client_node_t* current = connected_clients->head;
-    while (current) {
-        if (current->client.socket == sock) {
-            const char* username = current->client.username;
-
-            pthread_mutex_unlock(&server->clients_mutex);
-            return username;
-        }
-        current = current->next;
-    }
-    
-    pthread_mutex_unlock(&server->clients_mutex);
-    printf("[Errore - client.find_username_by_client] Il client %ld non esiste\n", sock);
-    return NULL;
-}
-
-/**
- * Verifica se l'username è univoco. 
- * Ritorna vero se l'username è univoco, false altrimenti
- */
-bool is_username_unique(server_t* server, const char* username) {
-    if (!username) return false;
-
-    pthread_mutex_lock(&server->clients_mutex);
-    
-    client_node_t* current = connected_clients->head;
-    while (current) {
-        if (strcmp(current->client.username, username) == 0) {
-
-            pthread_mutex_unlock(&server->clients_mutex);
-            return false;
-        }
-        current = current->next;
-    }
-    
-    pthread_mutex_unlock(&server->clients_mutex);
-    return true;
-}
\ No newline at end of file
+#include "client.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "slab.h"
+#include "logger.h"
+
+client_list_t* connected_clients = NULL;
+static slab_t client_slab;      // Nodi dei client, usato solo con clients_mutex acquisito
+
+//============ METODI PRIVATI ==================//
+/**
+ * Hash moltiplicativo del numero di socket, che distribuisce sui bucket anche descrittori consecutivi
+ */
+static size_t hash_socket(ssize_t sock) {
+    return (size_t)(((uint64_t)sock * 11400714819323198485ULL) >> 32);
+}
+
+/**
+ * Inserisce il nodo in entrambi gli indici. Da chiamare con clients_mutex acquisito
+ */
+static void index_insert(client_node_t* node) {
+    size_t mask = connected_clients->buckets - 1;
+
+    client_node_t** name_bucket = &connected_clients->by_username[username_hash(node->client.username) & mask];
+    node->next_by_username = *name_bucket;
+    *name_bucket = node;
+
+    client_node_t** socket_bucket = &connected_clients->by_socket[hash_socket(node->client.socket) & mask];
+    node->next_by_socket = *socket_bucket;
+    *socket_bucket = node;
+}
+
+/**
+ * Rimuove il nodo da entrambi gli indici. Da chiamare con clients_mutex acquisito
+ */
+static void index_remove(client_node_t* node) {
+    size_t mask = connected_clients->buckets - 1;
+
+    client_node_t** pp = &connected_clients->by_username[username_hash(node->client.username) & mask];
+    while (*pp && *pp != node) pp = &(*pp)->next_by_username;
+    if (*pp) *pp = node->next_by_username;
+
+    pp = &connected_clients->by_socket[hash_socket(node->client.socket) & mask];
+    while (*pp && *pp != node) pp = &(*pp)->next_by_socket;
+    if (*pp) *pp = node->next_by_socket;
+}
+
+/**
+ * Alloca gli indici con il numero di bucket indicato e vi reinserisce tutti i client connessi.
+ * Da chiamare con clients_mutex acquisito. Ritorna true se gli indici sono stati ricostruiti, false altrimenti
+ */
+static bool index_rebuild(size_t buckets) {
+    client_node_t** by_username = calloc(buckets, sizeof(client_node_t*));
+    client_node_t** by_socket = calloc(buckets, sizeof(client_node_t*));
+    if (!by_username || !by_socket) {
+        free(by_username);
+        free(by_socket);
+        return false;
+    }
+
+    free(connected_clients->by_username);
+    free(connected_clients->by_socket);
+    connected_clients->by_username = by_username;
+    connected_clients->by_socket = by_socket;
+    connected_clients->buckets = buckets;
+
+    for (client_node_t* current = connected_clients->head; current; current = current->next) {
+        index_insert(current);
+    }
+    return true;
+}
+
+/**
+ * Cerca il nodo del client connesso alla socket. Da chiamare con clients_mutex acquisito
+ */
+static client_node_t* lookup_socket(ssize_t sock) {
+    client_node_t* current = connected_clients->by_socket[hash_socket(sock) & (connected_clients->buckets - 1)];
+    while (current && current->client.socket != sock) {
+        current = current->next_by_socket;
+    }
+    return current;
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Inizializza le strutture utili per gestire i client connessi
+ */
+void client_init(server_t* server) {
+    pthread_mutex_lock(&server->clients_mutex);
+
+    if (connected_clients == NULL) {
+        connected_clients = (client_list_t*)malloc(sizeof(client_list_t));
+        if (!connected_clients) {
+            log_error("client.client_init", "Impossibile allocare memoria per la lista dei client connessi");
+            exit(EXIT_FAILURE);
+        }
+        
+        connected_clients->head = NULL;
+        connected_clients->count = 0;
+        connected_clients->by_username = NULL;
+        connected_clients->by_socket = NULL;
+        connected_clients->buckets = 0;
+
+        if (!index_rebuild(CLIENT_INDEX_MIN_BUCKETS)) {
+            log_error("client.client_init", "Impossibile allocare memoria per gli indici dei client connessi");
+            exit(EXIT_FAILURE);
+        }
+
+        slab_init(&client_slab, "client", sizeof(client_node_t), CLIENT_SLAB_CHUNK, false);
+    }
+
+    pthread_mutex_unlock(&server->clients_mutex);
+}
+
+/**
+ * Libera la memoria allocata per gestire i client connessi 
+ */
+void client_cleanup(server_t* server) {
+    pthread_mutex_lock(&server->clients_mutex);
+    
+    slab_destroy(&client_slab);
+    
+    free(connected_clients->by_username);
+    free(connected_clients->by_socket);
+    free(connected_clients);
+    connected_clients = NULL;
+    
+    pthread_mutex_unlock(&server->clients_mutex);
+}
+
+/**
+ * Aggiunge il client connesso alla socket sock con l'username e il formato dei messaggi indicati alla lista di client connessi al server.
+ * delta_updates indica che il client riceve gli aggiornamenti della partita in forma incrementale
+ * Ritorna true se il client è stato aggiunto correttamente, false altrimenti
+ */
+bool client_add(server_t* server, const ssize_t sock, const char* username, client_protocol_t protocol, bool delta_updates) {
+    // L'id viene assegnato prima di acquisire clients_mutex: il registro ha un proprio lock
+    player_id_t player = player_intern(username);
+    if (player == PLAYER_NONE) {
+        log_error("client.client_add", "Impossibile registrare l'username %s", username);
+        return false;
+    }
+
+    pthread_mutex_lock(&server->clients_mutex);
+    
+    // Controllo disponibilità slot client 
+    if(connected_clients->count >= server->max_clients){
+        pthread_mutex_unlock(&server->clients_mutex);
+        player_release(player);
+        log_error("client.client_add", "Impossibile aggiungere client, il server è pieno");
+        return false;
+    }
+
+    // Il nodo viene preso dal pool e il client costruito direttamente al suo interno
+    client_node_t* new_node = (client_node_t*)slab_alloc(&client_slab);
+    if (!new_node) {
+        log_error("client.client_add", "Impossibile allocare memoria un nuovo client");
+
+        pthread_mutex_unlock(&server->clients_mutex);
+        player_release(player);
+        return false;
+    }
+
+    // Aggiungo il client alla struttura
+    new_node->client.socket = sock;
+    strncpy(new_node->client.username, username, sizeof(new_node->client.username) - 1);
+    new_node->client.player = player;
+    new_node->client.protocol = protocol;
+    new_node->client.delta_updates = delta_updates;
+    new_node->prev = NULL;
+    new_node->next = connected_clients->head;
+    if (connected_clients->head) connected_clients->head->prev = new_node;
+    connected_clients->head = new_node;
+    connected_clients->count++;
+
+    // Raddoppia i bucket quando il fattore di carico supera 1. Se la memoria non basta gli indici restano validi, solo più carichi
+    bool rebuilt = connected_clients->count > connected_clients->buckets && index_rebuild(connected_clients->buckets * 2);
+    if (!rebuilt) index_insert(new_node);   // index_rebuild inserisce già anche il nuovo nodo
+
+    log_info("client.client_add", "Nuovo client connesso: %s (socket %ld)", new_node->client.username, new_node->client.socket);
+    pthread_mutex_unlock(&server->clients_mutex);
+    return true;
+}
+
+/**
+ * Rimuove il client dalla lista di client connessi.
+ * Ritorna verso se il client è stato rimosso, false altrimenti
+ */
+bool client_remove(server_t* server, const ssize_t socket) {
+    pthread_mutex_lock(&server->clients_mutex);
+    
+    client_node_t* current = lookup_socket(socket);
+    if (current) {
+        // Scollega il nodo dalla lista e dagli indici
+        if (current->prev) {
+            current->prev->next = current->next;
+        } else {
+            connected_clients->head = current->next;
+        }
+        if (current->next) current->next->prev = current->prev;
+        index_remove(current);
+        
+        log_info("client.client_remove", "Client disconnesso: %s (socket %ld)", current->client.username, current->client.socket);
+        player_id_t player = current->client.player;
+        slab_free(&client_slab, current);
+
+        connected_clients->count--;
+
+        pthread_mutex_unlock(&server->clients_mutex);
+
+        // L'id resta in uso finché le partite del giocatore non vengono rimosse
+        player_release(player);
+        return true;
+    }
+    
+    pthread_mutex_unlock(&server->clients_mutex);
+
+    log_error("client.client_remove", "Il client che si sta cercando di rimuovere non esiste");
+    return false;
+}
+
+/**
+ * Cerca la in numero di socket del client in base all'username (univoco) del player. 
+ * Ritorna il numero della socket a cui è connesso il client se il player esiste, -1 altrimenti 
+ */
+ssize_t find_client_by_username(server_t* server, const char* username) {
+    if (strlen(username) == 0){
+        log_error("client.find_client_by_username", "Il nome del giocatore non valido");
+        return -1;
+    }
+
+    pthread_mutex_lock(&server->clients_mutex);
+    
+    client_t* client = client_lookup_username(username);
+    if (client) {
+        ssize_t socket = client->socket;
+        pthread_mutex_unlock(&server->clients_mutex);
+
+        return socket;
+    }
+    
+    pthread_mutex_unlock(&server->clients_mutex);
+    log_error("client.find_client_by_username", "Il client associato giocatore %s non esiste", username);
+    return -1;
+}
+
+/**
+ * Cerca l'id del player in base al numero di socket.
+ * Ritorna l'id del player se esiste, PLAYER_NONE altrimenti
+ */
+player_id_t find_player_by_client(server_t* server, const ssize_t sock) {
+    if (sock == -1){
+        log_error("client.find_player_by_client", "Client non valido");
+        return PLAYER_NONE;
+    }
+
+    pthread_mutex_lock(&server->clients_mutex);
+
+    client_node_t* node = lookup_socket(sock);
+    player_id_t player = node ? node->client.player : PLAYER_NONE;
+
+    pthread_mutex_unlock(&server->clients_mutex);
+
+    if (player == PLAYER_NONE) log_error("client.find_player_by_client", "Il client %ld non esiste", sock);
+    return player;
+}
+
+/**
+ * Cerca il formato dei messaggi scelto dal client connesso alla socket sock.
+ * Ritorna il formato del client, PROTOCOL_JSON se il client non ha ancora effettuato il login
+ */
+client_protocol_t find_protocol_by_client(server_t* server, const ssize_t sock) {
+    pthread_mutex_lock(&server->clients_mutex);
+
+    client_node_t* node = lookup_socket(sock);
+    client_protocol_t protocol = node ? node->client.protocol : PROTOCOL_JSON;
+
+    pthread_mutex_unlock(&server->clients_mutex);
+    return protocol;
+}
+
+/**
+ * Verifica se l'username è univoco. 
+ * Ritorna vero se l'username è univoco, false altrimenti
+ */
+bool is_username_unique(server_t* server, const char* username) {
+    if (!username) return false;
+
+    pthread_mutex_lock(&server->clients_mutex);
+    bool unique = client_lookup_username(username) == NULL;
+    pthread_mutex_unlock(&server->clients_mutex);
+
+    return unique;
+}
+
+/**
+ * Cerca il client connesso con l'username indicato. Da chiamare con clients_mutex acquisito.
+ * Ritorna il client se esiste, NULL altrimenti
+ */
+client_t* client_lookup_username(const char* username) {
+    client_node_t* current = connected_clients->by_username[username_hash(username) & (connected_clients->buckets - 1)];
+    while (current) {
+        if (strcmp(current->client.username, username) == 0) {
+            return &current->client;
+        }
+        current = current->next_by_username;
+    }
+    return NULL;
+}
+
+/**
+ * Hash FNV-1a dell'username
+ */
+size_t username_hash(const char* username) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char* c = (const unsigned char*)username; *c; c++) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
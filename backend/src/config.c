@@ -0,0 +1,203 @@
+#include "config.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+#define CONFIG_LINE_SIZE 256
+
+//============ METODI PRIVATI ==================//
+/**
+ * Converte value in un intero senza segno.
+ * Ritorna true se value è un numero valido, false altrimenti
+ */
+static bool parse_size(const char* value, size_t* out) {
+    if (!value || *value == '\0' || *value == '-') return false;
+
+    char* end;
+    errno = 0;
+    unsigned long long parsed = strtoull(value, &end, 10);
+    if (errno != 0 || *end != '\0') return false;
+
+    *out = (size_t)parsed;
+    return true;
+}
+
+/**
+ * Rimuove gli spazi iniziali e finali della stringa, modificandola sul posto
+ */
+static char* trim(char* text) {
+    while (isspace((unsigned char)*text)) text++;
+
+    char* end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+
+    return text;
+}
+
+/**
+ * Stampa le opzioni disponibili
+ */
+static void print_usage(const char* program) {
+    printf("Uso: %s [opzioni]\n", program);
+    printf("  --config FILE                 file di configurazione con righe \"chiave = valore\"\n");
+    printf("  --port N                      porta di ascolto (default: %d)\n", DEFAULT_PORT);
+    printf("  --mode threads|epoll|reuseport  modello di gestione delle connessioni (default: threads)\n");
+    printf("  --workers N                   worker delle modalità epoll e reuseport (default: uno per core, 0 = nessuno)\n");
+    printf("  --queue-size N                richieste massime in coda per i worker (default: %d)\n", DEFAULT_QUEUE_SIZE);
+    printf("  --io epoll|uring              backend di I/O dei reactor (default: epoll)\n");
+    printf("  --listeners N                 socket di ascolto in modalità reuseport (default: una per core)\n");
+    printf("  --max-clients N               client connessi contemporaneamente (default: %d)\n", DEFAULT_MAX_CLIENTS);
+    printf("  --max-games N                 partite presenti contemporaneamente (default: %d)\n", DEFAULT_MAX_GAMES);
+    printf("  --backlog N                   connessioni in attesa di accept (default: %d)\n", DEFAULT_BACKLOG);
+    printf("  --output-high-water N         byte in uscita per client oltre i quali un client lento viene disconnesso (default: %d)\n", DEFAULT_OUTPUT_HIGH_WATER);
+    printf("  --output-limit N              byte massimi in uscita per client (default: %d)\n", DEFAULT_OUTPUT_LIMIT);
+    printf("  --log-level error|info|debug  messaggi di log scritti, debug include il contenuto dei messaggi inviati (default: info)\n");
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Imposta un'opzione di configurazione del server a partire dal nome (senza "--") e dal valore testuale.
+ * Ritorna true se l'opzione esiste e il valore è valido, false altrimenti
+ */
+bool config_set(server_t* server, const char* key, const char* value) {
+    size_t number;
+
+    if (strcmp(key, "mode") == 0) {
+        if (strcmp(value, "threads") == 0) {
+            server->mode = SERVER_MODE_THREADS;
+        } else if (strcmp(value, "epoll") == 0) {
+            server->mode = SERVER_MODE_EPOLL;
+        } else if (strcmp(value, "reuseport") == 0) {
+            server->mode = SERVER_MODE_REUSEPORT;
+        } else {
+            log_error("config.config_set", "Modalità %s non valida, usare threads, epoll oppure reuseport", value);
+            return false;
+        }
+        return true;
+    }
+
+    if (strcmp(key, "io") == 0) {
+        if (strcmp(value, "epoll") == 0) {
+            server->io_backend = IO_BACKEND_EPOLL;
+        } else if (strcmp(value, "uring") == 0) {
+            server->io_backend = IO_BACKEND_URING;
+        } else {
+            log_error("config.config_set", "Backend di I/O %s non valido, usare epoll oppure uring", value);
+            return false;
+        }
+        return true;
+    }
+
+    if (strcmp(key, "log-level") == 0) {
+        if (strcmp(value, "error") == 0) {
+            server->log_level = LOG_LEVEL_ERROR;
+        } else if (strcmp(value, "info") == 0) {
+            server->log_level = LOG_LEVEL_INFO;
+        } else if (strcmp(value, "debug") == 0) {
+            server->log_level = LOG_LEVEL_DEBUG;
+        } else {
+            log_error("config.config_set", "Livello di log %s non valido, usare error, info oppure debug", value);
+            return false;
+        }
+        return true;
+    }
+
+    if (!parse_size(value, &number)) {
+        log_error("config.config_set", "Valore %s non valido per l'opzione %s", value, key);
+        return false;
+    }
+
+    if (strcmp(key, "port") == 0 && number > 0 && number <= 65535) {
+        server->address.sin_port = htons((uint16_t)number);
+    } else if (strcmp(key, "workers") == 0) {
+        server->workers = number;
+    } else if (strcmp(key, "queue-size") == 0 && number > 0) {
+        server->queue_size = number;
+    } else if (strcmp(key, "listeners") == 0) {
+        server->listeners = number;
+    } else if (strcmp(key, "max-clients") == 0 && number > 0) {
+        server->max_clients = number;
+    } else if (strcmp(key, "max-games") == 0 && number > 0) {
+        server->max_games = number;
+    } else if (strcmp(key, "backlog") == 0 && number > 0 && number <= INT32_MAX) {
+        server->backlog = (int)number;
+    } else if (strcmp(key, "output-high-water") == 0 && number > 0) {
+        server->output_high_water = number;
+    } else if (strcmp(key, "output-limit") == 0 && number > 0) {
+        server->output_limit = number;
+    } else {
+        log_error("config.config_set", "Opzione %s non riconosciuta o valore %s fuori dai limiti", key, value);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Legge un file di configurazione composto da righe "chiave = valore"; le righe vuote e quelle che iniziano con # vengono ignorate.
+ * Ritorna true se tutte le opzioni sono valide, false altrimenti
+ */
+bool config_load_file(server_t* server, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        log_error("config.config_load_file", "Impossibile aprire il file di configurazione %s", path);
+        return false;
+    }
+
+    char line[CONFIG_LINE_SIZE];
+    int line_number = 0;
+    bool valid = true;
+
+    while (valid && fgets(line, sizeof(line), file)) {
+        line_number++;
+
+        char* content = trim(line);
+        if (*content == '\0' || *content == '#') continue;
+
+        char* separator = strchr(content, '=');
+        if (!separator) {
+            log_error("config.config_load_file", "Riga %d di %s non valida, atteso \"chiave = valore\"", line_number, path);
+            valid = false;
+            break;
+        }
+
+        *separator = '\0';
+        valid = config_set(server, trim(content), trim(separator + 1));
+    }
+
+    fclose(file);
+    return valid;
+}
+
+/**
+ * Legge le opzioni da riga di comando nella forma "--chiave valore". L'opzione --config carica un file
+ * di configurazione: le opzioni che la seguono sulla riga di comando hanno la precedenza.
+ * Ritorna true se le opzioni sono valide, false altrimenti
+ */
+bool config_load_args(server_t* server, int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0 || i + 1 >= argc) {
+            log_error("config.config_load_args", "Opzione %s non riconosciuta o senza valore", argv[i]);
+            print_usage(argv[0]);
+            return false;
+        }
+
+        const char* key = argv[i] + 2;
+        const char* value = argv[++i];
+
+        bool valid = strcmp(key, "config") == 0 ? config_load_file(server, value) : config_set(server, key, value);
+        if (!valid) {
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
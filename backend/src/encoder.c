@@ -0,0 +1,149 @@
+#include "encoder.h"
+
+#include <stdint.h>
+#include <string.h>
+
+//============ METODI PRIVATI ==================//
+/**
+ * Verifica che text sia UTF-8 valido con le stesse regole di jansson: niente sequenze troncate o sovrabbondanti,
+ * surrogati o codici oltre U+10FFFF.
+ * Ritorna true se la stringa è valida, false altrimenti
+ */
+static bool is_valid_utf8(const unsigned char* text) {
+    while (*text) {
+        unsigned char first = *text;
+        size_t size;
+        uint32_t value;
+
+        if (first < 0x80) {
+            text++;
+            continue;
+        } else if (first >= 0xC2 && first <= 0xDF) {
+            size = 2;
+            value = first & 0x1F;
+        } else if (first >= 0xE0 && first <= 0xEF) {
+            size = 3;
+            value = first & 0x0F;
+        } else if (first >= 0xF0 && first <= 0xF4) {
+            size = 4;
+            value = first & 0x07;
+        } else {
+            return false;
+        }
+
+        for (size_t i = 1; i < size; i++) {
+            if ((text[i] & 0xC0) != 0x80) return false;
+            value = (value << 6) | (text[i] & 0x3F);
+        }
+
+        if ((size == 3 && value < 0x800) || (size == 4 && value < 0x10000) ||
+            value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF)) {
+            return false;
+        }
+
+        text += size;
+    }
+
+    return true;
+}
+
+/**
+ * Scrive text tra virgolette sostituendo i caratteri che jansson serializza con un escape.
+ * text deve essere UTF-8 valido
+ */
+static void write_string(encoder_t* encoder, const char* text) {
+    static const char hex[] = "0123456789ABCDEF";
+    encoder_raw(encoder, "\"", 1);
+
+    // I tratti senza caratteri da sostituire vengono copiati in un'unica volta
+    const char* start = text;
+    for (const char* current = text; *current; current++) {
+        unsigned char c = (unsigned char)*current;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        encoder_raw(encoder, start, current - start);
+        start = current + 1;
+
+        switch (c) {
+            case '"':  encoder_raw(encoder, "\\\"", 2); break;
+            case '\\': encoder_raw(encoder, "\\\\", 2); break;
+            case '\b': encoder_raw(encoder, "\\b", 2); break;
+            case '\f': encoder_raw(encoder, "\\f", 2); break;
+            case '\n': encoder_raw(encoder, "\\n", 2); break;
+            case '\r': encoder_raw(encoder, "\\r", 2); break;
+            case '\t': encoder_raw(encoder, "\\t", 2); break;
+            default: {
+                char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F] };
+                encoder_raw(encoder, escape, sizeof(escape));
+            }
+        }
+    }
+
+    encoder_raw(encoder, start, strlen(start));
+    encoder_raw(encoder, "\"", 1);
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Prepara l'encoder a scrivere nel buffer data di capacity byte
+ */
+void encoder_init(encoder_t* encoder, char* data, size_t capacity) {
+    encoder->data = data;
+    encoder->length = 0;
+    encoder->capacity = capacity;
+    encoder->overflow = false;
+}
+
+/**
+ * Scrive length byte così come sono, ad esempio chiavi e punteggiatura o json già serializzato
+ */
+void encoder_raw(encoder_t* encoder, const char* bytes, size_t length) {
+    if (encoder->overflow || length > encoder->capacity - encoder->length) {
+        encoder->overflow = true;
+        return;
+    }
+
+    memcpy(encoder->data + encoder->length, bytes, length);
+    encoder->length += length;
+}
+
+/**
+ * Scrive un intero in notazione decimale
+ */
+void encoder_integer(encoder_t* encoder, long long value) {
+    char digits[24];
+    size_t position = sizeof(digits);
+
+    // Il valore assoluto è calcolato senza segno, così che anche LLONG_MIN sia rappresentabile
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    do {
+        digits[--position] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    if (value < 0) digits[--position] = '-';
+
+    encoder_raw(encoder, digits + position, sizeof(digits) - position);
+}
+
+/**
+ * Scrive text come stringa json tra virgolette, con gli stessi escape di jansson.
+ * Ritorna false senza scrivere nulla se text non è UTF-8 valido (json_string ritornerebbe NULL), true altrimenti
+ */
+bool encoder_string(encoder_t* encoder, const char* text) {
+    if (!text || !is_valid_utf8((const unsigned char*)text)) return false;
+
+    write_string(encoder, text);
+    return true;
+}
+
+/**
+ * Scrive un campo stringa preceduto da key (chiave già racchiusa tra virgolette, con i due punti e l'eventuale virgola).
+ * Come json_object_set_new con un valore NULL, il campo viene omesso se text non è UTF-8 valido
+ */
+void encoder_string_field(encoder_t* encoder, const char* key, const char* text) {
+    if (!text || !is_valid_utf8((const unsigned char*)text)) return;
+
+    encoder_raw(encoder, key, strlen(key));
+    write_string(encoder, text);
+}
@@ -0,0 +1,195 @@
+#include "frame.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "logger.h"
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Alloca un frame in grado di contenere fino a capacity byte di json, da scrivere a partire da frame_payload
+ * e da completare con frame_finish. Ritorna il frame con un riferimento, NULL in caso di errore
+ */
+frame_t* frame_alloc(size_t capacity) {
+    if (capacity > UINT32_MAX) return NULL;
+
+    frame_t* frame = malloc(sizeof(frame_t) + FRAME_HEADER_SIZE + capacity);
+    if (!frame) {
+        log_error("frame.frame_alloc", "Impossibile allocare memoria per il messaggio");
+        return NULL;
+    }
+
+    atomic_init(&frame->refs, 1);
+    frame->length = FRAME_HEADER_SIZE + capacity;
+    return frame;
+}
+
+/**
+ * Completa un frame ottenuto da frame_alloc scrivendo il prefisso per un json di length byte
+ */
+void frame_finish(frame_t* frame, size_t length) {
+    uint32_t net_len = htonl((uint32_t)length);
+    memcpy(frame->bytes, &net_len, FRAME_HEADER_SIZE);
+    frame->length = FRAME_HEADER_SIZE + length;
+}
+
+/**
+ * Crea un frame a partire dal json già serializzato payload di length byte.
+ * Ritorna il frame con un riferimento, NULL in caso di errore
+ */
+frame_t* frame_create(const char* payload, size_t length) {
+    if (!payload) return NULL;
+
+    frame_t* frame = frame_alloc(length);
+    if (!frame) return NULL;
+
+    memcpy(frame->bytes + FRAME_HEADER_SIZE, payload, length);
+    frame_finish(frame, length);
+    return frame;
+}
+
+/**
+ * Crea un frame serializzando json con JSON_COMPACT.
+ * Ritorna il frame con un riferimento, NULL in caso di errore
+ */
+frame_t* frame_from_json(json_t* json) {
+    if (!json) return NULL;
+
+    char* json_str = json_dumps(json, JSON_COMPACT);
+    if (!json_str) {
+        log_error("frame.frame_from_json", "Errore serializzazione del messaggio json");
+        return NULL;
+    }
+
+    frame_t* frame = frame_create(json_str, strlen(json_str));
+    free(json_str);
+    return frame;
+}
+
+/**
+ * Acquisisce un riferimento al frame. Ritorna il frame stesso
+ */
+frame_t* frame_retain(frame_t* frame) {
+    if (frame) atomic_fetch_add_explicit(&frame->refs, 1, memory_order_relaxed);
+    return frame;
+}
+
+/**
+ * Rilascia un riferimento al frame, liberandolo se era l'ultimo
+ */
+void frame_release(frame_t* frame) {
+    if (!frame) return;
+
+    if (atomic_fetch_sub_explicit(&frame->refs, 1, memory_order_acq_rel) == 1) {
+        free(frame);
+    }
+}
+
+/**
+ * Ritorna il json serializzato contenuto nel frame, senza prefisso
+ */
+char* frame_payload(frame_t* frame) {
+    return frame->bytes + FRAME_HEADER_SIZE;
+}
+
+/**
+ * Ritorna la lunghezza del json serializzato contenuto nel frame, senza prefisso
+ */
+size_t frame_payload_length(const frame_t* frame) {
+    return frame->length - FRAME_HEADER_SIZE;
+}
+
+/**
+ * Inizializza un buffer di ricezione vuoto che accetta messaggi lunghi al più max_payload byte
+ */
+void frame_reader_init(frame_reader_t* reader, size_t max_payload) {
+    reader->data = NULL;
+    reader->start = 0;
+    reader->length = 0;
+    reader->capacity = 0;
+    reader->max_payload = max_payload;
+}
+
+/**
+ * Prepara lo spazio libero per la lettura successiva, spostando in testa il frame incompleto e
+ * ingrandendo il buffer se il frame non ci sta per intero. I messaggi estratti in precedenza non sono più validi.
+ * Ritorna il puntatore allo spazio libero e ne scrive la dimensione in space, NULL in caso di errore di allocazione
+ */
+char* frame_reader_space(frame_reader_t* reader, size_t* space) {
+    size_t pending = reader->length - reader->start;
+
+    if (reader->start > 0) {
+        memmove(reader->data, reader->data + reader->start, pending);
+        reader->start = 0;
+        reader->length = pending;
+    }
+
+    // Un buffer ingrandito da un messaggio molto lungo non resta allocato per tutta la vita della connessione
+    if (pending == 0 && reader->capacity > FRAME_READER_SHRINK) {
+        free(reader->data);
+        reader->data = NULL;
+        reader->capacity = 0;
+    }
+
+    size_t needed = FRAME_READ_CHUNK;
+    if (pending >= FRAME_HEADER_SIZE) {
+        uint32_t net_len;
+        memcpy(&net_len, reader->data, sizeof(net_len));
+
+        size_t frame_size = FRAME_HEADER_SIZE + (size_t)ntohl(net_len);
+        if (frame_size > needed) needed = frame_size;
+    }
+
+    if (needed > reader->capacity) {
+        char* data = realloc(reader->data, needed);
+        if (!data) {
+            log_error("frame.frame_reader_space", "Impossibile allocare memoria per il buffer di ricezione");
+            return NULL;
+        }
+        reader->data = data;
+        reader->capacity = needed;
+    }
+
+    *space = reader->capacity - reader->length;
+    return reader->data + reader->length;
+}
+
+/**
+ * Registra received byte letti nello spazio restituito da frame_reader_space
+ */
+void frame_reader_commit(frame_reader_t* reader, size_t received) {
+    reader->length += received;
+}
+
+/**
+ * Estrae il prossimo frame completo presente nel buffer, scrivendo in payload e payload_len il messaggio
+ * senza prefisso. Il messaggio resta valido fino alla successiva frame_reader_space.
+ * Ritorna 1 se un frame è stato estratto, 0 se servono altri dati, -1 se la lunghezza del frame non è valida
+ */
+int frame_reader_next(frame_reader_t* reader, const char** payload, size_t* payload_len) {
+    size_t pending = reader->length - reader->start;
+    if (pending < FRAME_HEADER_SIZE) return 0;
+
+    uint32_t net_len;
+    memcpy(&net_len, reader->data + reader->start, sizeof(net_len));
+    size_t length = ntohl(net_len);
+
+    if (length == 0 || length > reader->max_payload) return -1;
+    if (pending < FRAME_HEADER_SIZE + length) return 0;
+
+    *payload = reader->data + reader->start + FRAME_HEADER_SIZE;
+    *payload_len = length;
+    reader->start += FRAME_HEADER_SIZE + length;
+    return 1;
+}
+
+/**
+ * Libera la memoria del buffer di ricezione
+ */
+void frame_reader_free(frame_reader_t* reader) {
+    free(reader->data);
+    frame_reader_init(reader, reader->max_payload);
+}
@@ -1,650 +1,1107 @@
-#include "game.h"
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <netinet/in.h>
-#include <sys/socket.h>
-#include <jansson.h>
-#include <pthread.h>
-#include <stdbool.h>
-
-#include "messages.h"
-#include "client.h"
-
-game_list_t* game_list = NULL;
-
-//============ METODI PRIVATI ==================//
-/**
- * Alloca un nuovo nodo per la struttura game_list_t
- * Ritorna un nodo di tipo game_t se è stato possibile allocare memoria, NULL altrimenti
- */
-game_t* new_node(const char* player1){
-    game_t* new_game = (game_t*)malloc(sizeof(game_t));
-    if(!new_game){
-        printf("[Errore - game.new_node] - Impossibile allocare memoria per una partita\n");
-        return NULL;
-    }
-
-    new_game->id = game_list->count;
-    strncpy(new_game->player1, player1, sizeof(new_game->player1));
-    new_game->player2[0] = '\0';
-
-    memset(new_game->board, 0, sizeof(new_game->board));
-    
-    strncpy(new_game->turn, player1, sizeof(new_game->turn));
-    new_game->state = GAME_WAITING;
-    new_game->winner[0] = '\0' ; 
-    new_game->rematch = -1;
-
-    return new_game;
-}
-
-/**
- * Aggiunge una partita alla lista delle partite presenti nel server
- * Ritorna true se il client è stato aggiunto correttamente, false altrimenti
- */
-bool game_add(server_t* server, game_t* game){
-    pthread_mutex_lock(&server->games_mutex);
-    game_node_t* new_node = (game_node_t*)malloc(sizeof(game_node_t));
-    if (!new_node) {
-        printf("[Errore - game.game_add] - Impossibile allocare memoria per aggiungere una partita alla lista delle partite presenti\n");
-        pthread_mutex_unlock(&server->games_mutex);
-        return false;
-    }
-    
-    new_node->game = *game;
-    new_node->next = game_list->head;
-    game_list->head = new_node;
-    game_list->count++;
-    
-    pthread_mutex_unlock(&server->games_mutex);
-    return true;
-}
-
-/**
- * Rimuove una partita dalla lista delle partite presenti nel server
- * Ritorna true se il client è stato aggiunto correttamente, false altrimenti
- */
-bool game_remove(server_t* server, const size_t id) {  
-    pthread_mutex_lock(&server->games_mutex);
-
-    game_node_t** pp = &game_list->head;
-    game_node_t* current = game_list->head;
-    
-    while (current) {
-        if (current->game.id == id) {
-            *pp = current->next;
-            free(current);
-
-            game_list->count--;
-            
-            pthread_mutex_unlock(&server->games_mutex);
-            return true;
-        }
-        pp = &current->next;
-        current = current->next;
-    }
-    
-    printf("[Errore - client.client_remove] Il client che si sta cercando di rimuovere non esiste\n");
-    pthread_mutex_unlock(&server->games_mutex);
-    return false;
-}
-
-/**
- * Casta l'enum in stringa
- */
-const char* game_state_to_string(game_state_t state) {
-    switch (state) {
-        case GAME_WAITING: return "GAME_WAITING";
-        case GAME_ONGOING: return "GAME_ONGOING";
-        case GAME_OVER:    return "GAME_OVER";
-        default:           return "unknown";
-    }
-}
-
-/**
- * Verifica se l'avversario è ancora disponibile per giocare la partita.
- * Ritorna true se è ancora disponibile, false altrimenti
- */
-bool is_opponent_available(server_t* server, const char* player2, bool already_locked){
-    if (!already_locked) pthread_mutex_lock(&server->games_mutex);
-
-    game_node_t *curr = game_list->head;
-    
-    while(curr){
-        game_t game = curr->game;
-        if (game.state == GAME_ONGOING){
-            if(strcmp(game.player1, player2) == 0 || strcmp(game.player2, player2) == 0){
-                printf("[Info - game.is_opponent_available] %s è gia impegnato in un'altra partita\n", player2);
-                
-                if (!already_locked) pthread_mutex_unlock(&server->games_mutex);
-                return false;
-            }
-        }
-        curr = curr->next;
-    }
-
-    if (!already_locked) pthread_mutex_unlock(&server->games_mutex);
-    return true;
-}
-
-
-/**
- * Verifica se è stato fatto un tris.
- * Ritorna 1 se è stato fatto tris, 0 pareggio, -1 se la partita è ancora in corso
- */
-short check_tris(game_t* game){
-    // Controlla righe, colonne e diagonali per una vittoria
-    for (int i = 0; i < 3; i++) {
-        // Controllo righe
-        if (game->board[i][0] != '\0' && game->board[i][0] == game->board[i][1] && game->board[i][1] == game->board[i][2]) {
-            return 1;  // Vincitore
-        }
-        // Controllo colonne
-        if (game->board[0][i] != '\0' && game->board[0][i] == game->board[1][i] && game->board[1][i] == game->board[2][i]) {
-            return 1;  // Vincitore
-        }
-    }
-
-    // Controllo diagonali
-    if (game->board[0][0] != '\0' && game->board[0][0] == game->board[1][1] && game->board[1][1] == game->board[2][2]) {
-        return 1;  // Vincitore
-    }
-    if (game->board[0][2] != '\0' && game->board[0][2] == game->board[1][1] && game->board[1][1] == game->board[2][0]) {
-        return 1;  // Vincitore
-    }
-
-    // Controlla pareggio
-    bool filled = true;
-    for (int i = 0; i < 3; i++) {
-        for (int j = 0; j < 3; j++) {
-            if (game->board[i][j] == '\0') {
-                filled = false;
-                break;
-            }
-        }
-    }
-
-    if (filled) {
-        game->state = GAME_OVER;
-        return 0;  // Pareggio
-    }
-
-    return -1;  // Continua a giocare
-}
-
-//============ INTERFACCIA PUBBLICA ==================//
-
-/**
- * Inizializza le strutture utili per gestire le partite esistenti
- */
-void game_init(server_t* server) {
-    pthread_mutex_lock(&server->games_mutex);
-
-    if (game_list == NULL) {
-        game_list = (game_list_t*)malloc(sizeof(game_list_t));
-        if (!game_list) {
-            printf("[Errore - game.game_init] Impossibile allocare memoria per la lista delle partite\n");
-            exit(EXIT_FAILURE);
-        }
-        
-        game_list->head = NULL;
-        game_list->count = 0;
-    }
-
-    pthread_mutex_unlock(&server->games_mutex);
-}
-
-/**
- * Libera la memoria allocata per gestire le partite esistenti 
- */
-void game_cleanup(server_t* server) {
-    pthread_mutex_lock(&server->games_mutex);
-    
-    game_node_t* current = game_list->head;
-    while (current) {
-        game_node_t* next = current->next;
-        free(current);
-        current = next;
-    }
-    
-    free(game_list);
-    game_list = NULL;
-    
-    pthread_mutex_unlock(&server->games_mutex);
-}
-
-/**
- * Crea una nuova partita.
- * Ritorna l'id della partita creata, altrimenti -1 in caso di errore 
- */
-ssize_t create_game(server_t* server, const char* player1) {
-    pthread_mutex_lock(&server->games_mutex);
-
-    // Controllo disponibilità slot partite 
-    if(game_list->count >= MAX_GAMES){
-        pthread_mutex_unlock(&server->games_mutex);
-        printf("[Errore - game.create_game] Impossibile creare una partita il server è al momento pieno\n");
-        return -1;
-    }
-
-    game_t* new_game = new_node(player1);
-    if(!new_game){
-        pthread_mutex_unlock(&server->games_mutex);
-        return -1;
-    }
-
-    pthread_mutex_unlock(&server->games_mutex);
-    if(!game_add(server, new_game)){
-        free(new_game);
-        return -1;
-    }
-
-    ssize_t id = new_game->id;
-    free(new_game);
-    
-    return id;
-}
-
-/**
- * Invia al creatore della partita la richiesta di join da parte di un utente per una determinata partita. Ritorna:
- * - 0 se la richiesta è avvenuta con successo,
- * - -1 se game_id non è valido,
- * - -2 se la partita non è più disponibile
- * - -3 la partita è già stata avviata
- */
-short request_join_game(server_t* server, size_t game_id, const char *player2) {
-    if (game_id >= game_list->count) {
-        printf("[Errore - game.request_join_game] Id partita inesistente\n");
-        return -1;
-    }
-
-    pthread_mutex_lock(&server->games_mutex);
-    game_node_t *curr = game_list->head;
-    
-    while(curr){
-        if(curr->game.id == game_id){
-
-            // Verifica che la partita sia in stato di "attesa"
-            if (curr->game.state == GAME_OVER) {
-                pthread_mutex_unlock(&server->games_mutex);
-                
-                printf("[Errore - game.request_join_game] La parita non esiste più\n");
-                return -2;
-            }
-
-            if (curr->game.state == GAME_ONGOING) {
-                pthread_mutex_unlock(&server->games_mutex);
-                
-                printf("[Errore - game.request_join_game] La parita è gia stata avviata più\n");
-                return -3;
-            }
-
-            // Invia la richiesta di join al creatore della partita (player1)
-            json_t* data = json_object();
-            json_object_set_new(data, "game_id", json_integer(game_id));
-            json_object_set_new(data, "player2", json_string(player2));
-            
-            json_t* request = create_request("join_request", "Nuova richiesta di join", data);
-            send_to_player(server, request, curr->game.player1, true);
-            
-            json_decref(request);
-            pthread_mutex_unlock(&server->games_mutex);
-            return 0;
-        }
-
-        curr = curr->next;
-    }
-
-    pthread_mutex_unlock(&server->games_mutex);
-    printf("[Errore - game.request_join_game] Id partita inesistente\n");
-    return -1; 
-   
-}
-
-/**
- * Invia all'avversario la notifica che la partita è stata accettata e che sta per essere avviata.
- * Ritorna 0 se l'invio è avvenuto con successo, -1 se game_id non è valido, 
- * -2 se la partita non è più disponibile, -4 se l'avversario non è più disponibile
- */
-short accept_join_request(server_t* server, size_t game_id, const char *player2){
-    if (game_id >= game_list->count) {
-        printf("[Errore - game.accept_join_request] Id partita inesistente\n");
-        return -1;
-    }
-
-    if(find_client_by_username(server,player2) == -1){
-        return -5;
-        printf("[Errore - game.accept_join_request] Player disconnesso\n");
-    }
-
-    pthread_mutex_lock(&server->games_mutex);
-    game_node_t *curr = game_list->head;
-    
-    while(curr){
-        game_t *game = &curr->game;
-        if(game->id == game_id){
-            
-            // Verifica che la partita sia in stato di "attesa"
-            if (game->state != GAME_WAITING) {
-                pthread_mutex_unlock(&server->games_mutex);
-                printf("[Errore - game.accept_join_request] La parita non esiste più\n");
-                return -2;
-            }
-
-            // Verifico se l'avversario é impegnato in un'altra partita
-            if(!is_opponent_available(server, player2, true)){
-                printf("[Errore - game.accept_join_request] Avversario impegnato in un'altra partita\n");
-                return -4; 
-            }
-
-            // Aggiungi il secondo giocatore alla partita
-            strncpy(game->player2, player2, sizeof(game->player2) - 1);
-            game->state = GAME_ONGOING;
-            
-             // Notifica l'avversario che la partita sta stata accettata con successo e che può essere avviata
-            json_t* request = create_request("accept_join", "Richiesta accettata", NULL);
-            send_to_player(server, request, curr->game.player2, true);
-            json_decref(request);
-
-            json_t* data = create_json(server, game->id, true);
-            request = create_request("game_started", "La partita sta per cominciare", data);
-            send_to_player(server, request, curr->game.player2, true);
-
-            json_decref(request);
-            pthread_mutex_unlock(&server->games_mutex);
-            return 0;
-        }
-
-        curr = curr->next;
-    }
-
-    pthread_mutex_unlock(&server->games_mutex);
-    return -1;  // Partita non trovata
-}
-
-/**
- * Metodo che gestisce la mossa, quindi, aggiorna lo stato della board, verifica se è stato fatto un tris e cambia il turno.
- * Ritorna 0 se la mossa è stata fatta con successo, -1 se la parita non è nello stato GAME_ONGOING
- */
-short make_move(server_t* server, game_t* game, const char *username, int x, int y) {
-    pthread_mutex_lock(&server->games_mutex);
-    
-    if(game->state != GAME_ONGOING){
-        pthread_mutex_unlock(&server->games_mutex);
-        printf("[Errore - game.make_move] La partita non è stata ancora avviata\n");
-        return -1;
-    }
-
-    // Verifica che sia il turno del giocatore che ha effettuato la mossa
-    if (strcmp(game->turn, username) != 0) {
-        pthread_mutex_unlock(&server->games_mutex);
-        printf("[Errore - game.make_move] Non è il turno del giocatore %s\n", username);
-        return -2;
-    }
-
-    // Esegui la mossa
-    if(game->board[x][y] != '\0'){
-        pthread_mutex_unlock(&server->games_mutex);
-        printf("[Errore - game.make_move] Cella già occupata\n");
-        return -3;
-    }
-
-    char symbol = (strcmp(game->turn, game->player1) == 0) ? 'X' : 'O';
-    game->board[x][y] = symbol;
-
-    switch (check_tris(game)){
-        case -1:
-            // Cambia il turno
-            strncpy(game->turn, (strcmp(game->turn, game->player1) == 0) ? game->player2 : game->player1, 63);
-            break;
-        case 0:
-            // Fine partita in pareggio 
-            game->state = GAME_OVER;
-            break;
-        case 1:
-            // Fine partita con vincitore
-            game->state = GAME_OVER;
-            strncpy(game->winner, username, 63); // Imposta il vincitore
-            break;
-    }
-
-    pthread_mutex_unlock(&server->games_mutex);
-    return 0;
-}
-
-
-/**
- * Cerca una partita a partire dall'id.
- * Ritorna un oggetto di tipo game_t se la partita è stata trovata, NULL altrimenti
- */
-game_t* find_game_by_id(server_t* server,size_t game_id){
-    pthread_mutex_lock(&server->games_mutex);
-    game_node_t *curr = game_list->head;
-    
-    while(curr){
-        game_t* game = &curr->game;
-        if (game->id == game_id){
-            pthread_mutex_unlock(&server->games_mutex);
-            return game;
-        }
-        curr = curr->next;
-    }
-
-    pthread_mutex_unlock(&server->games_mutex);
-    return NULL;
-}
-
-/**
- * Serializza la struttura game_t in json
- */
-json_t* create_json(server_t* server, size_t id, bool already_locked){
-    json_t* msg = json_object();
-    if (!msg) return NULL;
-    
-    if(!already_locked) pthread_mutex_lock(&server->games_mutex);
-    
-    game_node_t* current = game_list->head;
-    game_t* found_game = NULL;
-    
-    // Cerca il gioco
-    while (current && !found_game) {
-        if (current->game.id == id) {
-            found_game = &current->game;
-            break;
-
-        }
-        current = current->next;
-    }
-    
-    if (!found_game) {
-        if(!already_locked) pthread_mutex_unlock(&server->games_mutex);
-        json_decref(msg);
-        return NULL;
-    }
-    
-    // Serializza i dati del gioco
-    json_object_set_new(msg, "game_id", json_integer(found_game->id));
-    json_object_set_new(msg, "player1", json_string(found_game->player1));
-    
-    // Gestione player2
-    if (strlen(found_game->player2) > 0) {
-        json_object_set_new(msg, "player2", json_string(found_game->player2));
-    } else {
-        json_object_set_new(msg, "player2", json_null());
-    }
-    
-    // Serializzazione board
-    json_t* json_board = json_array();
-    if (!json_board){
-        if(!already_locked) pthread_mutex_unlock(&server->games_mutex);
-        json_decref(msg);
-        return NULL;
-    }
-    
-    for (int i = 0; i < 3; i++) {
-        json_t *row = json_array();
-        if (!row){
-            if(!already_locked) pthread_mutex_unlock(&server->games_mutex);
-            json_decref(msg);
-            return NULL;
-        }
-        
-        for (int j = 0; j < 3; j++) {
-            char cell[2] = { found_game->board[i][j] == ' ' ? '\0' : found_game->board[i][j], '\0' };
-            json_t* cell_json = json_string(cell);
-            if (!cell_json || json_array_append_new(row, cell_json) != 0) {
-                if (cell_json){
-                    if(!already_locked) pthread_mutex_unlock(&server->games_mutex);
-                    json_decref(msg);
-                    return NULL;
-                }
-            }
-        }
-
-        json_array_append_new(json_board, row);
-    }
-    json_object_set_new(msg, "board", json_board);
-    
-    // Altri campi
-    json_object_set_new(msg, "turn", json_string(found_game->turn));
-    json_object_set_new(msg, "state", json_string(game_state_to_string(found_game->state)));
-    
-    // Gestione winner
-    if (strlen(found_game->winner) > 0) {
-        json_object_set_new(msg, "winner", json_string(found_game->winner));
-    } else {
-        json_object_set_new(msg, "winner", json_null());
-    }
-    
-    if(!already_locked) pthread_mutex_unlock(&server->games_mutex);
-    return msg;
-}
-
-/**
- * Ritorna un json con tutte le partite create da un giocatore, altrimenti NULL
- */
-json_t* list_games(server_t* server, const char* username) {
-     if (!username) return NULL;
-
-    json_t* games = json_array();
-    if (!games) return NULL;
-
-    pthread_mutex_lock(&server->games_mutex);
-
-    game_node_t* current = game_list->head;
-    while (current) {
-       // Crea una copia dei dati necessari prima di rilasciare il mutex
-        size_t game_id = current->game.id;
-        char player1[64];
-        strncpy(player1, current->game.player1, sizeof(player1));
-        player1[sizeof(player1)-1] = '\0';
-        
-        // Rilascia temporaneamente il mutex per chiamare create_json
-        pthread_mutex_unlock(&server->games_mutex);
-        
-        if (strcmp(player1, username) != 0) {
-            json_t* game = create_json(server, game_id, false);
-            if (game) {
-                json_array_append_new(games, game);
-            }
-        }
-        
-        // Riprendi il lock per la prossima iterazione
-        pthread_mutex_lock(&server->games_mutex);
-        current = current->next;
-    }
-
-    pthread_mutex_unlock(&server->games_mutex);
-    return games;
-}
-
-/**
- * Gestione abbandono partita. Notifica il player in gioco che ha l'avversario ha abbandonato e dunque ha vinto la partita.
- * Ritorna 0 se lo stato della partita e l'invio della notifica vanno a buon fine, -1 se la partita non è in corso, -2 errore invio notifica
- */
-short quit(server_t* server, game_t* game, const char* username){
-    pthread_mutex_lock(&server->games_mutex);
-
-    if(game->state != GAME_ONGOING){
-        printf("[Errore - game.quit] La partita non è in corso\n");
-
-        pthread_mutex_unlock(&server->games_mutex);
-        return -1; // Gioco non in corso
-    }
-
-    // Imposta lo stato della partita a GAME_OVER e assegna il vincitore 
-    game->state = GAME_OVER;
-    if(strcmp(game->player1,username) == 0){
-        strncpy(game->winner, game->player2, 63); // Imposta il vincitore
-    } else {
-        strncpy(game->winner, game->player1, 63); // Imposta il vincitore
-    }
-
-    json_t* request = create_request("quit", "L'avversario ha abbandonato", create_json(server, game->id, true));
-
-    if(!send_to_player(server, request, game->winner, true)){
-
-        // Nel caso di errore dell'invio reimposta lo stato della partita
-        game->state = GAME_ONGOING;
-        game->winner[0] = '\0';
-
-        json_decref(request);
-        pthread_mutex_unlock(&server->games_mutex);
-        return -2;
-    }
-
-    pthread_mutex_unlock(&server->games_mutex);
-    json_decref(request);
-    return 0;
-}
-
-/**
- * Rimuove tutte le partite associate ad un giocatore
- */
-void remove_games_by_username(server_t* server, const char* username, const size_t sock){
-    pthread_mutex_lock(&server->games_mutex);
-     
-    game_node_t** pp = &game_list->head;
-    game_node_t* current = game_list->head;
-    game_node_t* to_free = NULL;
-    
-    int counter = 0;
-    size_t id[MAX_GAMES] = {0};
-
-    while (current) {
-        if (strcmp(current->game.player1, username) == 0) {
-            // Save the ID before freeing
-            id[counter++] = current->game.id;
-            
-            // Unlink the node
-            to_free = current;
-            *pp = current->next;
-            current = current->next;  // Move to next before freeing
-            
-            // Free the node safely
-            memset(&to_free->game, 0, sizeof(game_t));
-            free(to_free);
-            to_free = NULL;
-            
-            game_list->count--;
-        } else {
-            // Only advance pp if we didn't delete
-            pp = &current->next;
-            current = current->next;
-        }
-    }
-
-    pthread_mutex_unlock(&server->games_mutex);
-
-    // Broadcast removed games
-    for (int i = 0; i < counter; i++) {
-        json_t* msg = json_object();
-        json_object_set_new(msg, "game_id", json_integer(id[i]));
-
-        send_broadcast(server, "game_removed", msg, sock, -1);
-        json_decref(msg);
-    }
+#include "game.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <jansson.h>
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "messages.h"
+#include "client.h"
+#include "lobby.h"
+#include "encoder.h"
+#include "logger.h"
+
+game_table_t* game_table = NULL;
+
+// Buffer di game_encode, riusato da ogni serializzazione dello stesso thread
+static _Thread_local char encoded_game[GAME_JSON_MAX];
+static _Thread_local char encoded_delta[GAME_DELTA_MAX];
+
+//============ METODI PRIVATI ==================//
+/**
+ * Cerca la partita con l'id indicato nella tabella. Da chiamare con games_mutex o il lock dello slot acquisito,
+ * altrimenti la partita può essere rimossa subito dopo.
+ * Ritorna la partita se esiste, NULL se l'id non è valido o appartiene a una partita già rimossa
+ */
+static game_t* lookup_game(size_t game_id) {
+    size_t index = game_id % game_table->capacity;
+    size_t generation = game_id / game_table->capacity;
+
+    game_slot_t* slot = &game_table->slots[index];
+    if (!atomic_load(&slot->in_use) || atomic_load(&slot->generation) != generation) return NULL;
+
+    return &slot->game;
+}
+
+/**
+ * Acquisisce il lock dello slot della partita game_id senza passare da games_mutex: in_use e generation
+ * cambiano solo con il lock dello slot acquisito, quindi la verifica dopo il lock è sufficiente.
+ * Ritorna la partita con il lock acquisito, NULL se non esiste
+ */
+static game_t* lock_game_by_id(size_t game_id) {
+    game_slot_t* slot = &game_table->slots[game_id % game_table->capacity];
+
+    pthread_mutex_lock(&slot->lock);
+    game_t* game = lookup_game(game_id);
+    if (!game) pthread_mutex_unlock(&slot->lock);
+
+    return game;
+}
+
+/**
+ * Occupa uno slot libero e vi inizializza una nuova partita. Da chiamare con games_mutex acquisito.
+ * Ritorna la partita creata, NULL se non ci sono slot liberi
+ */
+static game_t* game_alloc(player_id_t player1) {
+    size_t index;
+    if (game_table->free_head != GAME_SLOT_NONE) {
+        index = game_table->free_head;
+        game_table->free_head = game_table->slots[index].next_free;
+    } else if (game_table->used < game_table->capacity) {
+        index = game_table->used++;
+    } else {
+        return NULL;
+    }
+
+    game_slot_t* slot = &game_table->slots[index];
+    pthread_mutex_lock(&slot->lock);
+    slot->next_free = GAME_SLOT_NONE;
+    game_table->count++;
+
+    game_t* new_game = &slot->game;
+    new_game->id = (size_t)atomic_load(&slot->generation) * game_table->capacity + index;
+    new_game->player1 = player1;
+    new_game->player2 = PLAYER_NONE;
+    player_retain(player1);
+
+    new_game->x_mask = 0;
+    new_game->o_mask = 0;
+    
+    new_game->turn = 0;
+    new_game->state = GAME_WAITING;
+    new_game->winner = GAME_WINNER_NONE;
+    new_game->bot = BOT_NONE;
+    new_game->rematch = 0;
+    new_game->seq = 0;
+    new_game->last_cell = 0;
+
+    // La partita diventa visibile a game_get solo dopo essere stata inizializzata
+    atomic_store(&slot->in_use, true);
+    pthread_mutex_unlock(&slot->lock);
+    return new_game;
+}
+
+/**
+ * Rimette lo slot nella pila dei liberi e rilascia gli id dei giocatori della partita. Da chiamare con games_mutex acquisito
+ */
+static void slot_free(size_t index) {
+    game_slot_t* slot = &game_table->slots[index];
+
+    // Nessuno possiede più un riferimento alla partita: i nomi dei giocatori non vengono più letti
+    player_release(slot->game.player1);
+    player_release(slot->game.player2);
+    slot->game.player1 = PLAYER_NONE;
+    slot->game.player2 = PLAYER_NONE;
+
+    atomic_store(&slot->retired, false);
+    slot->next_free = game_table->free_head;
+    game_table->free_head = index;
+}
+
+/**
+ * Rimuove la partita e ne incrementa la generazione, così che il vecchio id non sia più valido. Chi possiede
+ * ancora un riferimento la vede nello stato GAME_OVER; lo slot torna libero con l'ultimo game_put.
+ * Da chiamare con games_mutex e il lock della partita acquisiti
+ */
+static void game_retire(game_t* game) {
+    size_t index = game->id % game_table->capacity;
+    game_slot_t* slot = &game_table->slots[index];
+
+    game->state = GAME_OVER;
+    atomic_store(&slot->in_use, false);
+    atomic_fetch_add(&slot->generation, 1);
+    game_table->count--;
+
+    // retired viene pubblicato prima di leggere refs: un game_put concorrente vede l'uno o l'altro
+    atomic_store(&slot->retired, true);
+    if (atomic_load(&slot->refs) == 0) slot_free(index);
+}
+
+/**
+ * Casta l'enum in stringa
+ */
+const char* game_state_to_string(game_state_t state) {
+    switch (state) {
+        case GAME_WAITING: return "GAME_WAITING";
+        case GAME_ONGOING: return "GAME_ONGOING";
+        case GAME_OVER:    return "GAME_OVER";
+        default:           return "unknown";
+    }
+}
+
+/**
+ * Hash moltiplicativo dell'id del giocatore
+ */
+static size_t hash_player(player_id_t player) {
+    return (size_t)(((uint64_t)player * 11400714819323198485ULL) >> 32);
+}
+
+/**
+ * Cerca le partite del giocatore nell'indice per giocatore. Da chiamare con games_mutex acquisito.
+ * Ritorna l'elemento dell'indice se il giocatore ha partite, NULL altrimenti
+ */
+static player_games_t* player_find(player_id_t player) {
+    player_games_t* current = game_table->players[hash_player(player) & (game_table->player_buckets - 1)];
+    while (current && current->player != player) {
+        current = current->next;
+    }
+    return current;
+}
+
+/**
+ * Raddoppia i bucket dell'indice per giocatore e vi ridistribuisce gli elementi. Da chiamare con games_mutex acquisito.
+ * Se la memoria non basta l'indice resta valido, solo più carico
+ */
+static void player_index_grow(void) {
+    size_t buckets = game_table->player_buckets * 2;
+    player_games_t** players = calloc(buckets, sizeof(player_games_t*));
+    if (!players) return;
+
+    for (size_t i = 0; i < game_table->player_buckets; i++) {
+        player_games_t* current = game_table->players[i];
+        while (current) {
+            player_games_t* next = current->next;
+            player_games_t** bucket = &players[hash_player(current->player) & (buckets - 1)];
+            current->next = *bucket;
+            *bucket = current;
+            current = next;
+        }
+    }
+
+    free(game_table->players);
+    game_table->players = players;
+    game_table->player_buckets = buckets;
+}
+
+/**
+ * Aggiunge la partita game_id a quelle del giocatore. Da chiamare con games_mutex acquisito.
+ * Ritorna true se la partita è stata aggiunta, false in caso di errore di allocazione
+ */
+static bool player_add_game(player_id_t player, size_t game_id) {
+    player_games_t* entry = player_find(player);
+
+    if (!entry) {
+        entry = calloc(1, sizeof(player_games_t));
+        if (!entry) return false;
+
+        entry->player = player;
+        player_games_t** bucket = &game_table->players[hash_player(player) & (game_table->player_buckets - 1)];
+        entry->next = *bucket;
+        *bucket = entry;
+
+        if (++game_table->player_count > game_table->player_buckets) player_index_grow();
+    }
+
+    if (entry->count == entry->capacity) {
+        size_t new_capacity = entry->capacity ? entry->capacity * 2 : 4;
+        size_t* ids = realloc(entry->ids, new_capacity * sizeof(size_t));
+        if (!ids) return false;
+
+        entry->ids = ids;
+        entry->capacity = new_capacity;
+    }
+
+    entry->ids[entry->count++] = game_id;
+    return true;
+}
+
+/**
+ * Rimuove la partita game_id da quelle del giocatore ed elimina il giocatore dall'indice se non ne ha altre.
+ * Da chiamare con games_mutex acquisito
+ */
+static void player_remove_game(player_id_t player, size_t game_id) {
+    player_games_t** pp = &game_table->players[hash_player(player) & (game_table->player_buckets - 1)];
+    while (*pp && (*pp)->player != player) {
+        pp = &(*pp)->next;
+    }
+
+    player_games_t* entry = *pp;
+    if (!entry) return;
+
+    for (size_t i = 0; i < entry->count; i++) {
+        if (entry->ids[i] == game_id) {
+            entry->ids[i] = entry->ids[--entry->count];
+            break;
+        }
+    }
+
+    if (entry->count == 0) {
+        *pp = entry->next;
+        free(entry->ids);
+        free(entry);
+        game_table->player_count--;
+    }
+}
+
+/**
+ * Crea una partita già avviata tra player1 e player2 e la aggiunge alle partite di player1 e, se index_player2,
+ * a quelle di player2. Da chiamare con games_mutex acquisito.
+ * Ritorna la partita con il suo lock acquisito, NULL se il server è pieno o in caso di errore di allocazione
+ */
+static game_t* game_open(server_t* server, player_id_t player1, player_id_t player2, bool index_player2) {
+    game_t* game = game_table->count < server->max_games ? game_alloc(player1) : NULL;
+    if (!game) {
+        log_error("game.game_open", "Impossibile creare una partita il server è al momento pieno");
+        return NULL;
+    }
+
+    if (!player_add_game(player1, game->id) || (index_player2 && !player_add_game(player2, game->id))) {
+        player_remove_game(player1, game->id);
+
+        game_lock(game);
+        game_retire(game);
+        game_unlock(game);
+
+        log_error("game.game_open", "Impossibile allocare memoria per l'indice dei giocatori");
+        return NULL;
+    }
+
+    game_lock(game);
+    game->player2 = player2;
+    game->state = GAME_ONGOING;
+    player_retain(player2);
+    return game;
+}
+
+/**
+ * Verifica se l'avversario è ancora disponibile per giocare la partita.
+ * already_locked indica che il chiamante possiede games_mutex; non deve possedere il lock di alcuna partita.
+ * Ritorna true se è ancora disponibile, false altrimenti
+ */
+bool is_opponent_available(server_t* server, player_id_t player2, bool already_locked){
+    if (!already_locked) pthread_mutex_lock(&server->games_mutex);
+
+    // Solo le partite create o giocate dall'avversario possono impegnarlo
+    player_games_t* entry = player_find(player2);
+    for (size_t i = 0; entry && i < entry->count; i++) {
+        game_t* game = lookup_game(entry->ids[i]);
+        if (!game) continue;
+
+        game_lock(game);
+        bool busy = game->state == GAME_ONGOING;
+        game_unlock(game);
+
+        if (busy) {
+            log_info("game.is_opponent_available", "%s è gia impegnato in un'altra partita", player_name(player2));
+            
+            if (!already_locked) pthread_mutex_unlock(&server->games_mutex);
+            return false;
+        }
+    }
+
+    if (!already_locked) pthread_mutex_unlock(&server->games_mutex);
+    return true;
+}
+
+
+/**
+ * Le otto linee vincenti (tre righe, tre colonne, due diagonali) come maschere sulla bitboard
+ */
+static const uint16_t WIN_MASKS[8] = {
+    0x007, 0x038, 0x1C0,    // Righe
+    0x049, 0x092, 0x124,    // Colonne
+    0x111, 0x054            // Diagonali
+};
+
+/**
+ * Verifica se con la bitboard mask del giocatore che ha appena mosso è stato fatto un tris.
+ * Non modifica la partita: lo stato viene aggiornato dal chiamante in base al risultato.
+ * Ritorna 1 se è stato fatto tris, 0 pareggio, -1 se la partita è ancora in corso
+ */
+short check_tris(const game_t* game, uint16_t mask){
+    for (size_t i = 0; i < sizeof(WIN_MASKS) / sizeof(WIN_MASKS[0]); i++) {
+        if ((mask & WIN_MASKS[i]) == WIN_MASKS[i]) {
+            return 1;  // Vincitore
+        }
+    }
+
+    if ((game->x_mask | game->o_mask) == BOARD_FULL_MASK) {
+        return 0;  // Pareggio
+    }
+
+    return -1;  // Continua a giocare
+}
+
+/**
+ * Occupa la cella (x, y), già verificata libera, con il segno del giocatore di turno, verifica se è stato fatto
+ * un tris e cambia il turno. Da chiamare con il lock della partita acquisito
+ */
+static void apply_move(game_t* game, int x, int y) {
+    uint16_t* mask = game->turn ? &game->o_mask : &game->x_mask;
+    *mask |= BOARD_CELL(x, y);
+    game->last_cell = (uint8_t)(x * BOARD_SIZE + y);
+    game->seq++;
+
+    switch (check_tris(game, *mask)){
+        case -1:
+            // Cambia il turno
+            game->turn ^= 1;
+            break;
+        case 0:
+            // Fine partita in pareggio 
+            game->state = GAME_OVER;
+            break;
+        case 1:
+            // Fine partita con vincitore
+            game->state = GAME_OVER;
+            game->winner = game->turn ? GAME_WINNER_PLAYER2 : GAME_WINNER_PLAYER1; // Imposta il vincitore
+            break;
+    }
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+
+/**
+ * Inizializza le strutture utili per gestire le partite esistenti
+ */
+void game_init(server_t* server) {
+    pthread_mutex_lock(&server->games_mutex);
+
+    if (game_table == NULL) {
+        game_table = (game_table_t*)malloc(sizeof(game_table_t));
+        if (!game_table) {
+            log_error("game.game_init", "Impossibile allocare memoria per la tabella delle partite");
+            exit(EXIT_FAILURE);
+        }
+
+        // Gli slot vengono allocati una sola volta: i puntatori alle partite restano validi per tutta la vita del server
+        game_table->capacity = server->max_games;
+        game_table->slots = (game_slot_t*)calloc(game_table->capacity, sizeof(game_slot_t));
+        if (!game_table->slots) {
+            log_error("game.game_init", "Impossibile allocare memoria per la tabella delle partite");
+            exit(EXIT_FAILURE);
+        }
+        
+        for (size_t i = 0; i < game_table->capacity; i++) {
+            pthread_mutex_init(&game_table->slots[i].lock, NULL);
+        }
+        
+        game_table->count = 0;
+        game_table->used = 0;
+        game_table->free_head = GAME_SLOT_NONE;
+
+        game_table->player_buckets = PLAYER_INDEX_MIN_BUCKETS;
+        game_table->player_count = 0;
+        game_table->players = calloc(game_table->player_buckets, sizeof(player_games_t*));
+        if (!game_table->players) {
+            log_error("game.game_init", "Impossibile allocare memoria per l'indice dei giocatori");
+            exit(EXIT_FAILURE);
+        }
+
+        lobby_init(server);
+    }
+
+    pthread_mutex_unlock(&server->games_mutex);
+}
+
+/**
+ * Libera la memoria allocata per gestire le partite esistenti 
+ */
+void game_cleanup(server_t* server) {
+    pthread_mutex_lock(&server->games_mutex);
+    
+    for (size_t i = 0; i < game_table->capacity; i++) {
+        pthread_mutex_destroy(&game_table->slots[i].lock);
+    }
+    for (size_t i = 0; i < game_table->player_buckets; i++) {
+        player_games_t* current = game_table->players[i];
+        while (current) {
+            player_games_t* next = current->next;
+            free(current->ids);
+            free(current);
+            current = next;
+        }
+    }
+    free(game_table->players);
+    free(game_table->slots);
+    free(game_table);
+    game_table = NULL;
+
+    lobby_cleanup();
+    
+    pthread_mutex_unlock(&server->games_mutex);
+}
+
+/**
+ * Crea una nuova partita.
+ * Ritorna l'id della partita creata, altrimenti -1 in caso di errore 
+ */
+ssize_t create_game(server_t* server, player_id_t player1) {
+    if (player1 == PLAYER_NONE) return -1;
+
+    pthread_mutex_lock(&server->games_mutex);
+
+    // Controllo disponibilità slot partite 
+    game_t* new_game = game_table->count < server->max_games ? game_alloc(player1) : NULL;
+    if(!new_game){
+        pthread_mutex_unlock(&server->games_mutex);
+        log_error("game.create_game", "Impossibile creare una partita il server è al momento pieno");
+        return -1;
+    }
+
+    ssize_t id = new_game->id;
+
+    if (!player_add_game(player1, new_game->id)) {
+        game_lock(new_game);
+        game_retire(new_game);
+        game_unlock(new_game);
+
+        pthread_mutex_unlock(&server->games_mutex);
+        log_error("game.create_game", "Impossibile allocare memoria per l'indice dei giocatori");
+        return -1;
+    }
+
+    game_lock(new_game);
+    lobby_update(new_game);
+    game_unlock(new_game);
+
+    pthread_mutex_unlock(&server->games_mutex);
+    
+    return id;
+}
+
+/**
+ * Invia al creatore della partita la richiesta di join da parte di un utente per una determinata partita. Ritorna:
+ * - 0 se la richiesta è avvenuta con successo,
+ * - -1 se game_id non è valido,
+ * - -2 se la partita non è più disponibile
+ * - -3 la partita è già stata avviata
+ */
+short request_join_game(server_t* server, size_t game_id, player_id_t player2) {
+    // La richiesta dipende solo da game_id e player2: viene composta prima di acquisire i lock
+    json_t* data = json_object();
+    json_object_set_new(data, "game_id", json_integer(game_id));
+    json_object_set_new(data, "player2", json_string(player_name(player2)));
+    json_t* request = create_request("join_request", "Nuova richiesta di join", data);
+
+    outbox_t outbox;
+    outbox_init(&outbox);
+
+    game_t* game = lock_game_by_id(game_id);
+    
+    if(game){
+        // Verifica che la partita sia in stato di "attesa"
+        if (game->state == GAME_OVER) {
+            game_unlock(game);
+            json_decref(request);
+            
+            log_error("game.request_join_game", "La parita non esiste più");
+            return -2;
+        }
+
+        if (game->state == GAME_ONGOING) {
+            game_unlock(game);
+            json_decref(request);
+            
+            log_error("game.request_join_game", "La parita è gia stata avviata più");
+            return -3;
+        }
+
+        // La richiesta di join al creatore della partita (player1) viene inviata dopo aver rilasciato il lock
+        outbox_json_to_player(&outbox, player_name(game->player1), request);
+        game_unlock(game);
+
+        outbox_send(server, &outbox);
+        return 0;
+    }
+
+    json_decref(request);
+    log_error("game.request_join_game", "Id partita inesistente");
+    return -1; 
+   
+}
+
+/**
+ * Invia all'avversario la notifica che la partita è stata accettata e che sta per essere avviata.
+ * Ritorna 0 se l'invio è avvenuto con successo, -1 se game_id non è valido, 
+ * -2 se la partita non è più disponibile, -3 in caso di errore interno, -4 se l'avversario non è più disponibile
+ */
+short accept_join_request(server_t* server, size_t game_id, const char *player2){
+    if(find_client_by_username(server,player2) == -1){
+        return -5;
+        log_error("game.accept_join_request", "Player disconnesso");
+    }
+
+    // Un client connesso ha sempre un id: PLAYER_NONE indica che si è disconnesso dopo la verifica.
+    // Il riferimento acquisito passa alla partita se l'avversario vi viene aggiunto, altrimenti viene rilasciato
+    player_id_t opponent = player_lookup(player2);
+    if (opponent == PLAYER_NONE) {
+        log_error("game.accept_join_request", "Player disconnesso");
+        return -5;
+    }
+
+    // games_mutex resta acquisito fino all'avvio della partita: due accettazioni concorrenti
+    // non possono impegnare lo stesso avversario in due partite
+    pthread_mutex_lock(&server->games_mutex);
+    game_t *game = lookup_game(game_id);
+    
+    if(game){
+
+        // Verifico se l'avversario é impegnato in un'altra partita (prima di acquisire il lock della partita)
+        if(!is_opponent_available(server, opponent, true)){
+            pthread_mutex_unlock(&server->games_mutex);
+            player_release(opponent);
+            log_error("game.accept_join_request", "Avversario impegnato in un'altra partita");
+            return -4; 
+        }
+
+        game_lock(game);
+        
+        // Verifica che la partita sia in stato di "attesa"
+        if (game->state != GAME_WAITING) {
+            game_unlock(game);
+            pthread_mutex_unlock(&server->games_mutex);
+            player_release(opponent);
+            log_error("game.accept_join_request", "La parita non esiste più");
+            return -2;
+        }
+
+        if (!player_add_game(opponent, game->id)) {
+            game_unlock(game);
+            pthread_mutex_unlock(&server->games_mutex);
+            player_release(opponent);
+            log_error("game.accept_join_request", "Impossibile allocare memoria per l'indice dei giocatori");
+            return -3;
+        }
+
+        // Aggiungi il secondo giocatore alla partita
+        game->player2 = opponent;
+        game->state = GAME_ONGOING;
+        pthread_mutex_unlock(&server->games_mutex);
+
+        lobby_update(game);
+        
+        // Notifica l'avversario che la partita sta stata accettata con successo e che può essere avviata:
+        // con il lock della partita viene solo serializzato il suo stato, l'invio avviene dopo averlo rilasciato
+        size_t game_len;
+        const char* game_json = game_encode(game, &game_len);
+        frame_t* started = game_json ? create_request_frame("game_started", "La partita sta per cominciare", game_json, game_len) : NULL;
+        game_unlock(game);
+
+        outbox_t outbox;
+        outbox_init(&outbox);
+        outbox_json_to_player(&outbox, player2, create_request("accept_join", "Richiesta accettata", NULL));
+        outbox_frame_to_player(&outbox, player2, started);
+        outbox_send(server, &outbox);
+        return 0;
+    }
+
+    pthread_mutex_unlock(&server->games_mutex);
+    player_release(opponent);
+    return -1;  // Partita non trovata
+}
+
+/**
+ * Crea una partita tra due giocatori abbinati dal matchmaking e la avvia subito, senza passare dallo stato di attesa:
+ * entrambi ricevono la notifica game_started. player1 (X) è il giocatore che attendeva e muove per primo.
+ * Ritorna l'id della partita, -1 se player1 si è disconnesso o è impegnato in un'altra partita,
+ * -2 se player2 è impegnato in un'altra partita, -3 se il server è pieno o in caso di errore interno
+ */
+ssize_t start_game(server_t* server, player_id_t player1, player_id_t player2) {
+    if (player2 == PLAYER_NONE) return -2;
+    if (player1 == PLAYER_NONE || player1 == player2) return -1;
+
+    if (find_client_by_username(server, player_name(player1)) == -1) {
+        log_error("game.start_game", "Player disconnesso");
+        return -1;
+    }
+
+    // Come in accept_join_request games_mutex resta acquisito fino all'avvio: nessuno dei due può essere impegnato altrove nel frattempo
+    pthread_mutex_lock(&server->games_mutex);
+
+    if (!is_opponent_available(server, player2, true)) {
+        pthread_mutex_unlock(&server->games_mutex);
+        return -2;
+    }
+    if (!is_opponent_available(server, player1, true)) {
+        pthread_mutex_unlock(&server->games_mutex);
+        return -1;
+    }
+
+    game_t* game = game_open(server, player1, player2, true);
+    pthread_mutex_unlock(&server->games_mutex);
+    if (!game) return -3;
+
+    ssize_t id = game->id;
+
+    lobby_update(game);
+
+    // Un solo frame condiviso da entrambi i giocatori, inviato dopo aver rilasciato il lock della partita
+    size_t game_len;
+    const char* game_json = game_encode(game, &game_len);
+    frame_t* started = game_json ? create_request_frame("game_started", "La partita sta per cominciare", game_json, game_len) : NULL;
+    game_unlock(game);
+
+    outbox_t outbox;
+    outbox_init(&outbox);
+    outbox_frame_to_player(&outbox, player_name(player1), started ? frame_retain(started) : NULL);
+    outbox_frame_to_player(&outbox, player_name(player2), started);
+    outbox_send(server, &outbox);
+
+    log_info("game.start_game", "Partita %zd avviata tra %s e %s", id, player_name(player1), player_name(player2));
+    return id;
+}
+
+/**
+ * Crea una partita contro il bot del server con il livello indicato e la avvia subito: player1 (X) muove per primo,
+ * il bot risponde a ogni mossa con bot_move. Il bot non viene aggiunto all'indice per giocatore, così che possa
+ * giocare più partite contemporaneamente.
+ * Ritorna l'id della partita, -1 se il giocatore è impegnato in un'altra partita, -2 se il server è pieno o in caso di errore interno
+ */
+ssize_t create_bot_game(server_t* server, player_id_t player, bot_level_t level) {
+    if (player == PLAYER_NONE || level == BOT_NONE) return -2;
+
+    pthread_mutex_lock(&server->games_mutex);
+
+    if (!is_opponent_available(server, player, true)) {
+        pthread_mutex_unlock(&server->games_mutex);
+        return -1;
+    }
+
+    game_t* game = game_open(server, player, bot_player(), false);
+    pthread_mutex_unlock(&server->games_mutex);
+    if (!game) return -2;
+
+    game->bot = level;
+    ssize_t id = game->id;
+
+    lobby_update(game);
+    game_unlock(game);
+    return id;
+}
+
+/**
+ * Metodo che gestisce la mossa, quindi, aggiorna lo stato della board, verifica se è stato fatto un tris e cambia il turno.
+ * Ritorna 0 se la mossa è stata fatta con successo, -1 se la parita non è nello stato GAME_ONGOING
+ */
+short make_move(server_t* server, game_t* game, player_id_t player, int x, int y) {
+    (void)server;   // La mossa richiede solo il lock della partita
+    game_lock(game);
+    
+    if(game->state != GAME_ONGOING){
+        game_unlock(game);
+        log_error("game.make_move", "La partita non è stata ancora avviata");
+        return -1;
+    }
+
+    // Verifica che sia il turno del giocatore che ha effettuato la mossa
+    if (game_turn_player(game) != player) {
+        game_unlock(game);
+        log_error("game.make_move", "Non è il turno del giocatore %s", player_name(player));
+        return -2;
+    }
+
+    if (x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE) {
+        game_unlock(game);
+        log_error("game.make_move", "Cella (%d, %d) inesistente", x, y);
+        return -4;
+    }
+
+    // Esegui la mossa
+    uint16_t cell = BOARD_CELL(x, y);
+    if((game->x_mask | game->o_mask) & cell){
+        game_unlock(game);
+        log_error("game.make_move", "Cella già occupata");
+        return -3;
+    }
+
+    apply_move(game, x, y);
+
+    // La vista della lobby di una partita finita viene aggiornata da send_game_update, che la serializza comunque
+    game_unlock(game);
+    return 0;
+}
+
+/**
+ * Esegue la risposta del bot, letta dalla tabella delle mosse, se è il turno del bot nella partita.
+ * Ritorna 0 se il bot ha mosso, -1 se la partita non è contro il bot, non è in corso o non è il turno del bot
+ */
+short bot_move(server_t* server, game_t* game) {
+    (void)server;   // Come make_move richiede solo il lock della partita
+    game_lock(game);
+
+    if (game->bot == BOT_NONE || game->state != GAME_ONGOING || game_turn_player(game) != game->player2) {
+        game_unlock(game);
+        return -1;
+    }
+
+    // Nessuna ricerca: la posizione indicizza direttamente la tabella generata durante la compilazione
+    int cell = bot_choose_move(game->x_mask, game->o_mask, (bot_level_t)game->bot);
+    if (cell < 0) {
+        game_unlock(game);
+        log_error("game.bot_move", "Nessuna mossa disponibile per il bot nella partita %zu", game->id);
+        return -1;
+    }
+
+    apply_move(game, cell / BOARD_SIZE, cell % BOARD_SIZE);
+
+    game_unlock(game);
+    return 0;
+}
+
+
+/**
+ * Cerca una partita a partire dall'id senza acquisire lock e ne ottiene un riferimento, da rilasciare con game_put.
+ * Finché il riferimento è attivo lo slot non viene riusato: se la partita viene rimossa nel frattempo resta nello stato GAME_OVER.
+ * Ritorna la partita se è stata trovata, NULL altrimenti
+ */
+game_t* game_get(server_t* server, size_t game_id){
+    game_slot_t* slot = &game_table->slots[game_id % game_table->capacity];
+
+    // Il riferimento viene preso prima della verifica: se la partita viene rimossa dopo, lo slot non può essere riusato
+    atomic_fetch_add(&slot->refs, 1);
+    if (!lookup_game(game_id)) {
+        game_put(server, &slot->game);
+        return NULL;
+    }
+
+    return &slot->game;
+}
+
+/**
+ * Rilascia un riferimento ottenuto con game_get. Da chiamare senza games_mutex né il lock della partita acquisiti
+ */
+void game_put(server_t* server, game_t* game){
+    game_slot_t* slot = (game_slot_t*)game;
+    if (atomic_fetch_sub(&slot->refs, 1) != 1 || !atomic_load(&slot->retired)) return;
+
+    // Ultimo riferimento di una partita rimossa: lo slot torna libero, se nessun altro lo ha già fatto
+    pthread_mutex_lock(&server->games_mutex);
+    if (atomic_load(&slot->retired) && atomic_load(&slot->refs) == 0) {
+        slot_free((size_t)(slot - game_table->slots));
+    }
+    pthread_mutex_unlock(&server->games_mutex);
+}
+
+/**
+ * Acquisisce il lock della singola partita. Vedi server_t per l'ordine di acquisizione dei lock
+ */
+void game_lock(game_t* game) {
+    pthread_mutex_lock(&((game_slot_t*)game)->lock);
+}
+
+/**
+ * Rilascia il lock della singola partita
+ */
+void game_unlock(game_t* game) {
+    pthread_mutex_unlock(&((game_slot_t*)game)->lock);
+}
+
+/**
+ * Serializza la struttura game_t in json.
+ * already_locked indica che il chiamante possiede già il lock della partita
+ */
+json_t* create_json(server_t* server, size_t id, bool already_locked){
+    (void)server;   // La partita viene cercata con il solo lock del suo slot
+    json_t* msg = json_object();
+    if (!msg) return NULL;
+    
+    game_t* found_game;
+    if (already_locked) {
+        found_game = lookup_game(id);
+    } else {
+        found_game = lock_game_by_id(id);
+    }
+    
+    if (!found_game) {
+        json_decref(msg);
+        return NULL;
+    }
+    
+    // Serializza i dati del gioco
+    json_object_set_new(msg, "game_id", json_integer(found_game->id));
+    json_object_set_new(msg, "player1", json_string(player_name(found_game->player1)));
+    
+    // Gestione player2
+    if (found_game->player2 != PLAYER_NONE) {
+        json_object_set_new(msg, "player2", json_string(player_name(found_game->player2)));
+    } else {
+        json_object_set_new(msg, "player2", json_null());
+    }
+    
+    // Serializzazione board
+    json_t* json_board = json_array();
+    if (!json_board){
+        if(!already_locked) game_unlock(found_game);
+        json_decref(msg);
+        return NULL;
+    }
+    
+    for (int i = 0; i < 3; i++) {
+        json_t *row = json_array();
+        if (!row){
+            if(!already_locked) game_unlock(found_game);
+            json_decref(msg);
+            return NULL;
+        }
+        
+        for (int j = 0; j < 3; j++) {
+            // La vista testuale della board viene ricavata dalle bitboard solo durante la serializzazione
+            uint16_t bit = BOARD_CELL(i, j);
+            char cell[2] = { (found_game->x_mask & bit) ? 'X' : (found_game->o_mask & bit) ? 'O' : '\0', '\0' };
+            json_t* cell_json = json_string(cell);
+            if (!cell_json || json_array_append_new(row, cell_json) != 0) {
+                if (cell_json){
+                    if(!already_locked) game_unlock(found_game);
+                    json_decref(msg);
+                    return NULL;
+                }
+            }
+        }
+
+        json_array_append_new(json_board, row);
+    }
+    json_object_set_new(msg, "board", json_board);
+    
+    // Altri campi
+    json_object_set_new(msg, "turn", json_string(player_name(game_turn_player(found_game))));
+    json_object_set_new(msg, "state", json_string(game_state_to_string(found_game->state)));
+    
+    // Gestione winner
+    if (found_game->winner != GAME_WINNER_NONE) {
+        json_object_set_new(msg, "winner", json_string(player_name(game_winner_player(found_game))));
+    } else {
+        json_object_set_new(msg, "winner", json_null());
+    }
+    
+    if(!already_locked) game_unlock(found_game);
+    return msg;
+}
+
+/**
+ * Serializza la partita direttamente nel buffer riservato al thread chiamante, senza allocare memoria.
+ * Il risultato è identico a create_json serializzato con JSON_COMPACT. Da chiamare con il lock della partita acquisito.
+ * Ritorna il json, valido fino alla successiva chiamata dallo stesso thread, e ne scrive la lunghezza in len, NULL in caso di errore
+ */
+const char* game_encode(const game_t* game, size_t* len) {
+    encoder_t encoder;
+    encoder_init(&encoder, encoded_game, sizeof(encoded_game));
+
+    // Stessi campi e stesso ordine di create_json
+    encoder_raw(&encoder, "{\"game_id\":", 11);
+    encoder_integer(&encoder, (long long)game->id);
+    encoder_string_field(&encoder, ",\"player1\":", player_name(game->player1));
+
+    if (game->player2 != PLAYER_NONE) {
+        encoder_string_field(&encoder, ",\"player2\":", player_name(game->player2));
+    } else {
+        encoder_raw(&encoder, ",\"player2\":null", 15);
+    }
+
+    encoder_raw(&encoder, ",\"board\":[", 10);
+    for (int i = 0; i < BOARD_SIZE; i++) {
+        encoder_raw(&encoder, i == 0 ? "[" : ",[", i == 0 ? 1 : 2);
+        for (int j = 0; j < BOARD_SIZE; j++) {
+            uint16_t bit = BOARD_CELL(i, j);
+            const char* cell = (game->x_mask & bit) ? "\"X\"" : (game->o_mask & bit) ? "\"O\"" : "\"\"";
+            if (j > 0) encoder_raw(&encoder, ",", 1);
+            encoder_raw(&encoder, cell, strlen(cell));
+        }
+        encoder_raw(&encoder, "]", 1);
+    }
+    encoder_raw(&encoder, "]", 1);
+
+    encoder_string_field(&encoder, ",\"turn\":", player_name(game_turn_player(game)));
+    encoder_string_field(&encoder, ",\"state\":", game_state_to_string(game->state));
+
+    if (game->winner != GAME_WINNER_NONE) {
+        encoder_string_field(&encoder, ",\"winner\":", player_name(game_winner_player(game)));
+    } else {
+        encoder_raw(&encoder, ",\"winner\":null", 14);
+    }
+    encoder_raw(&encoder, "}", 1);
+
+    // Non accade con nomi di al più 63 byte: GAME_JSON_MAX copre il caso peggiore
+    if (encoder.overflow) {
+        log_error("game.game_encode", "Serializzazione della partita %zu oltre %d byte", game->id, GAME_JSON_MAX);
+        return NULL;
+    }
+
+    *len = encoder.length;
+    return encoded_game;
+}
+
+/**
+ * Serializza l'ultima mossa della partita come aggiornamento incrementale nel buffer riservato al thread chiamante:
+ * {"game_id":id,"seq":seq,"x":x,"y":y,"mark":"X"}, seguito da "state" e "winner" se la mossa ha concluso la partita.
+ * Da chiamare con il lock della partita acquisito, dopo almeno una mossa.
+ * Ritorna il json, valido fino alla successiva chiamata dallo stesso thread, e ne scrive la lunghezza in len, NULL in caso di errore
+ */
+const char* game_encode_delta(const game_t* game, size_t* len) {
+    encoder_t encoder;
+    encoder_init(&encoder, encoded_delta, sizeof(encoded_delta));
+
+    uint16_t bit = (uint16_t)(1u << game->last_cell);
+
+    encoder_raw(&encoder, "{\"game_id\":", 11);
+    encoder_integer(&encoder, (long long)game->id);
+    encoder_raw(&encoder, ",\"seq\":", 7);
+    encoder_integer(&encoder, (long long)game->seq);
+    encoder_raw(&encoder, ",\"x\":", 5);
+    encoder_integer(&encoder, game->last_cell / BOARD_SIZE);
+    encoder_raw(&encoder, ",\"y\":", 5);
+    encoder_integer(&encoder, game->last_cell % BOARD_SIZE);
+    encoder_raw(&encoder, (game->x_mask & bit) ? ",\"mark\":\"X\"" : ",\"mark\":\"O\"", 11);
+
+    // Solo la mossa che conclude la partita porta con sé il cambio di stato
+    if (game->state == GAME_OVER) {
+        encoder_string_field(&encoder, ",\"state\":", game_state_to_string(game->state));
+
+        if (game->winner != GAME_WINNER_NONE) {
+            encoder_string_field(&encoder, ",\"winner\":", player_name(game_winner_player(game)));
+        } else {
+            encoder_raw(&encoder, ",\"winner\":null", 14);
+        }
+    }
+    encoder_raw(&encoder, "}", 1);
+
+    if (encoder.overflow) {
+        log_error("game.game_encode_delta", "Serializzazione della mossa della partita %zu oltre %d byte", game->id, GAME_DELTA_MAX);
+        return NULL;
+    }
+
+    *len = encoder.length;
+    return encoded_delta;
+}
+
+/**
+ * Serializza la partita insieme al numero di sequenza della sua ultima mossa, letti sotto lo stesso lock
+ * così che lo stato corrisponda a seq. Usato dai client con aggiornamenti incrementali per risincronizzarsi.
+ * Ritorna il json {"seq":seq,"game":partita}, NULL se la partita non esiste
+ */
+json_t* create_resync_json(server_t* server, size_t id) {
+    game_t* game = lock_game_by_id(id);
+    if (!game) return NULL;
+
+    json_t* game_json = create_json(server, id, true);
+    uint32_t seq = game->seq;
+    game_unlock(game);
+
+    if (!game_json) return NULL;
+
+    json_t* msg = json_object();
+    if (!msg) {
+        json_decref(game_json);
+        return NULL;
+    }
+
+    json_object_set_new(msg, "seq", json_integer(seq));
+    json_object_set_new(msg, "game", game_json);
+    return msg;
+}
+
+/**
+ * Gestione abbandono partita. Notifica il player in gioco che ha l'avversario ha abbandonato e dunque ha vinto la partita,
+ * dopo aver rilasciato il lock della partita.
+ * Ritorna 0 se lo stato della partita e l'invio della notifica vanno a buon fine, -1 se la partita non è in corso, -2 errore creazione notifica
+ */
+short quit(server_t* server, game_t* game, player_id_t player){
+    game_lock(game);
+
+    if(game->state != GAME_ONGOING){
+        log_error("game.quit", "La partita non è in corso");
+
+        game_unlock(game);
+        return -1; // Gioco non in corso
+    }
+
+    // Imposta lo stato della partita a GAME_OVER e assegna il vincitore 
+    game->state = GAME_OVER;
+    game->winner = game->player1 == player ? GAME_WINNER_PLAYER2 : GAME_WINNER_PLAYER1; // Imposta il vincitore
+
+    size_t game_len;
+    const char* game_json = game_encode(game, &game_len);
+    frame_t* request = game_json ? create_request_frame("quit", "L'avversario ha abbandonato", game_json, game_len) : NULL;
+
+    if(!request){
+
+        // Nel caso di errore nella creazione della notifica reimposta lo stato della partita
+        game->state = GAME_ONGOING;
+        game->winner = GAME_WINNER_NONE;
+
+        game_unlock(game);
+        return -2;
+    }
+
+    // La notifica al vincitore viene inviata dopo aver rilasciato il lock della partita
+    outbox_t outbox;
+    outbox_init(&outbox);
+    outbox_frame_to_player(&outbox, player_name(game_winner_player(game)), request);
+
+    lobby_update(game);
+    game_unlock(game);
+
+    outbox_send(server, &outbox);
+    return 0;
+}
+
+/**
+ * Rimuove tutte le partite create da un giocatore
+ */
+void remove_games_by_player(server_t* server, player_id_t player, const size_t sock){
+    pthread_mutex_lock(&server->games_mutex);
+     
+    size_t counter = 0;
+    size_t* id = NULL;
+
+    player_games_t* entry = player_find(player);
+    if (entry) {
+        id = malloc(entry->count * sizeof(size_t));
+        if (!id) {
+            log_error("game.remove_games_by_player", "Impossibile allocare memoria per le partite rimosse");
+            pthread_mutex_unlock(&server->games_mutex);
+            return;
+        }
+
+        // Copia gli id: l'elemento dell'indice cambia (e può essere liberato) man mano che le partite vengono rimosse
+        size_t owned = entry->count;
+        memcpy(id, entry->ids, owned * sizeof(size_t));
+
+        for (size_t i = 0; i < owned; i++) {
+            game_t* game = lookup_game(id[i]);
+            if (!game) continue;
+
+            game_lock(game);
+            if (game->player1 != player) {
+                // Partita in cui il giocatore è l'avversario: non viene rimossa
+                game_unlock(game);
+                continue;
+            }
+
+            player_remove_game(game->player1, game->id);
+            if (game->player2 != PLAYER_NONE) player_remove_game(game->player2, game->id);
+
+            id[counter++] = game->id;
+            lobby_remove(game->id);
+            game_retire(game);
+            game_unlock(game);
+        }
+    }
+
+    pthread_mutex_unlock(&server->games_mutex);
+
+    // Broadcast removed games
+    for (size_t i = 0; i < counter; i++) {
+        json_t* msg = json_object();
+        json_object_set_new(msg, "game_id", json_integer(id[i]));
+
+        send_broadcast(server, "game_removed", msg, sock, -1);
+    }
+
+    free(id);
 }
\ No newline at end of file
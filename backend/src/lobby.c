@@ -0,0 +1,170 @@
+#include "lobby.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+static lobby_t lobby;
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Inizializza la lobby per al più max_games partite
+ */
+void lobby_init(server_t* server) {
+    lobby.capacity = server->max_games;
+    lobby.count = 0;
+    lobby.bytes = 0;
+
+    lobby.entries = calloc(lobby.capacity, sizeof(lobby_entry_t));
+    lobby.position = malloc(lobby.capacity * sizeof(size_t));
+    if (!lobby.entries || !lobby.position) {
+        log_error("lobby.lobby_init", "Impossibile allocare memoria per la lobby");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < lobby.capacity; i++) {
+        lobby.position[i] = GAME_SLOT_NONE;
+    }
+
+    pthread_mutex_init(&lobby.mutex, NULL);
+}
+
+/**
+ * Libera la memoria allocata per la lobby
+ */
+void lobby_cleanup(void) {
+    pthread_mutex_lock(&lobby.mutex);
+
+    for (size_t i = 0; i < lobby.count; i++) {
+        free(lobby.entries[i].json);
+    }
+    free(lobby.entries);
+    free(lobby.position);
+    lobby.entries = NULL;
+    lobby.position = NULL;
+    lobby.count = 0;
+
+    pthread_mutex_unlock(&lobby.mutex);
+    pthread_mutex_destroy(&lobby.mutex);
+}
+
+/**
+ * Serializza la partita e ne aggiorna la vista nella lobby, aggiungendola se non è presente.
+ * Da chiamare con il lock della partita acquisito
+ */
+void lobby_update(game_t* game) {
+    // La serializzazione avviene fuori dal lock della lobby, che resta acquisito solo per lo scambio dei buffer
+    size_t json_len;
+    const char* encoded = game_encode(game, &json_len);
+    if (!encoded) {
+        log_error("lobby.lobby_update", "Serializzazione della partita %zu fallita", game->id);
+        return;
+    }
+
+    lobby_store(game, encoded, json_len);
+}
+
+/**
+ * Aggiorna la vista della partita nella lobby con il json encoded già serializzato dal chiamante,
+ * aggiungendola se non è presente. Da chiamare con il lock della partita acquisito
+ */
+void lobby_store(game_t* game, const char* encoded, size_t json_len) {
+    char* json = malloc(json_len);
+    if (!json) {
+        log_error("lobby.lobby_store", "Impossibile allocare memoria per la vista della partita %zu", game->id);
+        return;
+    }
+    memcpy(json, encoded, json_len);
+    size_t slot = game->id % lobby.capacity;
+
+    pthread_mutex_lock(&lobby.mutex);
+
+    lobby_entry_t* entry;
+    char* old_json = NULL;
+    if (lobby.position[slot] != GAME_SLOT_NONE) {
+        entry = &lobby.entries[lobby.position[slot]];
+        old_json = entry->json;
+        lobby.bytes -= entry->json_len;
+    } else {
+        lobby.position[slot] = lobby.count;
+        entry = &lobby.entries[lobby.count++];
+    }
+
+    entry->game_id = game->id;
+    entry->owner = game->player1;
+    entry->json = json;
+    entry->json_len = json_len;
+    lobby.bytes += json_len;
+
+    pthread_mutex_unlock(&lobby.mutex);
+    free(old_json);
+}
+
+/**
+ * Rimuove dalla lobby la vista della partita game_id
+ */
+void lobby_remove(size_t game_id) {
+    size_t slot = game_id % lobby.capacity;
+
+    pthread_mutex_lock(&lobby.mutex);
+
+    size_t index = lobby.position[slot];
+    if (index == GAME_SLOT_NONE || lobby.entries[index].game_id != game_id) {
+        pthread_mutex_unlock(&lobby.mutex);
+        return;
+    }
+
+    char* old_json = lobby.entries[index].json;
+    lobby.bytes -= lobby.entries[index].json_len;
+    lobby.position[slot] = GAME_SLOT_NONE;
+
+    // L'ultima vista prende il posto di quella rimossa, così che le viste restino contigue
+    lobby.count--;
+    if (index != lobby.count) {
+        lobby.entries[index] = lobby.entries[lobby.count];
+        lobby.position[lobby.entries[index].game_id % lobby.capacity] = index;
+    }
+
+    pthread_mutex_unlock(&lobby.mutex);
+    free(old_json);
+}
+
+/**
+ * Compone l'array json delle partite in lobby escluse quelle create da player, copiando le viste già serializzate.
+ * Ritorna la stringa allocata (da liberare con free) e ne scrive la lunghezza in len, NULL in caso di errore
+ */
+char* lobby_list(player_id_t player, size_t* len) {
+    if (player == PLAYER_NONE) return NULL;
+
+    pthread_mutex_lock(&lobby.mutex);
+
+    // Parentesi, virgole e terminatore: il buffer è dimensionato una sola volta per tutte le viste
+    char* buffer = malloc(lobby.bytes + lobby.count + 3);
+    if (!buffer) {
+        pthread_mutex_unlock(&lobby.mutex);
+        log_error("lobby.lobby_list", "Impossibile allocare memoria per la lista delle partite");
+        return NULL;
+    }
+
+    size_t offset = 0;
+    buffer[offset++] = '[';
+
+    for (size_t i = 0; i < lobby.count; i++) {
+        lobby_entry_t* entry = &lobby.entries[i];
+        if (entry->owner == player) continue;
+
+        if (offset > 1) buffer[offset++] = ',';
+        memcpy(buffer + offset, entry->json, entry->json_len);
+        offset += entry->json_len;
+    }
+
+    pthread_mutex_unlock(&lobby.mutex);
+
+    buffer[offset++] = ']';
+    buffer[offset] = '\0';
+
+    *len = offset;
+    return buffer;
+}
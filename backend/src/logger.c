@@ -0,0 +1,319 @@
+#define _GNU_SOURCE
+
+#include "logger.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static atomic_int current_level = LOG_LEVEL_INFO;
+static atomic_bool running = false;
+static atomic_bool stopping = false;
+static atomic_bool wake_pending = false;
+static atomic_size_t dropped = 0;
+
+static log_ring_t* rings = NULL;
+static pthread_mutex_t rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t ring_key;
+
+static pthread_mutex_t drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t drain_cond;
+static pthread_t drain_thread;
+
+static _Thread_local log_ring_t* local_ring = NULL;
+
+static const char* level_labels[] = { "Errore", "Info", "Debug" };
+
+//============ METODI PRIVATI ==================//
+/**
+ * Rilascia il buffer del thread che termina, così che possa essere riusato
+ */
+static void release_ring(void* ring) {
+    atomic_store_explicit(&((log_ring_t*)ring)->owned, false, memory_order_release);
+}
+
+/**
+ * Ritorna il buffer del thread chiamante, riusandone uno rilasciato o allocandone uno nuovo al primo messaggio.
+ * Ritorna NULL in caso di errore di allocazione
+ */
+static log_ring_t* acquire_ring(void) {
+    if (local_ring) return local_ring;
+
+    pthread_mutex_lock(&rings_mutex);
+
+    log_ring_t* ring = rings;
+    while (ring && atomic_load_explicit(&ring->owned, memory_order_acquire)) {
+        ring = ring->next;
+    }
+
+    if (!ring) {
+        ring = calloc(1, sizeof(log_ring_t));
+        if (ring) {
+            ring->next = rings;
+            rings = ring;
+        }
+    }
+    if (ring) atomic_store_explicit(&ring->owned, true, memory_order_relaxed);
+
+    pthread_mutex_unlock(&rings_mutex);
+
+    if (ring) {
+        pthread_setspecific(ring_key, ring);
+        local_ring = ring;
+    }
+    return ring;
+}
+
+/**
+ * Scrive tutto il buffer su standard output, ripetendo la write se viene interrotta o è parziale
+ */
+static void write_all(const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(STDOUT_FILENO, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+}
+
+/**
+ * Compone il messaggio "[Livello - where] testo\n" in out, troncandolo a size byte.
+ * Ritorna la lunghezza del messaggio composto
+ */
+static size_t format_record(char* out, size_t size, log_level_t level, const char* where, const char* format, va_list args) {
+    int prefix = snprintf(out, size, "[%s - %s] ", level_labels[level], where);
+    size_t len = prefix < 0 ? 0 : (size_t)prefix;
+    if (len >= size - 1) len = size - 2;
+
+    int body = vsnprintf(out + len, size - len - 1, format, args);
+    if (body > 0) len += (size_t)body;
+    if (len > size - 2) len = size - 2;
+
+    out[len++] = '\n';
+    out[len] = '\0';
+    return len;
+}
+
+/**
+ * Copia in buffer i messaggi di tutti i thread, scrivendolo ogni volta che si riempie.
+ * Ritorna il numero di byte rimasti in buffer
+ */
+static size_t drain_rings(char* buffer, size_t used) {
+    pthread_mutex_lock(&rings_mutex);
+
+    for (log_ring_t* ring = rings; ring; ring = ring->next) {
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+        while (tail != head) {
+            log_record_t* record = &ring->records[tail & (LOG_RING_SLOTS - 1)];
+            if (used + record->length > LOG_WRITE_BUFFER) {
+                write_all(buffer, used);
+                used = 0;
+            }
+            memcpy(buffer + used, record->text, record->length);
+            used += record->length;
+            tail++;
+        }
+
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+
+    pthread_mutex_unlock(&rings_mutex);
+    return used;
+}
+
+/**
+ * Thread di scrittura: svuota i buffer dei thread ogni LOG_DRAIN_INTERVAL_MS millisecondi, o prima se
+ * un buffer è pieno per metà, con una sola write per tutti i messaggi raccolti
+ */
+static void* drain_loop(void* arg) {
+    (void)arg;
+    char* buffer = malloc(LOG_WRITE_BUFFER);
+    if (!buffer) return NULL;
+    size_t reported_dropped = 0;
+
+    while (true) {
+        pthread_mutex_lock(&drain_mutex);
+        if (!atomic_load(&wake_pending) && !atomic_load(&stopping)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_nsec += LOG_DRAIN_INTERVAL_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&drain_cond, &drain_mutex, &deadline);
+        }
+        atomic_store(&wake_pending, false);
+        pthread_mutex_unlock(&drain_mutex);
+
+        bool last = atomic_load(&stopping);
+        size_t used = drain_rings(buffer, 0);
+
+        size_t lost = atomic_load_explicit(&dropped, memory_order_relaxed);
+        if (lost != reported_dropped && used + LOG_RECORD_SIZE <= LOG_WRITE_BUFFER) {
+            int len = snprintf(buffer + used, LOG_RECORD_SIZE, "[Errore - logger.drain_loop] %zu messaggi di log scartati perché il buffer del thread era pieno\n",
+                lost - reported_dropped);
+            if (len > 0) used += (size_t)len < LOG_RECORD_SIZE ? (size_t)len : LOG_RECORD_SIZE - 1;
+            reported_dropped = lost;
+        }
+
+        if (used > 0) write_all(buffer, used);
+        if (last) break;
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * Accoda il messaggio nel buffer del thread chiamante, senza bloccarsi. Se il buffer è pieno il messaggio
+ * viene scartato e conteggiato; prima dell'avvio del logger viene scritto direttamente su standard output
+ */
+static void log_write(log_level_t level, const char* where, const char* format, va_list args) {
+    if (!log_enabled(level)) return;
+
+    log_ring_t* ring = atomic_load_explicit(&running, memory_order_acquire) ? acquire_ring() : NULL;
+    if (!ring) {
+        char text[LOG_RECORD_SIZE];
+        size_t len = format_record(text, sizeof(text), level, where, format, args);
+        write_all(text, len);
+        return;
+    }
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t pending = head - atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (pending >= LOG_RING_SLOTS) {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    log_record_t* record = &ring->records[head & (LOG_RING_SLOTS - 1)];
+    record->length = format_record(record->text, sizeof(record->text), level, where, format, args);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    // Il thread di scrittura viene risvegliato solo quando il buffer si riempie per metà, altrimenti scrive al timeout
+    if (pending + 1 >= LOG_RING_SLOTS / 2 && !atomic_exchange(&wake_pending, true)) {
+        pthread_mutex_lock(&drain_mutex);
+        pthread_cond_signal(&drain_cond);
+        pthread_mutex_unlock(&drain_mutex);
+    }
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Avvia il thread che scrive su standard output i messaggi accodati dagli altri thread.
+ * Prima di logger_init e dopo logger_cleanup i messaggi vengono scritti direttamente dal chiamante.
+ * Ritorna true se il thread è stato avviato, false altrimenti
+ */
+bool logger_init(log_level_t level) {
+    logger_set_level(level);
+    fflush(stdout);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&drain_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_key_create(&ring_key, release_ring) != 0) {
+        log_error("logger.logger_init", "Creazione della chiave dei buffer di log fallita");
+        pthread_cond_destroy(&drain_cond);
+        return false;
+    }
+
+    atomic_store(&stopping, false);
+    if (pthread_create(&drain_thread, NULL, drain_loop, NULL) != 0) {
+        log_error("logger.logger_init", "Creazione del thread di log fallita");
+        pthread_key_delete(ring_key);
+        pthread_cond_destroy(&drain_cond);
+        return false;
+    }
+
+    // Anche chi termina il processo con exit non perde i messaggi ancora in coda
+    atomic_store_explicit(&running, true, memory_order_release);
+    atexit(logger_cleanup);
+    return true;
+}
+
+/**
+ * Scrive i messaggi rimasti, termina il thread di scrittura e libera i buffer dei thread.
+ * Da chiamare dopo la terminazione di tutti gli altri thread
+ */
+void logger_cleanup(void) {
+    if (!atomic_load(&running)) return;
+
+    pthread_mutex_lock(&drain_mutex);
+    atomic_store(&stopping, true);
+    pthread_cond_signal(&drain_cond);
+    pthread_mutex_unlock(&drain_mutex);
+
+    pthread_join(drain_thread, NULL);
+    atomic_store_explicit(&running, false, memory_order_release);
+
+    // Dopo pthread_key_delete i thread che terminano non toccano più i buffer
+    pthread_key_delete(ring_key);
+    pthread_cond_destroy(&drain_cond);
+
+    pthread_mutex_lock(&rings_mutex);
+    while (rings) {
+        log_ring_t* next = rings->next;
+        free(rings);
+        rings = next;
+    }
+    pthread_mutex_unlock(&rings_mutex);
+    local_ring = NULL;
+}
+
+/**
+ * Imposta il livello massimo dei messaggi scritti
+ */
+void logger_set_level(log_level_t level) {
+    atomic_store_explicit(&current_level, (int)level, memory_order_relaxed);
+}
+
+/**
+ * Verifica se i messaggi del livello indicato vengono scritti.
+ * Ritorna true se il livello è abilitato, false altrimenti
+ */
+bool log_enabled(log_level_t level) {
+    return (int)level <= atomic_load_explicit(&current_level, memory_order_relaxed);
+}
+
+/**
+ * Accoda un messaggio di errore di where (nella forma "modulo.funzione")
+ */
+void log_error(const char* where, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    log_write(LOG_LEVEL_ERROR, where, format, args);
+    va_end(args);
+}
+
+/**
+ * Accoda un messaggio informativo di where (nella forma "modulo.funzione")
+ */
+void log_info(const char* where, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    log_write(LOG_LEVEL_INFO, where, format, args);
+    va_end(args);
+}
+
+/**
+ * Accoda un messaggio di debug di where (nella forma "modulo.funzione"), scritto solo con il livello LOG_LEVEL_DEBUG
+ */
+void log_debug(const char* where, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    log_write(LOG_LEVEL_DEBUG, where, format, args);
+    va_end(args);
+}
@@ -1,127 +1,369 @@
-#define _XOPEN_SOURCE 700
-
-#include <signal.h>
-#include <stdatomic.h>  
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include "server.h"
-
-#include "client.h"
-#include "game.h"
-#include "messages.h"
-#include "routing.h"
-
-typedef struct {
-    int client_sock;
-    server_t* server;
-} thread_args_t;
-
-static volatile sig_atomic_t shutdown_requested = 0;
-static server_t server;
-
-static pthread_t* threads[MAX_CLIENTS];
-static int count = 0;
-
-void* accept_clients(void* arg);
-void handle_sig(int sig);
-
-int main() {
-    // Configurazione del signal handler
-    struct sigaction sa = {
-        .sa_handler = handle_sig,
-        .sa_flags = 0
-    };
-    sigemptyset(&sa.sa_mask);
-    sigaction(SIGINT, &sa, NULL);
-    sigaction(SIGTERM, &sa, NULL);
-
-    // Inizializzazione del server
-    server_init(&server, DEFAULT_PORT);
-    client_init(&server); 
-    game_init(&server);
-
-    if (!server_start(&server)) {
-        return 1;
-    }
-
-    // Loop principale
-    while (!shutdown_requested) {
-        struct sockaddr_in client_addr;
-        socklen_t addr_len = sizeof(client_addr);
-        int client_sock = accept(server.socket_fd, (struct sockaddr*)&client_addr, &addr_len);
-        
-        if (client_sock < 0) {
-            if (shutdown_requested) break;
-            perror("accept failed");
-            continue;
-        }
-
-        // Crea un thread per il client
-        thread_args_t* args = malloc(sizeof(thread_args_t));
-        args->client_sock = client_sock;
-        args->server = &server;
-
-        pthread_t thread;
-        if (pthread_create(&thread, NULL, accept_clients, args) != 0) {
-            perror("pthread_create failed");
-            close(client_sock);
-            free(args);
-        } else {
-            threads[count++] = &thread;
-            pthread_detach(thread);
-        }
-    }
-
-    // Cleanup sicuro (eseguito dal thread principale)
-    game_cleanup(&server);
-    client_cleanup(&server);
-    server_close(&server);
-    for(int i = 0; i < count; i++){
-        pthread_cancel(*threads[i]);
-    }
-    return 0;
-}
-
-// Handler per SIGINT (Async-Signal-Safe)
-void handle_sig(int sig) {
-    if (sig == SIGINT || sig == SIGTERM) {
-        shutdown_requested = 1;  // Solo un flag atomico
-    }
-}
-
-// Thread per client
-void* accept_clients(void* arg) {
-    thread_args_t* args = (thread_args_t*)arg;
-    int client_sock = args->client_sock;
-    server_t* server = args->server;
-    free(args);
-
-    while (!shutdown_requested) {
-        json_t* request = receive_json(client_sock);
-        if (!request) break;
-
-        const char* request_type = json_string_value(json_object_get(request, "request"));
-        if (request_type && strcmp(request_type, DISCONNECT_MESSAGE) == 0) {
-            json_decref(request);
-            break;
-        }
-
-        handle_request(server, client_sock, request);
-        json_decref(request);
-    }
-
-    // Cleanup del client
-    const char* username = find_username_by_client(server, client_sock);
-    if (username) {
-        remove_games_by_username(server, username, client_sock);
-    }
-    
-    client_remove(server, client_sock);
-    close(client_sock);
-
-    count--;
-    pthread_exit(NULL);
+#define _XOPEN_SOURCE 700
+
+#include <signal.h>
+#include <stdatomic.h>  
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "server.h"
+
+#include "client.h"
+#include "player.h"
+#include "bot.h"
+#include "game.h"
+#include "messages.h"
+#include "routing.h"
+#include "reactor.h"
+#include "worker_pool.h"
+#include "config.h"
+#include "slab.h"
+#include "output.h"
+#include "binary.h"
+#include "logger.h"
+
+typedef struct {
+    int client_sock;
+    server_t* server;
+} thread_args_t;
+
+#define POOL_REPORT_INTERVAL 10     // Secondi tra due report della coda dei worker e dei pool di memoria
+#define THREAD_ARGS_SLAB_CHUNK 64
+
+static volatile sig_atomic_t shutdown_requested = 0;
+static server_t server;
+
+// Socket servite dai thread della modalità threads, usate alla chiusura per sbloccarne le recv
+static int* client_sockets = NULL;
+static size_t client_sockets_count = 0;
+static size_t client_sockets_capacity = 0;
+static pthread_mutex_t client_sockets_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t client_sockets_empty = PTHREAD_COND_INITIALIZER;
+
+// Argomenti dei thread della modalità threads, liberati dai thread stessi
+static slab_t thread_args_slab;
+
+void* accept_clients(void* arg);
+void handle_sig(int sig);
+bool track_client_socket(int client_sock);
+void untrack_client_socket(int client_sock);
+void run_threads(void);
+void* run_reactor(void* arg);
+void run_epoll(void);
+
+int main(int argc, char* argv[]) {
+    // Configurazione del signal handler
+    struct sigaction sa = {
+        .sa_handler = handle_sig,
+        .sa_flags = 0
+    };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // Un client che chiude la connessione durante un invio non deve terminare il server
+    signal(SIGPIPE, SIG_IGN);
+
+    // Inizializzazione del server
+    server_init(&server, DEFAULT_PORT);
+    if (!config_load_args(&server, argc, argv)) {
+        return 1;
+    }
+
+    // Da qui i messaggi di log vengono accodati e scritti dal thread di log
+    if (!logger_init(server.log_level)) {
+        return 1;
+    }
+
+    player_init(&server);
+    bot_init();
+    client_init(&server); 
+    game_init(&server);
+
+    if (!output_init(&server)) {
+        logger_cleanup();
+        return 1;
+    }
+
+    if (!server_start(&server)) {
+        output_cleanup();
+        logger_cleanup();
+        return 1;
+    }
+
+    // Loop principale
+    if (server.mode == SERVER_MODE_EPOLL || server.mode == SERVER_MODE_REUSEPORT) {
+        run_epoll();
+    } else {
+        run_threads();
+    }
+
+    // Cleanup sicuro (eseguito dal thread principale)
+    output_cleanup();
+    game_cleanup(&server);
+    client_cleanup(&server);
+    player_cleanup();
+    server_close(&server);
+    logger_cleanup();
+    return 0;
+}
+
+/**
+ * Thread che esegue il loop di un reactor
+ */
+void* run_reactor(void* arg) {
+    reactor_run((reactor_t*)arg);
+    return NULL;
+}
+
+/**
+ * Modalità reactor: in modalità epoll un unico reactor gestisce tutte le socket, in modalità reuseport
+ * ogni reactor ha la propria socket di ascolto SO_REUSEPORT e il proprio insieme di connessioni.
+ * Se configurati, i reactor passano le richieste ad un numero fisso di worker condivisi.
+ */
+void run_epoll(void) {
+    size_t total = 1;
+    if (server.mode == SERVER_MODE_REUSEPORT && server.listeners > 1) {
+        total = server.listeners;
+    }
+
+    reactor_t* reactors = calloc(total, sizeof(reactor_t));
+    pthread_t* reactor_threads = calloc(total, sizeof(pthread_t));
+    if (!reactors || !reactor_threads) {
+        log_error("main.run_epoll", "Impossibile allocare memoria per i reactor");
+        free(reactors);
+        free(reactor_threads);
+        return;
+    }
+
+    // I segnali vanno gestiti dal solo thread principale: i thread creati da qui in poi li ereditano bloccati
+    sigset_t signals, previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+
+    worker_pool_t pool;
+    worker_pool_t* active_pool = NULL;
+
+    if (server.workers > 0 && worker_pool_init(&pool, &server, server.workers, server.queue_size, reactor_release_connection)) {
+        active_pool = &pool;
+    }
+
+    size_t started = 0;
+    if (server.workers == 0 || active_pool) {
+        for (; started < total; started++) {
+            int listen_fd = started == 0 ? server.socket_fd : server_open_listener(&server);
+            if (listen_fd < 0) break;
+
+            if (!reactor_init(&reactors[started], &server, listen_fd, active_pool)) {
+                if (started > 0) close(listen_fd);
+                break;
+            }
+
+            if (pthread_create(&reactor_threads[started], NULL, run_reactor, &reactors[started]) != 0) {
+                log_error("main.run_epoll", "Creazione del thread del reactor fallita");
+                reactor_cleanup(&reactors[started]);
+                if (started > 0) close(listen_fd);
+                break;
+            }
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    // Il thread principale attende la richiesta di chiusura e stampa periodicamente lo stato della coda
+    unsigned int elapsed = 0;
+    while (started > 0 && !shutdown_requested) {
+        sleep(1);
+        if (++elapsed % POOL_REPORT_INTERVAL == 0) {
+            if (active_pool) worker_pool_report(active_pool);
+            slab_report_all();
+            output_report();
+        }
+    }
+
+    for (size_t i = 0; i < started; i++) {
+        reactor_stop(&reactors[i]);
+        pthread_join(reactor_threads[i], NULL);
+    }
+
+    // I worker completano le richieste in coda prima che i reactor chiudano le connessioni rimaste
+    if (active_pool) {
+        worker_pool_report(active_pool);
+    }
+    slab_report_all();
+    output_report();
+    if (active_pool) {
+        worker_pool_destroy(active_pool);
+    }
+
+    for (size_t i = 0; i < started; i++) {
+        int listen_fd = reactors[i].listen_fd;
+        reactor_cleanup(&reactors[i]);
+        if (i > 0) close(listen_fd);
+    }
+
+    free(reactors);
+    free(reactor_threads);
+}
+
+/**
+ * Modalità thread per client: il thread principale accetta le connessioni e crea un thread dedicato per ognuna
+ */
+void run_threads(void) {
+    slab_init(&thread_args_slab, "argomenti thread", sizeof(thread_args_t), THREAD_ARGS_SLAB_CHUNK, true);
+
+    while (!shutdown_requested) {
+        struct sockaddr_in client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+        int client_sock = accept(server.socket_fd, (struct sockaddr*)&client_addr, &addr_len);
+        
+        if (client_sock < 0) {
+            if (shutdown_requested) break;
+            perror("accept failed");
+            continue;
+        }
+
+        // Crea un thread per il client
+        thread_args_t* args = slab_alloc(&thread_args_slab);
+        if (!args || !output_register(client_sock, NULL)) {
+            log_error("main.run_threads", "Impossibile allocare memoria per un nuovo client");
+            close(client_sock);
+            slab_free(&thread_args_slab, args);
+            continue;
+        }
+        if (!track_client_socket(client_sock)) {
+            log_error("main.run_threads", "Impossibile allocare memoria per un nuovo client");
+            output_unregister(client_sock);
+            close(client_sock);
+            slab_free(&thread_args_slab, args);
+            continue;
+        }
+        args->client_sock = client_sock;
+        args->server = &server;
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, accept_clients, args) != 0) {
+            perror("pthread_create failed");
+            untrack_client_socket(client_sock);
+            output_unregister(client_sock);
+            close(client_sock);
+            slab_free(&thread_args_slab, args);
+        } else {
+            pthread_detach(thread);
+        }
+    }
+
+    // Sblocca le recv dei thread ancora attivi e attende che abbiano terminato la pulizia dei propri client
+    pthread_mutex_lock(&client_sockets_mutex);
+    for (size_t i = 0; i < client_sockets_count; i++) {
+        shutdown(client_sockets[i], SHUT_RDWR);
+    }
+    while (client_sockets_count > 0) {
+        pthread_cond_wait(&client_sockets_empty, &client_sockets_mutex);
+    }
+    pthread_mutex_unlock(&client_sockets_mutex);
+
+    free(client_sockets);
+    client_sockets = NULL;
+    client_sockets_capacity = 0;
+
+    slab_report_all();
+    output_report();
+    slab_destroy(&thread_args_slab);
+}
+
+/**
+ * Registra la socket servita da un thread della modalità threads.
+ * Ritorna true se la socket è stata registrata, false in caso di errore di allocazione
+ */
+bool track_client_socket(int client_sock) {
+    pthread_mutex_lock(&client_sockets_mutex);
+
+    if (client_sockets_count == client_sockets_capacity) {
+        size_t new_capacity = client_sockets_capacity ? client_sockets_capacity * 2 : 64;
+        int* sockets = realloc(client_sockets, new_capacity * sizeof(int));
+        if (!sockets) {
+            pthread_mutex_unlock(&client_sockets_mutex);
+            return false;
+        }
+        client_sockets = sockets;
+        client_sockets_capacity = new_capacity;
+    }
+
+    client_sockets[client_sockets_count++] = client_sock;
+    pthread_mutex_unlock(&client_sockets_mutex);
+    return true;
+}
+
+/**
+ * Rimuove la socket dall'elenco di quelle servite dai thread, prima che venga chiusa
+ */
+void untrack_client_socket(int client_sock) {
+    pthread_mutex_lock(&client_sockets_mutex);
+
+    for (size_t i = 0; i < client_sockets_count; i++) {
+        if (client_sockets[i] == client_sock) {
+            client_sockets[i] = client_sockets[--client_sockets_count];
+            break;
+        }
+    }
+
+    if (client_sockets_count == 0) {
+        pthread_cond_signal(&client_sockets_empty);
+    }
+    pthread_mutex_unlock(&client_sockets_mutex);
+}
+
+// Handler per SIGINT (Async-Signal-Safe)
+void handle_sig(int sig) {
+    if (sig == SIGINT || sig == SIGTERM) {
+        shutdown_requested = 1;  // Solo un flag atomico
+    }
+}
+
+// Thread per client
+void* accept_clients(void* arg) {
+    thread_args_t* args = (thread_args_t*)arg;
+    int client_sock = args->client_sock;
+    server_t* server = args->server;
+    slab_free(&thread_args_slab, args);
+
+    frame_reader_t input;
+    frame_reader_init(&input, MAX_JSON_SIZE);
+
+    while (!shutdown_requested) {
+        size_t len;
+        const char* payload = receive_frame(client_sock, &input, &len);
+        if (!payload) break;
+
+        if (binary_is_message(payload, len)) {
+            if (!handle_binary_request(server, client_sock, payload, len)) break;
+            continue;
+        }
+
+        json_error_t error;
+        json_t* request = json_loadb(payload, len, 0, &error);
+        if (!request) break;
+
+        const char* request_type = json_string_value(json_object_get(request, "request"));
+        if (request_type && strcmp(request_type, DISCONNECT_MESSAGE) == 0) {
+            json_decref(request);
+            break;
+        }
+
+        handle_request(server, client_sock, request);
+        json_decref(request);
+    }
+
+    // Cleanup del client
+    frame_reader_free(&input);
+    handle_disconnect(server, client_sock);
+    output_unregister(client_sock);
+    untrack_client_socket(client_sock);
+    close(client_sock);
+
+    pthread_exit(NULL);
 }
\ No newline at end of file
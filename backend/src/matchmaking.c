@@ -0,0 +1,80 @@
+#include "matchmaking.h"
+
+#include <stdbool.h>
+
+#include "game.h"
+#include "logger.h"
+
+static matchmaking_t matchmaking = { PLAYER_NONE };
+
+//============ METODI PRIVATI ==================//
+/**
+ * Abbina il giocatore a quello in attesa o lo mette in attesa, riprovando finché una delle due CAS riesce.
+ * Il giocatore in attesa che nel frattempo si è disconnesso o è impegnato altrove viene scartato.
+ * L'attesa possiede un riferimento all'id del giocatore, che passa al thread che svuota lo slot.
+ * Ritorna gli stessi valori di quick_match
+ */
+static short match_player(server_t* server, player_id_t player, ssize_t* game_id) {
+    while (true) {
+        player_id_t waiting = atomic_load(&matchmaking.waiting);
+        if (waiting == player) return 1;
+
+        if (waiting == PLAYER_NONE) {
+            player_retain(player);
+            if (atomic_compare_exchange_weak(&matchmaking.waiting, &waiting, player)) return 1;
+            player_release(player);
+            continue;
+        }
+
+        // Solo il thread che svuota lo slot avvia la partita con il giocatore in attesa
+        if (!atomic_compare_exchange_weak(&matchmaking.waiting, &waiting, PLAYER_NONE)) continue;
+
+        ssize_t id = start_game(server, waiting, player);
+        if (id >= 0) {
+            player_release(waiting);
+            *game_id = id;
+            return 0;
+        }
+
+        // Il giocatore in attesa non è più disponibile: si cerca un altro avversario
+        if (id == -1) {
+            player_release(waiting);
+            continue;
+        }
+
+        // Il richiedente è stato impegnato in un'altra partita dopo la richiesta, o il server è pieno:
+        // il giocatore in attesa torna in coda, dove può essere abbinato da un'altra richiesta
+        ssize_t ignored;
+        match_player(server, waiting, &ignored);
+        player_release(waiting);
+        return id == -2 ? -1 : -2;
+    }
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Abbina il giocatore a quello in attesa e avvia subito la partita (vedi start_game), altrimenti lo mette in attesa.
+ * Ritorna 0 se la partita è stata avviata e ne scrive l'id in game_id, 1 se il giocatore è in attesa di un avversario,
+ * -1 se il giocatore è impegnato in un'altra partita, -2 se il server è pieno o in caso di errore interno
+ */
+short quick_match(server_t* server, player_id_t player, ssize_t* game_id) {
+    if (player == PLAYER_NONE) return -2;
+
+    // Un giocatore già impegnato non viene messo in attesa
+    if (!is_opponent_available(server, player, false)) {
+        log_error("matchmaking.quick_match", "%s è impegnato in un'altra partita", player_name(player));
+        return -1;
+    }
+
+    return match_player(server, player, game_id);
+}
+
+/**
+ * Toglie il giocatore dall'attesa, se vi si trova. Da chiamare alla disconnessione del client
+ */
+void matchmaking_cancel(player_id_t player) {
+    player_id_t expected = player;
+    if (atomic_compare_exchange_strong(&matchmaking.waiting, &expected, PLAYER_NONE)) {
+        player_release(player);
+    }
+}
@@ -1,298 +1,605 @@
-#include "messages.h"
-
-#include <string.h>
-#include <stdio.h>
-#include <unistd.h>
-#include <sys/socket.h>
-#include <arpa/inet.h>
-
-#include "client.h"
-#include "game.h"
-
-//============ METODI PRIVATI ==================//
-
-/**
- * Garantisce che tutti i dati vengano inviati correttamente su un socket, anche quando la funzione send() non invia tutto in una sola volta
- * Dopo ogni chiamata a send() la funzione verifica quanti byte sono stati effettivamente inviati.
- * Se non sono stati inviati tutti i byte, continua a inviare i dati rimanenti
-*/
-bool send_all_bytes(const int sock, const void* msg, const size_t length) {
-    size_t total_sent = 0;
-    const char* buffer = (const char*)msg;
-    while (total_sent < length) {
-        ssize_t sent = send(sock, buffer + total_sent, length - total_sent, 0);
-        if (sent <= 0){
-            return false;
-        } 
-
-        total_sent += sent;
-    }
-    
-    return true;
-}
-
-/**
- * Crea un messaggio broadcast standard in formato json  
- */
- json_t* create_broadcast(const char* event_type, json_t* data) {
-    json_t* msg = json_object();
-    if (!msg){
-        printf("[Errore - messages.create_broadcast] Creazione del messaggio Json per il broadcast fallita");
-        return NULL;
-    }
-
-    json_object_set_new(msg, "type", json_string("broadcast"));
-    json_object_set_new(msg, "event", json_string(event_type));
-    if(data){
-        json_object_set_new(msg, "data", data);
-    }
-
-    return msg;
-}
-
-//============ INTERFACCIA PUBBLICA ==================//
-
-/**
- * Invia i dati di aggiornamento della partita. 
- * Il parametro username indica chi ha effettuato la mossa, dunque invia lo stato della 
- * partita aggiornata come risposta a quest'ultimo e all'avversario una richiesta allo 
- * scopo di aggiornare i dati che ha.
- * Ritorna true se il messaggio è stato inviato correttamente ad entrambi i giocatori, false altrimenti.
- */
-bool send_game_update(server_t* server, game_t* game, const char* username){
-    json_t* response;
-    json_t* request;
-    
-    pthread_mutex_lock(&server->games_mutex);    
-    if(game->state == GAME_ONGOING){
-       response = create_response("game_move", true, "La partita è ancora in corso", create_json(server, game->id, true));
-       request = create_request("game_update", "La partita è ancora in corso", create_json(server, game->id, true));
-
-    } else if(game->state == GAME_OVER){
-        ssize_t owner = find_client_by_username(server, game->player1);
-        send_broadcast(server, "game_ended", create_json(server, game->id, true), owner , -1);
-
-        if(game->winner[0] == '\0'){
-            response = create_response("game_move", true, "Partita finita con pareggio", create_json(server, game->id, true));
-            request = create_request("game_update", "Partita finita con pareggio", create_json(server, game->id, true));
-        
-        }else{
-            response = create_response("game_move", true, "Partita finita con vincitore", create_json(server, game->id, true));   
-            request = create_request("game_update", "Partita finita con vincitore", create_json(server, game->id, true));
-        }
-    }
-        
-    bool sendedToPlayer1 = false;
-    bool sendedToPlayer2 = false;
-
-    ssize_t sock_client1 = find_client_by_username(server,game->player1);
-    ssize_t sock_client2 = find_client_by_username(server,game->player2);
-
-    if(strcmp(game->player1, username) == 0){
-        sendedToPlayer1 = send_json_message(response, sock_client1);
-        sendedToPlayer2 = send_json_message(request, sock_client2);
-    }else{
-        sendedToPlayer1 = send_json_message(request, sock_client1);
-        sendedToPlayer2 = send_json_message(response, sock_client2);
-    }
-    
-    json_decref(request);
-    json_decref(response);
-
-    if(sendedToPlayer1 && sendedToPlayer2){
-        pthread_mutex_unlock(&server->games_mutex);
-        printf("[Info - messages.send_game_update] I dati di aggiornamento della partita sono stati inviati correttamente\n");
-        return true;
-    }
-
-    pthread_mutex_unlock(&server->games_mutex);
-    printf("[Errore - messages.send_game_update] Invio dei dati di aggiornamento  della partita fallito\n");
-    return false;
-}
-
-/**
- * Invia un messaggio in broadcast a tutti i client connessi esclusi exclude_client1 e exclude_client2.
- * Ritorna ture se il messaggio è stato inviato a tutti i client connessi, false altrimenti.
- */
-bool send_broadcast(server_t* server, const char* event_type, json_t* data, const ssize_t exclude_client1, const ssize_t exclude_client2) {
-    if (!data || strlen(event_type) == 0) {
-        printf("[Errore - messages.send_broadcast] Il messaggio o il tipo di evento è vuoto\n");
-        return false;
-    };
-
-    pthread_mutex_lock(&server->clients_mutex);
-    
-    // Invio messaggi a tutti i client
-    client_node_t* current = connected_clients->head;
-    while (current) {
-        ssize_t sock = current->client.socket;
-
-        bool exclude = (sock == exclude_client1) || (exclude_client2 != -1 && sock == exclude_client2);
-
-        if (!exclude) {
-            send_json_message(create_broadcast(event_type, data), sock);
-        }
-
-        current = current->next;
-    }
-    
-    pthread_mutex_unlock(&server->clients_mutex);
-    printf("[Info - messages.send_broadcast] Messaggi inviati correttamente\n");
-    return true;
-}
-
-/**
- * Invia un messaggio ad uno specifico player.
- * Ritorna true se il messaggio è stato inviato correttamente, false altrimenti.
- */
-bool send_to_player(server_t* server, json_t* json_data, const char* username, bool already_locked) {
-    if (!username || !json_data) return false;
-
-    if (!already_locked) pthread_mutex_lock(&server->clients_mutex);
-    
-    client_node_t* current = connected_clients->head;
-    while (current) {
-        if (strcmp(current->client.username, username) == 0) {
-            int sock = current->client.socket;
-            if (!send_json_message(json_data, sock)) {
-                printf("[Errore - messages.send_to_player] Invio messaggio al player %s fallito\n", username);
-
-                if (!already_locked) pthread_mutex_unlock(&server->clients_mutex);
-                free(json_data);
-                return false;
-            }
-
-            break;
-        }
-        current = current->next;
-    }
-    
-    if (!already_locked) pthread_mutex_unlock(&server->clients_mutex);
-    free(json_data);
-
-    printf("[Info - messages.send_to_player] Invio messaggio al player %s riuscito\n", username);
-    return true;
-}
-
-
-/**
- * Invia un messaggio Json aggiungendo un delimitatore di fine (come \n) assicurandosi che l'intero messaggio venga inviato
- * anche se la rete o la connessione non permettono di inviarlo tutto in un'unica volta.
- * Ritorna ture se il messaggio è stato inviato correttamente, false altrimenti.
- */
-bool send_json_message(json_t* json_data, const size_t sock) {
-    if (!json_data) return false;
-
-    // Serializzazione il JSON
-    char* json_str = json_dumps(json_data, JSON_COMPACT);
-    if (!json_str){
-        printf("[Errore - messages.send_json_message] Errore serializzazione del messaggio json\n");
-        return false;
-    }
-
-    //Calcolo della lunghezza (size_t in network byte order)
-    uint32_t json_len = (uint32_t)strlen(json_str);
-    uint32_t net_len = htonl(json_len);
-
-    //Invio lunghezza del messaggio
-    if (!send_all_bytes(sock, &net_len, sizeof(net_len))) {
-        printf("[Errore - messages.send_json_message] Errore invio lunghezza messaggio\n");
-        free(json_str);
-        return false;
-    }
-
-    //Invio del JSON
-    if(!send_all_bytes(sock, json_str, json_len)){
-        printf("[Errore - messages.send_json_message] Errore invio messaggio\n");
-    }
-
-    printf("[Info - messages.send_json_message] Messaggio inviato correttamente al client %ld: %s\n", sock, json_str);
-    free(json_str);
-    return true;
-}
-
-/**
- * Crea una richiesta standard in formato json specificando il tipo di richiesta e una descrizione.
- * Ritorna la richiesta json il caso di corretta creazione, NULL altrimenti.
- */
-json_t* create_request(const char* request_type, const char* description, json_t* data) {
-    json_t* msg = json_object();
-    if (!msg){
-        printf("[Errore - messages.create_request] Creazione della richiesta Json fallita");
-        return NULL;
-    }
-
-    json_object_set_new(msg, "type", json_string("request"));
-    json_object_set_new(msg, "request", json_string(request_type));
-    json_object_set_new(msg, "description", json_string(description));
-    
-    if(data){
-        json_object_set_new(msg, "data", data);
-    }
-    
-    return msg;
-}
-
-/**
- * Crea una risposta standard in formato json specificando il tipo di risposta e una descrizione.
- * Ritorna la risposta json il caso di corretta creazione, NULL altrimenti.
- */
-json_t* create_response(const char* response_type, bool status, const char* description, json_t* data) {
-    json_t* msg = json_object();
-    if (!msg){
-        printf("[Errore - messages.create_response] Creazione della risposta Json fallita");
-        return NULL;
-    }
-
-    json_object_set_new(msg, "type", json_string("response"));
-    json_object_set_new(msg, "response", json_string(response_type));
-
-    status ? json_object_set_new(msg, "status", json_string("ok")) : json_object_set_new(msg, "status", json_string("error")); 
-    
-    json_object_set_new(msg, "description", json_string(description));
-    
-    if(data){
-        json_object_set_new(msg, "data", data);
-    }
-
-    return msg;
-}
-
-/**
- * Gestisce la ricezione di un messaggio. 
- * Il metodo si aspetta prima la lunghezza del messaggio e successivamente il messaggio
- * Ritorna il file json se la ricezione è avvenuta correttamente, NULL altrimenti.
- */
-json_t* receive_json(const size_t socket) {
-    uint32_t net_len;
-    if (recv(socket, &net_len, sizeof(net_len), MSG_WAITALL) != sizeof(net_len)) {
-        printf("[Errore - messages.receive_json] Ricezione della lunghezza del messaggio fallita\n");
-        return NULL;
-    }
-
-    size_t len = ntohl(net_len);
-    if (len == 0 || len > MAX_JSON_SIZE) {
-        printf("[Errore - messages.receive_json] Lunghezza del messaggio non valida, deve essere compresa tra 1 e %d bytes", MAX_JSON_SIZE);
-        return NULL;
-    }
-
-    char* json_str = malloc(len + 1);
-    if (!json_str){
-        printf("[Errore - messages.receive_json] Impossibile allocare memoria per il messaggio ricevuto\n");
-        return NULL;
-    }
-
-    if (recv(socket, json_str, len, MSG_WAITALL) != (ssize_t)len) {
-        printf("[Errore - messages.receive_json] Ricezione del messaggio fallita\n");
-        free(json_str);
-        return NULL;
-    }
-
-    json_str[len] = '\0';
-
-    json_error_t error;
-    json_t* root = json_loads(json_str, 0, &error);
-    free(json_str);
-
-    return root;
-}
\ No newline at end of file
+#include "messages.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "client.h"
+#include "game.h"
+#include "lobby.h"
+#include "output.h"
+#include "encoder.h"
+#include "binary.h"
+#include "logger.h"
+
+//============ METODI PRIVATI ==================//
+
+/**
+ * Scrive direttamente in un nuovo frame il messaggio {"type":type,kind:name,"status":status,"description":description,"data":data},
+ * omettendo status, description e data se NULL. kind è la chiave del nome nella forma ,"response": Il risultato è identico alla serializzazione con JSON_COMPACT
+ * del messaggio costruito con create_response o create_request, o del messaggio di broadcast.
+ * Ritorna il frame, NULL in caso di errore
+ */
+static frame_t* build_frame(const char* type, const char* kind, const char* name, const char* status,
+                            const char* description, const char* data, size_t data_len) {
+    // Ogni carattere di una stringa occupa al più 6 byte una volta sostituito dal suo escape
+    size_t strings = strlen(type) + strlen(kind) + (name ? strlen(name) : 0) + (status ? strlen(status) : 0) + (description ? strlen(description) : 0);
+    size_t capacity = 64 + strings * 6 + (data ? data_len : 0);
+
+    frame_t* frame = frame_alloc(capacity);
+    if (!frame) return NULL;
+
+    encoder_t encoder;
+    encoder_init(&encoder, frame_payload(frame), capacity);
+
+    encoder_raw(&encoder, "{\"type\":", 8);
+    encoder_string(&encoder, type);
+    encoder_string_field(&encoder, kind, name);
+    if (status) encoder_string_field(&encoder, ",\"status\":", status);
+    encoder_string_field(&encoder, ",\"description\":", description);
+    if (data) {
+        encoder_raw(&encoder, ",\"data\":", 8);
+        encoder_raw(&encoder, data, data_len);
+    }
+    encoder_raw(&encoder, "}", 1);
+
+    if (encoder.overflow) {
+        log_error("messages.build_frame", "Serializzazione del messaggio %s fallita", type);
+        frame_release(frame);
+        return NULL;
+    }
+
+    frame_finish(frame, encoder.length);
+    return frame;
+}
+
+/**
+ * Scrive a tutti i client connessi esclusi exclude_client1 e exclude_client2 il frame json,
+ * o il frame binary ai client con protocollo binario se non è NULL. Da chiamare con clients_mutex acquisito.
+ * Ritorna true se il messaggio è stato inviato a tutti i client connessi, false altrimenti.
+ */
+static bool write_broadcast(frame_t* json, frame_t* binary, const ssize_t exclude_client1, const ssize_t exclude_client2) {
+    bool all_sent = true;
+
+    // Invio messaggi a tutti i client
+    client_node_t* current = connected_clients->head;
+    while (current) {
+        ssize_t sock = current->client.socket;
+
+        bool exclude = (sock == exclude_client1) || (exclude_client2 != -1 && sock == exclude_client2);
+        frame_t* frame = (binary && current->client.protocol == PROTOCOL_BINARY) ? binary : json;
+
+        if (!exclude && !send_frame(frame, sock)) {
+            all_sent = false;
+        }
+
+        current = current->next;
+    }
+
+    return all_sent;
+}
+
+/**
+ * Invia in broadcast a tutti i client connessi esclusi exclude_client1 e exclude_client2 il frame json,
+ * o il frame binary ai client con protocollo binario se non è NULL. I riferimenti dei frame restano al chiamante.
+ * Ritorna true se il messaggio è stato inviato a tutti i client connessi, false altrimenti.
+ */
+static bool broadcast_frames(server_t* server, frame_t* json, frame_t* binary, const ssize_t exclude_client1, const ssize_t exclude_client2) {
+    pthread_mutex_lock(&server->clients_mutex);
+    bool all_sent = write_broadcast(json, binary, exclude_client1, exclude_client2);
+    pthread_mutex_unlock(&server->clients_mutex);
+    return all_sent;
+}
+
+/**
+ * Riserva una notifica nell'outbox. Ritorna la notifica azzerata, NULL se l'outbox è pieno
+ */
+static outbox_entry_t* outbox_push(outbox_t* outbox) {
+    if (outbox->count >= OUTBOX_MAX) {
+        log_error("messages.outbox_push", "Outbox pieno, notifica scartata");
+        return NULL;
+    }
+
+    outbox_entry_t* entry = &outbox->entries[outbox->count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->sock = -1;
+    entry->exclude[0] = -1;
+    entry->exclude[1] = -1;
+    return entry;
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+
+/**
+ * Invia i dati di aggiornamento della partita. 
+ * Il parametro mover indica chi ha effettuato la mossa, dunque invia lo stato della 
+ * partita aggiornata come risposta a quest'ultimo e all'avversario una richiesta allo 
+ * scopo di aggiornare i dati che ha. I client con protocollo binario ricevono BINARY_GAME_UPDATE,
+ * quelli con aggiornamenti incrementali la sola mossa (vedi game_encode_delta) al posto dell'intera partita.
+ * I frame vengono composti con il lock della partita e inviati dopo averlo rilasciato.
+ * Se la mossa ha concluso la partita ne aggiorna anche la vista nella lobby.
+ * Ritorna true se il messaggio è stato inviato correttamente ad entrambi i giocatori (al solo player1 nelle partite contro il bot),
+ * false altrimenti.
+ */
+bool send_game_update(server_t* server, game_t* game, player_id_t mover){
+    // I giocatori di una partita avviata non cambiano: i destinatari vengono cercati senza il lock della partita
+    player_id_t players[2];
+    game_lock(game);
+    players[0] = game->player1;
+    players[1] = game->player2;
+    game_unlock(game);
+
+    // Socket e formato di entrambi i giocatori con una sola acquisizione di clients_mutex
+    ssize_t sock_client[2] = {-1, -1};
+    client_protocol_t protocol[2] = {PROTOCOL_JSON, PROTOCOL_JSON};
+    bool delta[2] = {false, false};
+
+    pthread_mutex_lock(&server->clients_mutex);
+    for (int i = 0; i < 2; i++) {
+        client_t* client = client_lookup_username(player_name(players[i]));
+        if (client) {
+            sock_client[i] = client->socket;
+            protocol[i] = client->protocol;
+            delta[i] = client->delta_updates;
+        }
+    }
+    pthread_mutex_unlock(&server->clients_mutex);
+
+    // Con il lock della partita vengono solo composti i frame, inviati dopo averlo rilasciato
+    outbox_t outbox;
+    outbox_init(&outbox);
+    game_lock(game);
+
+    // La partita viene serializzata per intero solo se almeno un destinatario la riceve in questo formato
+    size_t game_len = 0;
+    const char* game_json = NULL;
+    bool full[2] = {protocol[0] == PROTOCOL_JSON && !delta[0], protocol[1] == PROTOCOL_JSON && !delta[1]};
+    if (game->state == GAME_OVER || full[0] || full[1]) {
+        game_json = game_encode(game, &game_len);
+        if (!game_json) {
+            game_unlock(game);
+            log_error("messages.send_game_update", "Serializzazione della partita fallita");
+            return false;
+        }
+    }
+
+    const char* description = "La partita è ancora in corso";
+    if(game->state == GAME_OVER){
+        // La mossa ha concluso la partita: la lobby riusa la serializzazione appena fatta
+        lobby_store(game, game_json, game_len);
+
+        outbox_broadcast(&outbox, create_broadcast_frame("game_ended", game_json, game_len),
+            binary_lobby_event("game_ended", game), sock_client[0], -1);
+
+        description = game->winner == GAME_WINNER_NONE ? "Partita finita con pareggio" : "Partita finita con vincitore";
+    }
+
+    size_t delta_len = 0;
+    const char* delta_json = NULL;
+    if (delta[0] || delta[1]) {
+        delta_json = game_encode_delta(game, &delta_len);
+        if (!delta_json) {
+            game_unlock(game);
+            outbox_send(server, &outbox);
+            log_error("messages.send_game_update", "Serializzazione della mossa fallita");
+            return false;
+        }
+    }
+
+    // Il bot non ha una socket: nelle partite contro il bot conta solo l'invio a player1
+    bool queued[2] = {false, game->bot != BOT_NONE};
+    bool player1_moved = players[0] == mover;
+
+    for (int i = 0; i < 2; i++) {
+        if (sock_client[i] == -1) continue;
+
+        bool own_move = (i == 0) == player1_moved;
+        frame_t* frame;
+
+        const char* data = delta[i] ? delta_json : game_json;
+        size_t data_len = delta[i] ? delta_len : game_len;
+
+        if (protocol[i] == PROTOCOL_BINARY) {
+            frame = binary_game_update(game, own_move);
+        } else if (own_move) {
+            frame = create_response_frame("game_move", true, description, data, data_len);
+        } else {
+            frame = create_request_frame("game_update", description, data, data_len);
+        }
+
+        queued[i] = outbox_frame_to_socket(&outbox, sock_client[i], frame);
+    }
+
+    game_unlock(game);
+
+    if(outbox_send(server, &outbox) && queued[0] && queued[1]){
+        log_info("messages.send_game_update", "I dati di aggiornamento della partita sono stati inviati correttamente");
+        return true;
+    }
+
+    log_error("messages.send_game_update", "Invio dei dati di aggiornamento  della partita fallito");
+    return false;
+}
+
+/**
+ * Invia un messaggio in broadcast a tutti i client connessi esclusi exclude_client1 e exclude_client2.
+ * Il messaggio viene serializzato una sola volta e lo stesso frame viene scritto a ogni destinatario.
+ * La funzione diventa proprietaria di data.
+ * Ritorna ture se il messaggio è stato inviato a tutti i client connessi, false altrimenti.
+ */
+bool send_broadcast(server_t* server, const char* event_type, json_t* data, const ssize_t exclude_client1, const ssize_t exclude_client2) {
+    char* data_str = data ? json_dumps(data, JSON_COMPACT) : NULL;
+    frame_t* binary = data ? binary_lobby_event_from_json(event_type, data) : NULL;
+    json_decref(data);
+
+    if (!data_str) {
+        log_error("messages.send_broadcast", "Il messaggio è vuoto");
+        if (binary) frame_release(binary);
+        return false;
+    }
+
+    frame_t* frame = create_broadcast_frame(event_type, data_str, strlen(data_str));
+    free(data_str);
+    if (!frame) {
+        log_error("messages.send_broadcast", "Serializzazione del messaggio %s fallita", event_type);
+        if (binary) frame_release(binary);
+        return false;
+    }
+
+    bool sent = broadcast_frames(server, frame, binary, exclude_client1, exclude_client2);
+    frame_release(frame);
+    if (binary) frame_release(binary);
+
+    if (!sent) {
+        log_error("messages.send_broadcast", "Invio del messaggio %s non riuscito a tutti i client", event_type);
+        return false;
+    }
+
+    log_info("messages.send_broadcast", "Messaggi inviati correttamente");
+    return true;
+}
+
+/**
+ * Invia in broadcast a tutti i client connessi esclusi exclude_client1 e exclude_client2 un messaggio il cui campo data
+ * è il json già serializzato data di data_len byte. Il frame viene costruito una sola volta per tutti i destinatari.
+ * Se game non è NULL i client con protocollo binario ricevono l'evento costruito dalla partita, il cui lock deve essere acquisito.
+ * Ritorna ture se il messaggio è stato inviato a tutti i client connessi, false altrimenti.
+ */
+bool send_broadcast_raw(server_t* server, const char* event_type, const char* data, const size_t data_len, const game_t* game, const ssize_t exclude_client1, const ssize_t exclude_client2) {
+    if (!data || strlen(event_type) == 0) {
+        log_error("messages.send_broadcast_raw", "Il messaggio o il tipo di evento è vuoto");
+        return false;
+    };
+
+    frame_t* frame = create_broadcast_frame(event_type, data, data_len);
+    if (!frame) {
+        log_error("messages.send_broadcast_raw", "Serializzazione del messaggio %s fallita", event_type);
+        return false;
+    }
+
+    frame_t* binary = game ? binary_lobby_event(event_type, game) : NULL;
+    bool all_sent = broadcast_frames(server, frame, binary, exclude_client1, exclude_client2);
+
+    frame_release(frame);
+    if (binary) frame_release(binary);
+
+    if (!all_sent) {
+        log_error("messages.send_broadcast_raw", "Invio del messaggio %s non riuscito a tutti i client", event_type);
+        return false;
+    }
+
+    log_info("messages.send_broadcast_raw", "Messaggi inviati correttamente");
+    return true;
+}
+
+/**
+ * Invia un messaggio ad uno specifico player.
+ * Ritorna true se il messaggio è stato inviato correttamente, false altrimenti.
+ */
+bool send_to_player(server_t* server, json_t* json_data, const char* username, bool already_locked) {
+    if (!username || !json_data) return false;
+
+    if (!already_locked) pthread_mutex_lock(&server->clients_mutex);
+    
+    client_t* client = client_lookup_username(username);
+    if (client && !send_json_message(json_data, client->socket)) {
+        log_error("messages.send_to_player", "Invio messaggio al player %s fallito", username);
+
+        if (!already_locked) pthread_mutex_unlock(&server->clients_mutex);
+        return false;
+    }
+    
+    if (!already_locked) pthread_mutex_unlock(&server->clients_mutex);
+
+    log_info("messages.send_to_player", "Invio messaggio al player %s riuscito", username);
+    return true;
+}
+
+
+/**
+ * Invia un messaggio Json aggiungendo un delimitatore di fine (come \n) assicurandosi che l'intero messaggio venga inviato
+ * anche se la rete o la connessione non permettono di inviarlo tutto in un'unica volta.
+ * Ritorna ture se il messaggio è stato inviato correttamente, false altrimenti.
+ */
+bool send_json_message(json_t* json_data, const size_t sock) {
+    if (!json_data) return false;
+
+    // Serializzazione del JSON direttamente nel frame da accodare
+    frame_t* frame = frame_from_json(json_data);
+    if (!frame){
+        log_error("messages.send_json_message", "Errore serializzazione del messaggio json");
+        return false;
+    }
+
+    bool sent = send_frame(frame, sock);
+    frame_release(frame);
+    return sent;
+}
+
+/**
+ * Accoda un frame già costruito (prefisso di lunghezza compreso) sulla coda di uscita del socket sock.
+ * L'invio avviene con scritture non bloccanti al termine della richiesta in corso.
+ * Ritorna true se il frame è stato accodato correttamente, false altrimenti.
+ */
+bool send_frame(frame_t* frame, const size_t sock) {
+    if (!frame) return false;
+
+    if (!output_send(frame, (int)sock)) {
+        log_error("messages.send_frame", "Errore invio messaggio al client %ld", sock);
+        return false;
+    }
+
+    if (binary_is_message(frame_payload(frame), frame_payload_length(frame))) {
+        log_debug("messages.send_frame", "Messaggio binario 0x%02x di %zu byte accodato correttamente per il client %ld",
+            (unsigned char)frame_payload(frame)[0], frame_payload_length(frame), sock);
+        return true;
+    }
+
+    log_debug("messages.send_frame", "Messaggio accodato correttamente per il client %ld: %.*s", sock,
+        (int)frame_payload_length(frame), frame_payload(frame));
+    return true;
+}
+
+/**
+ * Crea una richiesta standard in formato json specificando il tipo di richiesta e una descrizione.
+ * Ritorna la richiesta json il caso di corretta creazione, NULL altrimenti.
+ */
+json_t* create_request(const char* request_type, const char* description, json_t* data) {
+    json_t* msg = json_object();
+    if (!msg){
+        log_error("messages.create_request", "Creazione della richiesta Json fallita");
+        return NULL;
+    }
+
+    json_object_set_new(msg, "type", json_string("request"));
+    json_object_set_new(msg, "request", json_string(request_type));
+    json_object_set_new(msg, "description", json_string(description));
+    
+    if(data){
+        json_object_set_new(msg, "data", data);
+    }
+    
+    return msg;
+}
+
+/**
+ * Crea una risposta standard in formato json specificando il tipo di risposta e una descrizione.
+ * Ritorna la risposta json il caso di corretta creazione, NULL altrimenti.
+ */
+json_t* create_response(const char* response_type, bool status, const char* description, json_t* data) {
+    json_t* msg = json_object();
+    if (!msg){
+        log_error("messages.create_response", "Creazione della risposta Json fallita");
+        return NULL;
+    }
+
+    json_object_set_new(msg, "type", json_string("response"));
+    json_object_set_new(msg, "response", json_string(response_type));
+
+    status ? json_object_set_new(msg, "status", json_string("ok")) : json_object_set_new(msg, "status", json_string("error")); 
+    
+    json_object_set_new(msg, "description", json_string(description));
+    
+    if(data){
+        json_object_set_new(msg, "data", data);
+    }
+
+    return msg;
+}
+
+/**
+ * Crea direttamente il frame di una risposta standard il cui campo data è il json serializzato data di data_len byte
+ * (omesso se data è NULL), senza costruire l'albero json. Il contenuto è identico a quello di create_response serializzato con JSON_COMPACT.
+ * Ritorna il frame, NULL in caso di errore.
+ */
+frame_t* create_response_frame(const char* response_type, bool status, const char* description, const char* data, size_t data_len) {
+    return build_frame("response", ",\"response\":", response_type, status ? "ok" : "error", description, data, data_len);
+}
+
+/**
+ * Crea direttamente il frame di una richiesta standard il cui campo data è il json serializzato data di data_len byte
+ * (omesso se data è NULL), senza costruire l'albero json. Il contenuto è identico a quello di create_request serializzato con JSON_COMPACT.
+ * Ritorna il frame, NULL in caso di errore.
+ */
+frame_t* create_request_frame(const char* request_type, const char* description, const char* data, size_t data_len) {
+    return build_frame("request", ",\"request\":", request_type, NULL, description, data, data_len);
+}
+
+/**
+ * Crea il frame di un evento broadcast il cui campo data è il json già serializzato data di data_len byte.
+ * Ritorna il frame, NULL in caso di errore.
+ */
+frame_t* create_broadcast_frame(const char* event_type, const char* data, size_t data_len) {
+    return build_frame("broadcast", ",\"event\":", event_type, NULL, NULL, data, data_len);
+}
+
+/**
+ * Inizializza un outbox vuoto
+ */
+void outbox_init(outbox_t* outbox) {
+    outbox->count = 0;
+}
+
+/**
+ * Aggiunge all'outbox il frame per il giocatore username, la cui socket viene cercata all'invio.
+ * L'outbox diventa proprietario del riferimento al frame. Ritorna true se la notifica è stata aggiunta, false altrimenti
+ */
+bool outbox_frame_to_player(outbox_t* outbox, const char* username, frame_t* frame) {
+    outbox_entry_t* entry = (frame && username) ? outbox_push(outbox) : NULL;
+    if (!entry) {
+        if (frame) frame_release(frame);
+        return false;
+    }
+
+    entry->frame = frame;
+    strncpy(entry->username, username, sizeof(entry->username) - 1);
+    return true;
+}
+
+/**
+ * Aggiunge all'outbox il messaggio json per il giocatore username, serializzato solo all'invio.
+ * L'outbox diventa proprietario del json. Ritorna true se la notifica è stata aggiunta, false altrimenti
+ */
+bool outbox_json_to_player(outbox_t* outbox, const char* username, json_t* json) {
+    outbox_entry_t* entry = (json && username) ? outbox_push(outbox) : NULL;
+    if (!entry) {
+        json_decref(json);
+        return false;
+    }
+
+    entry->json = json;
+    strncpy(entry->username, username, sizeof(entry->username) - 1);
+    return true;
+}
+
+/**
+ * Aggiunge all'outbox il frame per la socket sock.
+ * L'outbox diventa proprietario del riferimento al frame. Ritorna true se la notifica è stata aggiunta, false altrimenti
+ */
+bool outbox_frame_to_socket(outbox_t* outbox, const ssize_t sock, frame_t* frame) {
+    outbox_entry_t* entry = frame ? outbox_push(outbox) : NULL;
+    if (!entry) {
+        if (frame) frame_release(frame);
+        return false;
+    }
+
+    entry->frame = frame;
+    entry->sock = sock;
+    return true;
+}
+
+/**
+ * Aggiunge all'outbox il broadcast del frame json, o del frame binary ai client con protocollo binario se non è NULL,
+ * a tutti i client connessi esclusi exclude_client1 e exclude_client2. L'outbox diventa proprietario dei riferimenti ai frame.
+ * Ritorna true se la notifica è stata aggiunta, false altrimenti
+ */
+bool outbox_broadcast(outbox_t* outbox, frame_t* json, frame_t* binary, const ssize_t exclude_client1, const ssize_t exclude_client2) {
+    outbox_entry_t* entry = json ? outbox_push(outbox) : NULL;
+    if (!entry) {
+        if (json) frame_release(json);
+        if (binary) frame_release(binary);
+        return false;
+    }
+
+    entry->frame = json;
+    entry->binary = binary;
+    entry->exclude[0] = exclude_client1;
+    entry->exclude[1] = exclude_client2;
+    entry->broadcast = true;
+    return true;
+}
+
+/**
+ * Invia le notifiche dell'outbox con una sola acquisizione di clients_mutex e lo svuota.
+ * Da chiamare senza games_mutex né lock di partita acquisiti.
+ * Ritorna true se tutte le notifiche sono state accodate, false altrimenti
+ */
+bool outbox_send(server_t* server, outbox_t* outbox) {
+    bool all_sent = true;
+
+    // I json vengono serializzati prima di acquisire clients_mutex
+    for (size_t i = 0; i < outbox->count; i++) {
+        outbox_entry_t* entry = &outbox->entries[i];
+        if (!entry->json) continue;
+
+        entry->frame = frame_from_json(entry->json);
+        json_decref(entry->json);
+        entry->json = NULL;
+        if (!entry->frame) {
+            log_error("messages.outbox_send", "Errore serializzazione del messaggio json");
+            all_sent = false;
+        }
+    }
+
+    pthread_mutex_lock(&server->clients_mutex);
+
+    for (size_t i = 0; i < outbox->count; i++) {
+        outbox_entry_t* entry = &outbox->entries[i];
+        if (!entry->frame) continue;
+
+        if (entry->broadcast) {
+            if (!write_broadcast(entry->frame, entry->binary, entry->exclude[0], entry->exclude[1])) all_sent = false;
+            continue;
+        }
+
+        ssize_t sock = entry->sock;
+        if (entry->username[0] != '\0') {
+            client_t* client = client_lookup_username(entry->username);
+            if (!client) continue;      // Giocatore disconnesso: non c'è nessuno da notificare
+            sock = client->socket;
+        }
+
+        if (!send_frame(entry->frame, sock)) {
+            log_error("messages.outbox_send", "Invio messaggio al client %ld fallito", sock);
+            all_sent = false;
+        }
+    }
+
+    pthread_mutex_unlock(&server->clients_mutex);
+
+    for (size_t i = 0; i < outbox->count; i++) {
+        if (outbox->entries[i].frame) frame_release(outbox->entries[i].frame);
+        if (outbox->entries[i].binary) frame_release(outbox->entries[i].binary);
+    }
+    outbox->count = 0;
+    return all_sent;
+}
+
+/**
+ * Gestisce la ricezione di un messaggio dalla socket, usando reader come buffer di ricezione della connessione.
+ * Se il buffer contiene già un frame completo (più richieste arrivate con la stessa lettura) non legge dalla socket,
+ * altrimenti legge dalla socket, ricevendo a ogni lettura tutti i dati disponibili, finché il frame non è completo.
+ * Ritorna il messaggio senza prefisso, valido fino alla ricezione successiva, e ne scrive la lunghezza in len, NULL in caso di errore.
+ */
+const char* receive_frame(const size_t socket, frame_reader_t* reader, size_t* len) {
+    const char* payload;
+    size_t payload_len;
+    int ready;
+
+    while ((ready = frame_reader_next(reader, &payload, &payload_len)) == 0) {
+        size_t space;
+        char* free_space = frame_reader_space(reader, &space);
+        if (!free_space) return NULL;
+
+        ssize_t received = recv(socket, free_space, space, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) {
+            log_error("messages.receive_frame", "Ricezione del messaggio fallita");
+            return NULL;
+        }
+
+        frame_reader_commit(reader, (size_t)received);
+    }
+
+    if (ready < 0) {
+        log_error("messages.receive_frame", "Lunghezza del messaggio non valida, deve essere compresa tra 1 e %d bytes", MAX_JSON_SIZE);
+        return NULL;
+    }
+
+    *len = payload_len;
+    return payload;
+}
@@ -0,0 +1,751 @@
+#define _GNU_SOURCE
+
+#include "output.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "logger.h"
+
+#define OUTPUT_MAX_SOCKETS (1 << 20)
+
+static output_t output;
+
+// Code riempite dal thread corrente e non ancora svuotate, collegate tramite next_scheduled
+static _Thread_local int pending_head = -1;
+
+// Scritture del reactor io_uring eseguito dal thread corrente, NULL negli altri thread
+static _Thread_local output_ring_t* current_ring = NULL;
+
+//============ METODI PRIVATI ==================//
+/**
+ * Ritorna i secondi trascorsi da un istante fisso, non influenzati dalle modifiche all'orologio di sistema
+ */
+static time_t monotonic_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+/**
+ * Ritorna la coda di uscita della socket sock, NULL se il suo blocco non è mai stato allocato
+ */
+static output_queue_t* lookup_queue(const int sock) {
+    if (sock < 0 || (size_t)sock >= output.block_count * OUTPUT_BLOCK_SIZE) return NULL;
+
+    output_block_t* block = atomic_load_explicit(&output.blocks[sock / OUTPUT_BLOCK_SIZE], memory_order_acquire);
+    return block ? &block->queues[sock % OUTPUT_BLOCK_SIZE] : NULL;
+}
+
+/**
+ * Ritorna la coda di uscita della socket sock, allocandone il blocco se necessario.
+ * Ritorna NULL in caso di errore di allocazione o se sock supera il numero massimo di descrittori
+ */
+static output_queue_t* get_queue(const int sock) {
+    output_queue_t* queue = lookup_queue(sock);
+    if (queue || sock < 0 || (size_t)sock >= output.block_count * OUTPUT_BLOCK_SIZE) return queue;
+
+    pthread_mutex_lock(&output.blocks_mutex);
+
+    size_t index = sock / OUTPUT_BLOCK_SIZE;
+    output_block_t* block = atomic_load_explicit(&output.blocks[index], memory_order_relaxed);
+    if (!block) {
+        block = calloc(1, sizeof(output_block_t));
+        if (!block) {
+            pthread_mutex_unlock(&output.blocks_mutex);
+            return NULL;
+        }
+
+        for (size_t i = 0; i < OUTPUT_BLOCK_SIZE; i++) {
+            pthread_mutex_init(&block->queues[i].lock, NULL);
+            pthread_cond_init(&block->queues[i].idle, NULL);
+            block->queues[i].next_scheduled = -1;
+            block->queues[i].next_watched = -1;
+            block->queues[i].next_ready = -1;
+        }
+        atomic_store_explicit(&output.blocks[index], block, memory_order_release);
+    }
+
+    pthread_mutex_unlock(&output.blocks_mutex);
+    return &block->queues[sock % OUTPUT_BLOCK_SIZE];
+}
+
+/**
+ * Rilascia tutti i frame in coda. Da chiamare con il lock della coda acquisito e nessun thread in scrittura
+ */
+static void drop_frames(output_queue_t* queue) {
+    for (size_t i = 0; i < queue->count; i++) {
+        frame_release(queue->frames[(queue->head + i) % queue->capacity]);
+    }
+
+    queue->head = 0;
+    queue->count = 0;
+    queue->offset = 0;
+    queue->queued_bytes = 0;
+    queue->above_since = 0;
+}
+
+/**
+ * Disconnette un client che non legge abbastanza velocemente: scarta la sua coda e chiude la socket in entrambe
+ * le direzioni, così che il thread o il reactor che la serve esegua la normale pulizia della connessione.
+ * Da chiamare con il lock della coda acquisito
+ */
+static void evict(output_queue_t* queue, const int sock, const char* reason) {
+    queue->evicted = true;
+    if (!queue->writing) drop_frames(queue);
+
+    shutdown(sock, SHUT_RDWR);
+    atomic_fetch_add(&output.evictions, 1);
+    log_info("output.evict", "Client %d disconnesso: %s", sock, reason);
+}
+
+/**
+ * Aggiunge la coda alla lista controllata periodicamente dal thread di output, che disconnette il client
+ * se la coda resta oltre la soglia di attenzione per troppo tempo. Da chiamare con il lock della coda acquisito
+ */
+static void watch_queue(output_queue_t* queue, const int sock) {
+    if (queue->watched) return;
+
+    pthread_mutex_lock(&output.watch_mutex);
+    queue->watched = true;
+    queue->next_watched = output.watch_head;
+    output.watch_head = sock;
+    pthread_mutex_unlock(&output.watch_mutex);
+}
+
+/**
+ * Raddoppia la capacità del buffer circolare della coda mantenendo l'ordine dei frame.
+ * Ritorna true se il buffer è stato ingrandito, false in caso di errore di allocazione
+ */
+static bool grow_queue(output_queue_t* queue) {
+    size_t capacity = queue->capacity ? queue->capacity * 2 : 8;
+    frame_t** frames = malloc(capacity * sizeof(frame_t*));
+    if (!frames) return false;
+
+    for (size_t i = 0; i < queue->count; i++) {
+        frames[i] = queue->frames[(queue->head + i) % queue->capacity];
+    }
+
+    free(queue->frames);
+    queue->frames = frames;
+    queue->capacity = capacity;
+    queue->head = 0;
+    return true;
+}
+
+/**
+ * Chiede al thread di output di riprendere l'invio quando la socket torna scrivibile.
+ * Da chiamare con il lock della coda acquisito
+ */
+static void wait_writable(output_queue_t* queue, const int sock) {
+    struct epoll_event event = {
+        .events = EPOLLOUT | EPOLLONESHOT,
+        .data.fd = sock
+    };
+
+    int op = queue->in_epoll ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(output.epoll_fd, op, sock, &event) < 0) {
+        log_error("output.wait_writable", "Registrazione della socket %d per la scrittura fallita", sock);
+        evict(queue, sock, "impossibile attendere che la socket torni scrivibile");
+        return;
+    }
+
+    queue->in_epoll = true;
+    atomic_fetch_add(&output.stalls, 1);
+}
+
+/**
+ * Mette la coda tra quelle che il reactor io_uring proprietario deve inviare, risvegliandolo se è un altro thread
+ * ad accodare i frame. Da chiamare con il lock della coda acquisito
+ */
+static void schedule_ring(output_queue_t* queue, const int sock) {
+    output_ring_t* ring = queue->ring;
+    bool wake = false;
+
+    pthread_mutex_lock(&ring->lock);
+    if (!queue->ready) {
+        queue->ready = true;
+        queue->next_ready = ring->ready_head;
+        ring->ready_head = sock;
+
+        // Il reactor svuota la lista prima di ogni attesa: basta risvegliarlo una volta
+        wake = ring != current_ring && !ring->wake_pending;
+        if (wake) ring->wake_pending = true;
+    }
+    pthread_mutex_unlock(&ring->lock);
+
+    uint64_t one = 1;
+    if (wake && write(ring->wake_fd, &one, sizeof(one)) < 0) {
+        log_error("output.schedule_ring", "Risveglio del reactor fallito");
+    }
+}
+
+/**
+ * Prepara in iov i frame in coda a partire dal primo, saltando i byte già inviati.
+ * Ritorna il numero di elementi preparati. Da chiamare con il lock della coda acquisito
+ */
+static size_t gather_frames(output_queue_t* queue, struct iovec* iov) {
+    size_t count = queue->count < OUTPUT_IOV_MAX ? queue->count : OUTPUT_IOV_MAX;
+
+    for (size_t i = 0; i < count; i++) {
+        frame_t* frame = queue->frames[(queue->head + i) % queue->capacity];
+        size_t skip = i == 0 ? queue->offset : 0;
+        iov[i].iov_base = frame->bytes + skip;
+        iov[i].iov_len = frame->length - skip;
+    }
+
+    return count;
+}
+
+/**
+ * Segna come inviati sent byte a partire dal primo frame in coda, rilasciando i frame completati.
+ * Da chiamare con il lock della coda acquisito
+ */
+static void consume_bytes(output_queue_t* queue, size_t sent) {
+    queue->queued_bytes -= sent;
+
+    while (sent > 0) {
+        frame_t* frame = queue->frames[queue->head];
+        size_t remaining = frame->length - queue->offset;
+
+        if (sent < remaining) {
+            queue->offset += sent;
+            return;
+        }
+
+        sent -= remaining;
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        queue->offset = 0;
+        frame_release(frame);
+        atomic_fetch_add_explicit(&output.frames_written, 1, memory_order_relaxed);
+    }
+}
+
+/**
+ * Invia i frame in coda sulla socket sock finché la coda non è vuota o la socket non accetta altri dati.
+ * Tutti i frame accodati vengono scritti con un'unica sendmsg (fino a OUTPUT_IOV_MAX alla volta).
+ * Se un altro thread sta già scrivendo sulla socket non fa nulla: sarà quel thread a inviare anche i nuovi frame.
+ * Il lock della coda non viene mai mantenuto durante una scrittura
+ */
+static void flush_queue(const int sock) {
+    output_queue_t* queue = lookup_queue(sock);
+    if (!queue) return;
+
+    pthread_mutex_lock(&queue->lock);
+    if (!queue->registered || queue->writing) {
+        pthread_mutex_unlock(&queue->lock);
+        return;
+    }
+
+    // Le socket dei reactor io_uring vengono scritte dal loro reactor
+    if (queue->ring) {
+        if (!queue->evicted && queue->count > 0) schedule_ring(queue, sock);
+        pthread_mutex_unlock(&queue->lock);
+        return;
+    }
+    queue->writing = true;
+
+    struct iovec iov[OUTPUT_IOV_MAX];
+    while (queue->registered && !queue->evicted && queue->count > 0) {
+        // I frame raccolti restano in coda, e quindi validi, finché writing è true
+        struct msghdr message = {
+            .msg_iov = iov,
+            .msg_iovlen = gather_frames(queue, iov)
+        };
+        pthread_mutex_unlock(&queue->lock);
+
+        // sendmsg equivale a writev ma accetta MSG_DONTWAIT anche sulle socket bloccanti della modalità threads
+        ssize_t sent = sendmsg(sock, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+        int error = errno;
+
+        pthread_mutex_lock(&queue->lock);
+        if (sent > 0) {
+            atomic_fetch_add_explicit(&output.writes, 1, memory_order_relaxed);
+            consume_bytes(queue, (size_t)sent);
+            continue;
+        }
+
+        if (sent < 0 && error == EINTR) continue;
+
+        if (sent < 0 && (error == EAGAIN || error == EWOULDBLOCK)) {
+            wait_writable(queue, sock);
+            break;
+        }
+
+        // Connessione interrotta: il thread o il reactor che la serve se ne accorgerà alla prossima lettura
+        queue->evicted = true;
+    }
+
+    if (queue->evicted || !queue->registered) drop_frames(queue);
+    if (queue->queued_bytes <= output.high_water) queue->above_since = 0;
+
+    queue->writing = false;
+    pthread_cond_broadcast(&queue->idle);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Controlla le code oltre la soglia di attenzione e disconnette i client rimasti oltre la soglia di attenzione
+ * per più di OUTPUT_STALL_SECONDS. Le code tornate sotto la soglia escono dalla lista: vi rientrano quando
+ * output_send la riporta oltre la soglia
+ */
+static void sweep_stalled(void) {
+    pthread_mutex_lock(&output.watch_mutex);
+    int sock = output.watch_head;
+    output.watch_head = -1;
+    pthread_mutex_unlock(&output.watch_mutex);
+
+    time_t now = monotonic_seconds();
+    while (sock != -1) {
+        output_queue_t* queue = lookup_queue(sock);
+
+        pthread_mutex_lock(&queue->lock);
+        pthread_mutex_lock(&output.watch_mutex);
+        int next = queue->next_watched;
+        queue->next_watched = -1;
+        queue->watched = false;
+        pthread_mutex_unlock(&output.watch_mutex);
+
+        if (queue->registered && !queue->evicted && queue->above_since != 0) {
+            if (now - queue->above_since >= OUTPUT_STALL_SECONDS) {
+                evict(queue, sock, "coda di uscita oltre la soglia di attenzione per troppo tempo");
+            } else {
+                watch_queue(queue, sock);
+            }
+        }
+
+        pthread_mutex_unlock(&queue->lock);
+        sock = next;
+    }
+}
+
+/**
+ * Thread di output: riprende l'invio delle code la cui socket è tornata scrivibile e controlla periodicamente
+ * i client troppo lenti
+ */
+static void* output_loop(void* arg) {
+    (void)arg;
+    struct epoll_event events[OUTPUT_MAX_EVENTS];
+    time_t last_sweep = monotonic_seconds();
+
+    while (!atomic_load(&output.stopping)) {
+        int ready = epoll_wait(output.epoll_fd, events, OUTPUT_MAX_EVENTS, OUTPUT_SWEEP_MS);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            log_error("output.output_loop", "epoll_wait fallita");
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.fd == output.wake_fd) continue;
+            flush_queue(events[i].data.fd);
+        }
+
+        time_t now = monotonic_seconds();
+        if (now != last_sweep) {
+            last_sweep = now;
+            sweep_stalled();
+        }
+    }
+
+    return NULL;
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Inizializza le code di uscita e avvia il thread che completa gli invii rimasti in sospeso.
+ * Ritorna true se l'inizializzazione è andata a buon fine, false altrimenti
+ */
+bool output_init(server_t* server) {
+    output.high_water = server->output_high_water;
+    output.limit = server->output_limit;
+    output.epoll_fd = -1;
+    output.wake_fd = -1;
+    output.watch_head = -1;
+    output.started = false;
+    atomic_init(&output.stopping, false);
+    atomic_init(&output.stalls, 0);
+    atomic_init(&output.evictions, 0);
+    atomic_init(&output.writes, 0);
+    atomic_init(&output.frames_written, 0);
+    pthread_mutex_init(&output.blocks_mutex, NULL);
+    pthread_mutex_init(&output.watch_mutex, NULL);
+
+    // Un blocco di code per ogni OUTPUT_BLOCK_SIZE descrittori che il processo può aprire
+    struct rlimit limit;
+    size_t max_sockets = OUTPUT_MAX_SOCKETS;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < max_sockets) {
+        max_sockets = limit.rlim_cur;
+    }
+    output.block_count = (max_sockets + OUTPUT_BLOCK_SIZE - 1) / OUTPUT_BLOCK_SIZE;
+    output.blocks = calloc(output.block_count, sizeof(*output.blocks));
+    if (!output.blocks) {
+        log_error("output.output_init", "Impossibile allocare memoria per le code di uscita");
+        return false;
+    }
+
+    output.epoll_fd = epoll_create1(0);
+    output.wake_fd = eventfd(0, EFD_NONBLOCK);
+    struct epoll_event event = {
+        .events = EPOLLIN,
+        .data.fd = output.wake_fd
+    };
+    if (output.epoll_fd < 0 || output.wake_fd < 0 || epoll_ctl(output.epoll_fd, EPOLL_CTL_ADD, output.wake_fd, &event) < 0) {
+        log_error("output.output_init", "Creazione dell'istanza epoll di output fallita");
+        output_cleanup();
+        return false;
+    }
+
+    // I segnali vanno gestiti dal solo thread principale
+    sigset_t signals, previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    output.started = pthread_create(&output.thread, NULL, output_loop, NULL) == 0;
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (!output.started) {
+        log_error("output.output_init", "Creazione del thread di output fallita");
+        output_cleanup();
+        return false;
+    }
+
+    log_info("output.output_init", "Code di uscita attive: soglia di attenzione %zu byte, limite %zu byte", output.high_water, output.limit);
+    return true;
+}
+
+/**
+ * Termina il thread di output e libera le code. Da chiamare dopo la chiusura di tutte le connessioni
+ */
+void output_cleanup(void) {
+    if (output.started) {
+        atomic_store(&output.stopping, true);
+
+        uint64_t one = 1;
+        if (write(output.wake_fd, &one, sizeof(one)) < 0) {
+            log_error("output.output_cleanup", "Risveglio del thread di output fallito");
+        }
+        pthread_join(output.thread, NULL);
+        output.started = false;
+    }
+
+    for (size_t i = 0; output.blocks && i < output.block_count; i++) {
+        output_block_t* block = atomic_load(&output.blocks[i]);
+        if (!block) continue;
+
+        for (size_t j = 0; j < OUTPUT_BLOCK_SIZE; j++) {
+            output_queue_t* queue = &block->queues[j];
+            drop_frames(queue);
+            free(queue->frames);
+            free(queue->ring_send);
+            pthread_cond_destroy(&queue->idle);
+            pthread_mutex_destroy(&queue->lock);
+        }
+        free(block);
+    }
+    free(output.blocks);
+    output.blocks = NULL;
+    output.block_count = 0;
+
+    if (output.wake_fd != -1) {
+        close(output.wake_fd);
+        output.wake_fd = -1;
+    }
+
+    if (output.epoll_fd != -1) {
+        close(output.epoll_fd);
+        output.epoll_fd = -1;
+    }
+
+    pthread_mutex_destroy(&output.blocks_mutex);
+    pthread_mutex_destroy(&output.watch_mutex);
+}
+
+/**
+ * Registra la coda di uscita della socket sock appena accettata. Se ring non è NULL i frame vengono inviati
+ * dal reactor io_uring che possiede ring, altrimenti con sendmsg dal thread che li accoda.
+ * Ritorna true se la coda è stata registrata, false in caso di errore di allocazione
+ */
+bool output_register(int sock, output_ring_t* ring) {
+    output_queue_t* queue = get_queue(sock);
+    if (!queue) {
+        log_error("output.output_register", "Impossibile allocare la coda di uscita della socket %d", sock);
+        return false;
+    }
+
+    // I frame vengono già raggruppati prima della scrittura: l'algoritmo di Nagle ritarderebbe solo l'invio
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    pthread_mutex_lock(&queue->lock);
+    queue->registered = true;
+    queue->evicted = false;
+    queue->above_since = 0;
+    queue->ring = ring;
+    pthread_mutex_unlock(&queue->lock);
+    return true;
+}
+
+/**
+ * Scarta i frame ancora in coda per sock, attendendo il thread che sta eventualmente scrivendo.
+ * Una sendmsg del ring ancora in corso viene interrotta con shutdown, perché la connessione viene comunque chiusa.
+ * Da chiamare prima di chiudere la socket, così che nessuna scrittura possa raggiungere un descrittore riassegnato
+ */
+void output_unregister(int sock) {
+    output_queue_t* queue = lookup_queue(sock);
+    if (!queue) return;
+
+    pthread_mutex_lock(&queue->lock);
+    queue->registered = false;
+
+    // La sendmsg del ring viene completata solo dal reactor, che potrebbe essere bloccato in attesa dei worker:
+    // lo shutdown la fa terminare subito, così che il reactor la completi al primo giro del loop
+    if (queue->ring && queue->writing) {
+        shutdown(sock, SHUT_RDWR);
+    }
+
+    while (queue->writing) {
+        pthread_cond_wait(&queue->idle, &queue->lock);
+    }
+
+    drop_frames(queue);
+    if (queue->in_epoll) {
+        epoll_ctl(output.epoll_fd, EPOLL_CTL_DEL, sock, NULL);
+        queue->in_epoll = false;
+    }
+
+    // La socket può essere riassegnata a un altro reactor: la coda non deve restare nella lista di questo
+    if (queue->ring) {
+        pthread_mutex_lock(&queue->ring->lock);
+        if (queue->ready) {
+            int* link = &queue->ring->ready_head;
+            while (*link != sock) link = &lookup_queue(*link)->next_ready;
+            *link = queue->next_ready;
+            queue->next_ready = -1;
+            queue->ready = false;
+        }
+        pthread_mutex_unlock(&queue->ring->lock);
+        queue->ring = NULL;
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Accoda il frame sulla socket sock acquisendone un riferimento. L'invio avviene alla successiva
+ * output_flush_pending del thread chiamante, quindi la funzione può essere chiamata con qualsiasi lock acquisito.
+ * Se la coda supera il limite, o resta oltre la soglia di attenzione per troppo tempo, il client viene disconnesso.
+ * Ritorna true se il frame è stato accodato, false altrimenti
+ */
+bool output_send(frame_t* frame, int sock) {
+    output_queue_t* queue = lookup_queue(sock);
+    if (!frame || !queue) return false;
+
+    pthread_mutex_lock(&queue->lock);
+    if (!queue->registered || queue->evicted) {
+        pthread_mutex_unlock(&queue->lock);
+        return false;
+    }
+
+    // Un singolo frame viene sempre accettato su una coda vuota, anche se più grande del limite
+    size_t queued = queue->queued_bytes + frame->length;
+    if (queue->queued_bytes > 0 && queued > output.limit) {
+        evict(queue, sock, "limite della coda di uscita superato");
+        pthread_mutex_unlock(&queue->lock);
+        return false;
+    }
+
+    if (queued > output.high_water) {
+        time_t now = monotonic_seconds();
+        if (queue->above_since == 0) {
+            // Il thread di output controlla la coda anche se non vengono accodati nuovi frame
+            queue->above_since = now;
+            watch_queue(queue, sock);
+        } else if (now - queue->above_since >= OUTPUT_STALL_SECONDS) {
+            evict(queue, sock, "coda di uscita oltre la soglia di attenzione per troppo tempo");
+            pthread_mutex_unlock(&queue->lock);
+            return false;
+        }
+    }
+
+    if (queue->count == queue->capacity && !grow_queue(queue)) {
+        pthread_mutex_unlock(&queue->lock);
+        log_error("output.output_send", "Impossibile allocare memoria per la coda di uscita della socket %d", sock);
+        return false;
+    }
+
+    queue->frames[(queue->head + queue->count) % queue->capacity] = frame_retain(frame);
+    queue->count++;
+    queue->queued_bytes = queued;
+
+    if (!queue->scheduled) {
+        queue->scheduled = true;
+        queue->next_scheduled = pending_head;
+        pending_head = sock;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return true;
+}
+
+/**
+ * Scrive i frame accodati dal thread chiamante. Da chiamare senza alcun lock acquisito
+ */
+void output_flush_pending(void) {
+    while (pending_head != -1) {
+        int sock = pending_head;
+        output_queue_t* queue = lookup_queue(sock);
+
+        // Da qui in poi un altro thread può riprendere la coda nella propria lista
+        pthread_mutex_lock(&queue->lock);
+        pending_head = queue->next_scheduled;
+        queue->next_scheduled = -1;
+        queue->scheduled = false;
+        pthread_mutex_unlock(&queue->lock);
+
+        flush_queue(sock);
+    }
+}
+
+/**
+ * Inizializza le scritture di un reactor io_uring, che viene risvegliato con wake_fd quando altri thread accodano frame
+ */
+void output_ring_init(output_ring_t* ring, int wake_fd) {
+    pthread_mutex_init(&ring->lock, NULL);
+    ring->ready_head = -1;
+    ring->wake_pending = false;
+    ring->wake_fd = wake_fd;
+}
+
+/**
+ * Libera le risorse di ring. Da chiamare dopo aver rimosso tutte le socket registrate con ring
+ */
+void output_ring_destroy(output_ring_t* ring) {
+    pthread_mutex_destroy(&ring->lock);
+}
+
+/**
+ * Indica che il thread chiamante è il reactor che possiede ring: i frame che accoda per le sue socket
+ * non richiedono di risvegliarlo
+ */
+void output_ring_attach(output_ring_t* ring) {
+    current_ring = ring;
+}
+
+/**
+ * Estrae la prossima socket con frame da inviare tramite ring.
+ * Ritorna la socket, -1 se non ce ne sono
+ */
+int output_ring_next(output_ring_t* ring) {
+    pthread_mutex_lock(&ring->lock);
+
+    int sock = ring->ready_head;
+    if (sock == -1) {
+        // Lista vuota: il prossimo thread che vi aggiunge una coda deve risvegliare il reactor
+        ring->wake_pending = false;
+    } else {
+        output_queue_t* queue = lookup_queue(sock);
+        ring->ready_head = queue->next_ready;
+        queue->next_ready = -1;
+        queue->ready = false;
+    }
+
+    pthread_mutex_unlock(&ring->lock);
+    return sock;
+}
+
+/**
+ * Prepara l'invio dei frame in coda per sock con una sola sendmsg e segna la coda in scrittura.
+ * Ritorna il messaggio da passare a IORING_OP_SENDMSG, NULL se non c'è nulla da inviare
+ */
+struct msghdr* output_ring_prepare(int sock) {
+    output_queue_t* queue = lookup_queue(sock);
+    if (!queue) return NULL;
+
+    pthread_mutex_lock(&queue->lock);
+    if (!queue->ring || !queue->registered || queue->evicted || queue->writing || queue->count == 0) {
+        pthread_mutex_unlock(&queue->lock);
+        return NULL;
+    }
+
+    if (!queue->ring_send) {
+        queue->ring_send = malloc(sizeof(output_ring_send_t));
+        if (!queue->ring_send) {
+            log_error("output.output_ring_prepare", "Impossibile allocare memoria per la scrittura della socket %d", sock);
+            evict(queue, sock, "memoria esaurita");
+            pthread_mutex_unlock(&queue->lock);
+            return NULL;
+        }
+    }
+
+    // I frame raccolti restano in coda, e quindi validi, finché writing è true
+    struct msghdr* message = &queue->ring_send->message;
+    memset(message, 0, sizeof(struct msghdr));
+    message->msg_iov = queue->ring_send->iov;
+    message->msg_iovlen = gather_frames(queue, queue->ring_send->iov);
+    queue->writing = true;
+
+    pthread_mutex_unlock(&queue->lock);
+    return message;
+}
+
+/**
+ * Completa la sendmsg del ring per sock con il risultato result (byte inviati o -errno) e, se restano frame,
+ * rimette la coda tra quelle da inviare
+ */
+void output_ring_completed(int sock, int result) {
+    output_queue_t* queue = lookup_queue(sock);
+    if (!queue) return;
+
+    pthread_mutex_lock(&queue->lock);
+    if (result > 0) {
+        atomic_fetch_add_explicit(&output.writes, 1, memory_order_relaxed);
+        consume_bytes(queue, (size_t)result);
+    } else if (result != -EINTR && result != -EAGAIN) {
+        // Connessione interrotta: il reactor se ne accorgerà alla prossima lettura
+        queue->evicted = true;
+    }
+
+    queue->writing = false;
+    if (queue->evicted || !queue->registered) drop_frames(queue);
+    if (queue->queued_bytes <= output.high_water) queue->above_since = 0;
+    pthread_cond_broadcast(&queue->idle);
+
+    if (queue->ring && queue->registered && !queue->evicted && queue->count > 0) schedule_ring(queue, sock);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Ritorna true se una sendmsg del ring per sock è ancora in corso: la socket non può essere chiusa fino al suo completamento
+ */
+bool output_ring_busy(int sock) {
+    output_queue_t* queue = lookup_queue(sock);
+    if (!queue) return false;
+
+    pthread_mutex_lock(&queue->lock);
+    bool busy = queue->ring && queue->writing;
+    pthread_mutex_unlock(&queue->lock);
+    return busy;
+}
+
+/**
+ * Stampa i frame inviati e le scritture usate per inviarli, il numero di attese di socket scrivibile
+ * e di client disconnessi perché troppo lenti
+ */
+void output_report(void) {
+    log_info("output.output_report", "Code di uscita: %zu frame inviati con %zu scritture, %zu attese di socket scrivibile, %zu client disconnessi perché troppo lenti",
+        atomic_load(&output.frames_written), atomic_load(&output.writes), atomic_load(&output.stalls), atomic_load(&output.evictions));
+}
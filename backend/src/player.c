@@ -0,0 +1,235 @@
+#include "player.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "client.h"
+#include "logger.h"
+
+static player_registry_t registry;
+
+//============ METODI PRIVATI ==================//
+/**
+ * Ritorna l'elemento del registro con l'id indicato. L'id deve essere già stato assegnato
+ */
+static player_entry_t* entry_of(player_id_t id) {
+    player_entry_t* chunk = atomic_load_explicit(&registry.chunks[id / PLAYER_CHUNK_SIZE], memory_order_acquire);
+    return &chunk[id % PLAYER_CHUNK_SIZE];
+}
+
+/**
+ * Cerca l'username nell'indice per nome. Da chiamare con il mutex del registro acquisito.
+ * Ritorna l'id, PLAYER_NONE se non è registrato
+ */
+static player_id_t find_locked(const char* username) {
+    player_id_t id = registry.buckets[username_hash(username) & (registry.bucket_count - 1)];
+    while (id != PLAYER_NONE && strcmp(entry_of(id)->name, username) != 0) {
+        id = entry_of(id)->next;
+    }
+    return id;
+}
+
+/**
+ * Raddoppia i bucket dell'indice per nome e vi ridistribuisce gli id in uso. Da chiamare con il mutex del registro acquisito.
+ * Se la memoria non basta l'indice resta valido, solo più carico
+ */
+static void registry_grow(void) {
+    size_t bucket_count = registry.bucket_count * 2;
+    player_id_t* buckets = calloc(bucket_count, sizeof(player_id_t));
+    if (!buckets) return;
+
+    for (player_id_t id = 1; id < registry.count; id++) {
+        player_entry_t* entry = entry_of(id);
+        if (atomic_load_explicit(&entry->refs, memory_order_relaxed) == 0) continue;
+
+        player_id_t* bucket = &buckets[username_hash(entry->name) & (bucket_count - 1)];
+        entry->next = *bucket;
+        *bucket = id;
+    }
+
+    free(registry.buckets);
+    registry.buckets = buckets;
+    registry.bucket_count = bucket_count;
+}
+
+/**
+ * Ritorna un id non in uso, riusando quelli tornati liberi prima di assegnarne di nuovi.
+ * Da chiamare con il mutex del registro acquisito. Ritorna PLAYER_NONE se il registro è pieno o in caso di errore di allocazione
+ */
+static player_id_t allocate_id(void) {
+    if (registry.free_head != PLAYER_NONE) {
+        player_id_t id = registry.free_head;
+        registry.free_head = entry_of(id)->next;
+        return id;
+    }
+
+    player_id_t id = registry.count;
+    size_t chunk = id / PLAYER_CHUNK_SIZE;
+    if (chunk >= registry.chunk_count) {
+        log_error("player.allocate_id", "Registro dei giocatori pieno");
+        return PLAYER_NONE;
+    }
+
+    if (!atomic_load_explicit(&registry.chunks[chunk], memory_order_relaxed)) {
+        player_entry_t* entries = calloc(PLAYER_CHUNK_SIZE, sizeof(player_entry_t));
+        if (!entries) {
+            log_error("player.allocate_id", "Impossibile allocare memoria per il registro dei giocatori");
+            return PLAYER_NONE;
+        }
+        atomic_store_explicit(&registry.chunks[chunk], entries, memory_order_release);
+    }
+
+    registry.count++;
+    return id;
+}
+
+/**
+ * Toglie l'id dalla catena del suo bucket nell'indice per nome. Da chiamare con il mutex del registro acquisito
+ */
+static void unlink_name(player_id_t id) {
+    player_id_t* link = &registry.buckets[username_hash(entry_of(id)->name) & (registry.bucket_count - 1)];
+    while (*link != PLAYER_NONE && *link != id) {
+        link = &entry_of(*link)->next;
+    }
+    if (*link == id) *link = entry_of(id)->next;
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Inizializza il registro degli username, dimensionato sul numero massimo di client e di partite del server
+ */
+void player_init(server_t* server) {
+    // Un id resta in uso solo finché il client è connesso o una partita lo contiene: oltre ai client e ai due giocatori
+    // di ogni partita si lascia spazio per il bot e per i client che si riconnettono mentre le vecchie attese si chiudono
+    size_t max_ids = 2 * server->max_clients + 2 * server->max_games + 2;
+    registry.chunk_count = max_ids / PLAYER_CHUNK_SIZE + 1;
+    registry.chunks = calloc(registry.chunk_count, sizeof(*registry.chunks));
+
+    // L'id 0 è PLAYER_NONE: il primo chunk viene allocato subito così che player_name(PLAYER_NONE) sia valido
+    player_entry_t* first = calloc(PLAYER_CHUNK_SIZE, sizeof(player_entry_t));
+    registry.bucket_count = PLAYER_REGISTRY_MIN_BUCKETS;
+    registry.buckets = calloc(registry.bucket_count, sizeof(player_id_t));
+    if (!registry.chunks || !first || !registry.buckets) {
+        log_error("player.player_init", "Impossibile allocare memoria per il registro dei giocatori");
+        exit(EXIT_FAILURE);
+    }
+
+    atomic_store_explicit(&registry.chunks[0], first, memory_order_release);
+    registry.count = 1;
+    registry.free_head = PLAYER_NONE;
+    pthread_mutex_init(&registry.mutex, NULL);
+}
+
+/**
+ * Libera la memoria del registro. Da chiamare dopo la terminazione di tutti i thread che usano gli id
+ */
+void player_cleanup(void) {
+    pthread_mutex_lock(&registry.mutex);
+
+    for (size_t i = 0; i < registry.chunk_count; i++) {
+        free(atomic_load(&registry.chunks[i]));
+    }
+    free(registry.chunks);
+    registry.chunks = NULL;
+    registry.chunk_count = 0;
+    free(registry.buckets);
+    registry.buckets = NULL;
+    registry.count = 0;
+
+    pthread_mutex_unlock(&registry.mutex);
+    pthread_mutex_destroy(&registry.mutex);
+}
+
+/**
+ * Ritorna l'id dell'username acquisendone un riferimento, registrandolo se non è in uso.
+ * Ritorna PLAYER_NONE se il registro è pieno o in caso di errore di allocazione
+ */
+player_id_t player_intern(const char* username) {
+    if (!username || username[0] == '\0') return PLAYER_NONE;
+
+    // Lo stesso troncamento dell'username del client, così che nome registrato e username coincidano
+    char name[PLAYER_NAME_SIZE] = {0};
+    strncpy(name, username, sizeof(name) - 1);
+
+    pthread_mutex_lock(&registry.mutex);
+
+    player_id_t id = find_locked(name);
+    if (id != PLAYER_NONE) {
+        atomic_fetch_add_explicit(&entry_of(id)->refs, 1, memory_order_relaxed);
+        pthread_mutex_unlock(&registry.mutex);
+        return id;
+    }
+
+    id = allocate_id();
+    if (id == PLAYER_NONE) {
+        pthread_mutex_unlock(&registry.mutex);
+        log_error("player.player_intern", "Impossibile registrare %s", name);
+        return PLAYER_NONE;
+    }
+
+    // Il nome viene scritto prima che l'id sia restituito: chi lo riceve lo legge già completo
+    player_entry_t* entry = entry_of(id);
+    memcpy(entry->name, name, sizeof(entry->name));
+    atomic_store_explicit(&entry->refs, 1, memory_order_relaxed);
+
+    player_id_t* bucket = &registry.buckets[username_hash(entry->name) & (registry.bucket_count - 1)];
+    entry->next = *bucket;
+    *bucket = id;
+
+    if (registry.count > registry.bucket_count) registry_grow();
+
+    pthread_mutex_unlock(&registry.mutex);
+    return id;
+}
+
+/**
+ * Cerca l'id di un username senza registrarlo e, se lo trova, ne acquisisce un riferimento da rilasciare con player_release.
+ * Ritorna l'id, PLAYER_NONE se l'username non è registrato
+ */
+player_id_t player_lookup(const char* username) {
+    if (!username || username[0] == '\0') return PLAYER_NONE;
+
+    pthread_mutex_lock(&registry.mutex);
+    player_id_t id = find_locked(username);
+    if (id != PLAYER_NONE) atomic_fetch_add_explicit(&entry_of(id)->refs, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&registry.mutex);
+
+    return id;
+}
+
+/**
+ * Acquisisce un ulteriore riferimento all'id. Il chiamante deve già possederne uno
+ */
+void player_retain(player_id_t id) {
+    if (id == PLAYER_NONE) return;
+
+    // Il contatore non può essere a 0: non serve il mutex, che protegge solo il passaggio a 0
+    atomic_fetch_add_explicit(&entry_of(id)->refs, 1, memory_order_relaxed);
+}
+
+/**
+ * Rilascia un riferimento all'id: con l'ultimo l'username esce dal registro e l'id può essere riusato
+ */
+void player_release(player_id_t id) {
+    if (id == PLAYER_NONE) return;
+
+    // Il passaggio a 0 avviene con il mutex acquisito: player_intern non può ritrovare l'id mentre viene liberato
+    pthread_mutex_lock(&registry.mutex);
+    player_entry_t* entry = entry_of(id);
+    if (atomic_fetch_sub_explicit(&entry->refs, 1, memory_order_acq_rel) == 1) {
+        unlink_name(id);
+        entry->next = registry.free_head;
+        registry.free_head = id;
+    }
+    pthread_mutex_unlock(&registry.mutex);
+}
+
+/**
+ * Ritorna il nome del giocatore senza acquisire lock, una stringa vuota per PLAYER_NONE.
+ * Il nome resta valido finché il chiamante possiede un riferimento all'id
+ */
+const char* player_name(player_id_t id) {
+    return entry_of(id)->name;
+}
@@ -0,0 +1,645 @@
+#define _GNU_SOURCE
+
+#include "reactor.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <jansson.h>
+
+#include "messages.h"
+#include "routing.h"
+#include "output.h"
+#include "binary.h"
+#include "logger.h"
+
+//============ METODI PRIVATI ==================//
+/**
+ * Imposta la socket in modalità non bloccante.
+ * Ritorna true se l'operazione è andata a buon fine, false altrimenti
+ */
+static bool set_nonblocking(const int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return false;
+
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/**
+ * Garantisce che la tabella delle connessioni possa contenere la socket fd.
+ * Ritorna true se la tabella è abbastanza grande, false in caso di errore di allocazione
+ */
+static bool ensure_capacity(reactor_t* reactor, const int fd) {
+    if ((size_t)fd < reactor->capacity) return true;
+
+    size_t new_capacity = reactor->capacity ? reactor->capacity : 64;
+    while (new_capacity <= (size_t)fd) new_capacity *= 2;
+
+    connection_t** connections = realloc(reactor->connections, new_capacity * sizeof(connection_t*));
+    if (!connections) {
+        log_error("reactor.ensure_capacity", "Impossibile allocare memoria per la tabella delle connessioni");
+        return false;
+    }
+
+    memset(connections + reactor->capacity, 0, (new_capacity - reactor->capacity) * sizeof(connection_t*));
+    reactor->connections = connections;
+    reactor->capacity = new_capacity;
+    return true;
+}
+
+/**
+ * Rimuove la connessione dal reactor, esegue la pulizia del client associato e chiude la socket.
+ * Con il pool attivo la pulizia viene accodata dopo le richieste ancora pendenti della connessione:
+ * la socket resta aperta fino ad allora, quindi il suo numero non può essere riassegnato nel frattempo.
+ * Con io_uring, se una sendmsg del ring è ancora in corso, la chiusura viene completata al suo completamento.
+ */
+static void close_connection(reactor_t* reactor, connection_t* conn) {
+    int fd = conn->stream.socket;
+
+    // La sendmsg in corso legge ancora i frame in coda: lo shutdown la fa terminare subito
+    if (reactor->use_uring && output_ring_busy(fd)) {
+        conn->closing = true;
+        shutdown(fd, SHUT_RDWR);
+        return;
+    }
+
+    if (!reactor->use_uring) {
+        epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    reactor->connections[fd] = NULL;
+
+    frame_reader_free(&conn->input);
+
+    if (reactor->pool && worker_pool_close_stream(reactor->pool, &conn->stream)) {
+        return;
+    }
+
+    handle_disconnect(reactor->server, fd);
+    output_unregister(fd);
+    close(fd);
+    slab_free(conn->slab, conn);
+}
+
+/**
+ * Accetta tutte le connessioni in attesa sulla socket di ascolto (necessario in modalità edge-triggered)
+ */
+static void accept_connections(reactor_t* reactor) {
+    while (true) {
+        int client_sock = accept(reactor->listen_fd, NULL, NULL);
+        if (client_sock < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("accept failed");
+            }
+            return;
+        }
+
+        connection_t* conn = slab_alloc(&reactor->connections_slab);
+        if (!conn || !ensure_capacity(reactor, client_sock) || !output_register(client_sock, NULL)) {
+            log_error("reactor.accept_connections", "Impossibile allocare memoria per una nuova connessione");
+            slab_free(&reactor->connections_slab, conn);
+            close(client_sock);
+            continue;
+        }
+        conn->stream.socket = client_sock;
+        conn->server = reactor->server;
+        conn->slab = &reactor->connections_slab;
+        conn->closing = false;
+        frame_reader_init(&conn->input, MAX_JSON_SIZE);
+
+        struct epoll_event event = {
+            .events = EPOLLIN | EPOLLRDHUP | EPOLLET,
+            .data.ptr = conn
+        };
+        if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, client_sock, &event) < 0) {
+            perror("epoll_ctl failed");
+            slab_free(conn->slab, conn);
+            output_unregister(client_sock);
+            close(client_sock);
+            continue;
+        }
+
+        reactor->connections[client_sock] = conn;
+    }
+}
+
+/**
+ * Decodifica il messaggio completo ricevuto sulla connessione e lo passa a handle_request,
+ * o a handle_binary_request se il messaggio è in formato binario.
+ * Ritorna false se il client ha chiesto la disconnessione o il messaggio non è valido, true altrimenti
+ */
+static bool dispatch_frame(reactor_t* reactor, connection_t* conn, const char* body, const size_t body_len) {
+    if (binary_is_message(body, body_len)) {
+        if (reactor->pool) {
+            return worker_pool_submit_binary(reactor->pool, &conn->stream, body, body_len);
+        }
+
+        return handle_binary_request(reactor->server, conn->stream.socket, body, body_len);
+    }
+
+    json_error_t error;
+    json_t* request = json_loadb(body, body_len, 0, &error);
+
+    if (!request) {
+        log_error("reactor.dispatch_frame", "Messaggio json non valido dal client %d", conn->stream.socket);
+        return false;
+    }
+
+    const char* request_type = json_string_value(json_object_get(request, "request"));
+    if (request_type && strcmp(request_type, DISCONNECT_MESSAGE) == 0) {
+        json_decref(request);
+        return false;
+    }
+
+    if (reactor->pool) {
+        return worker_pool_submit(reactor->pool, &conn->stream, request);
+    }
+
+    handle_request(reactor->server, conn->stream.socket, request);
+    json_decref(request);
+    return true;
+}
+
+/**
+ * Passa a dispatch_frame, nell'ordine di arrivo, tutti i frame completi presenti nel buffer della connessione.
+ * Ritorna false se la connessione deve essere chiusa, true altrimenti
+ */
+static bool dispatch_frames(reactor_t* reactor, connection_t* conn) {
+    const char* payload;
+    size_t payload_len;
+    int ready;
+
+    while ((ready = frame_reader_next(&conn->input, &payload, &payload_len)) > 0) {
+        if (!dispatch_frame(reactor, conn, payload, payload_len)) return false;
+    }
+
+    if (ready < 0) {
+        log_error("reactor.dispatch_frames", "Lunghezza del messaggio non valida, deve essere compresa tra 1 e %d bytes", MAX_JSON_SIZE);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Legge tutti i dati disponibili sulla connessione finché la socket non restituisce EAGAIN.
+ * Ogni lettura riempie lo spazio libero del buffer della connessione e tutte le richieste complete
+ * che ha portato vengono gestite prima della lettura successiva.
+ * Ritorna false se la connessione deve essere chiusa, true altrimenti
+ */
+static bool read_connection(reactor_t* reactor, connection_t* conn) {
+    while (true) {
+        size_t space;
+        char* free_space = frame_reader_space(&conn->input, &space);
+        if (!free_space) return false;
+
+        ssize_t received = recv(conn->stream.socket, free_space, space, MSG_DONTWAIT);
+
+        if (received == 0) return false;
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        frame_reader_commit(&conn->input, (size_t)received);
+        if (!dispatch_frames(reactor, conn)) return false;
+    }
+}
+
+/**
+ * Loop del reactor basato su epoll
+ */
+static void run_epoll_loop(reactor_t* reactor) {
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+
+    while (!atomic_load(&reactor->stopping)) {
+        int ready = epoll_wait(reactor->epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait failed");
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            connection_t* conn = events[i].data.ptr;
+
+            if (!conn) {
+                accept_connections(reactor);
+                continue;
+            }
+
+            if (events[i].data.ptr == reactor) {
+                continue;       // Risveglio da reactor_stop
+            }
+
+            bool keep = !(events[i].events & EPOLLERR);
+            if (keep && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+                keep = read_connection(reactor, conn);
+            }
+
+            if (!keep) {
+                close_connection(reactor, conn);
+            }
+        }
+    }
+}
+
+//============ BACKEND IO_URING ==================//
+/**
+ * Il campo user_data di ogni SQE contiene il puntatore alla connessione (o al reactor)
+ * con il tipo di operazione codificato nei bit meno significativi.
+ */
+#define URING_OP_RECV   0
+#define URING_OP_ACCEPT 1
+#define URING_OP_WAKE   2
+#define URING_OP_SEND   3       // user_data contiene il numero della socket al posto del puntatore
+#define URING_OP_MASK   3
+
+/**
+ * Prepara l'accept della prossima connessione sulla socket di ascolto
+ */
+static bool uring_arm_accept(reactor_t* reactor) {
+    struct io_uring_sqe* sqe = uring_get_sqe(&reactor->ring);
+    if (!sqe) return false;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = reactor->listen_fd;
+    sqe->user_data = (uintptr_t)reactor | URING_OP_ACCEPT;
+    return true;
+}
+
+/**
+ * Prepara l'attesa sull'eventfd usato da reactor_stop
+ */
+static bool uring_arm_wake(reactor_t* reactor) {
+    struct io_uring_sqe* sqe = uring_get_sqe(&reactor->ring);
+    if (!sqe) return false;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = reactor->wake_fd;
+    sqe->poll_events = POLLIN;
+    sqe->user_data = (uintptr_t)reactor | URING_OP_WAKE;
+    return true;
+}
+
+/**
+ * Prepara la lettura successiva della connessione nello spazio libero del suo buffer,
+ * ingrandendolo se non basta per il frame in corso.
+ * Ritorna false se la connessione deve essere chiusa, true altrimenti
+ */
+static bool uring_arm_recv(reactor_t* reactor, connection_t* conn) {
+    size_t space;
+    char* free_space = frame_reader_space(&conn->input, &space);
+    if (!free_space) return false;
+
+    struct io_uring_sqe* sqe = uring_get_sqe(&reactor->ring);
+    if (!sqe) return false;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->stream.socket;
+    sqe->addr = (uintptr_t)free_space;
+    sqe->len = space;
+    sqe->user_data = (uintptr_t)conn | URING_OP_RECV;
+    return true;
+}
+
+/**
+ * Prepara una sendmsg per ogni connessione con frame in coda, così che vengano inviate insieme alle altre
+ * operazioni del ring con la prossima system call
+ */
+static void uring_arm_sends(reactor_t* reactor) {
+    int sock;
+    while ((sock = output_ring_next(&reactor->output)) != -1) {
+        struct msghdr* message = output_ring_prepare(sock);
+        if (!message) continue;
+
+        struct io_uring_sqe* sqe = uring_get_sqe(&reactor->ring);
+        if (!sqe) {
+            // La coda torna tra quelle da inviare e verrà ripresa al prossimo giro del loop
+            output_ring_completed(sock, -EAGAIN);
+            return;
+        }
+
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = sock;
+        sqe->addr = (uintptr_t)message;
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = ((uint64_t)sock << 2) | URING_OP_SEND;
+        reactor->pending_sends++;
+    }
+}
+
+/**
+ * Completa la sendmsg del ring per la socket sock e, se la connessione era in chiusura, ne completa la chiusura
+ */
+static void uring_send_completed(reactor_t* reactor, const int sock, const int result) {
+    output_ring_completed(sock, result);
+    reactor->pending_sends--;
+
+    connection_t* conn = (size_t)sock < reactor->capacity ? reactor->connections[sock] : NULL;
+    if (conn && conn->closing) {
+        close_connection(reactor, conn);
+    }
+}
+
+/**
+ * Attende il completamento di tutte le sendmsg del ring chiudendo le socket su cui sono in corso.
+ * Da chiamare alla terminazione del loop: dopo nessuno completerebbe le scritture che output_unregister attende
+ */
+static void uring_drain_sends(reactor_t* reactor) {
+    for (size_t fd = 0; reactor->pending_sends > 0 && fd < reactor->capacity; fd++) {
+        if (reactor->connections[fd] && output_ring_busy((int)fd)) shutdown((int)fd, SHUT_RDWR);
+    }
+
+    while (reactor->pending_sends > 0) {
+        if (uring_submit_and_wait(&reactor->ring, 1) < 0) {
+            if (errno == EINTR) continue;
+            perror("io_uring_enter failed");
+            return;
+        }
+
+        struct io_uring_cqe* cqe;
+        while ((cqe = uring_peek_cqe(&reactor->ring)) != NULL) {
+            uintptr_t user_data = (uintptr_t)cqe->user_data;
+            int result = cqe->res;
+            uring_cqe_seen(&reactor->ring);
+
+            // Le altre operazioni vengono annullate dalla chiusura del ring
+            if ((user_data & URING_OP_MASK) == URING_OP_SEND) {
+                output_ring_completed((int)(user_data >> 2), result);
+                reactor->pending_sends--;
+            }
+        }
+    }
+}
+
+/**
+ * Registra la connessione appena accettata e prepara la sua prima lettura
+ */
+static void uring_accept_completed(reactor_t* reactor, const int client_sock) {
+    connection_t* conn = slab_alloc(&reactor->connections_slab);
+    if (!conn || !ensure_capacity(reactor, client_sock) || !output_register(client_sock, &reactor->output)) {
+        log_error("reactor.uring_accept_completed", "Impossibile allocare memoria per una nuova connessione");
+        slab_free(&reactor->connections_slab, conn);
+        close(client_sock);
+        return;
+    }
+    conn->stream.socket = client_sock;
+    conn->server = reactor->server;
+    conn->slab = &reactor->connections_slab;
+    conn->closing = false;
+    frame_reader_init(&conn->input, MAX_JSON_SIZE);
+    reactor->connections[client_sock] = conn;
+
+    if (!uring_arm_recv(reactor, conn)) {
+        close_connection(reactor, conn);
+    }
+}
+
+/**
+ * Gestisce tutti i frame completi ricevuti dalla connessione e prepara la lettura successiva.
+ * Ritorna false se la connessione deve essere chiusa, true altrimenti
+ */
+static bool uring_recv_completed(reactor_t* reactor, connection_t* conn, const size_t received) {
+    frame_reader_commit(&conn->input, received);
+    if (!dispatch_frames(reactor, conn)) return false;
+
+    return uring_arm_recv(reactor, conn);
+}
+
+/**
+ * Loop del reactor basato su io_uring: ogni connessione ha sempre una recv in sospeso e tutte le
+ * nuove richieste al kernel, comprese le sendmsg dei frame in coda, vengono inviate insieme all'attesa
+ * dei completamenti con una sola system call.
+ */
+static void run_uring_loop(reactor_t* reactor) {
+    if (!uring_arm_accept(reactor) || !uring_arm_wake(reactor)) {
+        log_error("reactor.run_uring_loop", "Impossibile preparare le operazioni iniziali");
+        return;
+    }
+
+    output_ring_attach(&reactor->output);
+
+    while (!atomic_load(&reactor->stopping)) {
+        uring_arm_sends(reactor);
+
+        if (uring_submit_and_wait(&reactor->ring, 1) < 0) {
+            if (errno == EINTR) continue;
+            perror("io_uring_enter failed");
+            break;
+        }
+
+        struct io_uring_cqe* cqe;
+        while ((cqe = uring_peek_cqe(&reactor->ring)) != NULL) {
+            uintptr_t user_data = (uintptr_t)cqe->user_data;
+            int result = cqe->res;
+            uring_cqe_seen(&reactor->ring);
+
+            void* target = (void*)(user_data & ~(uintptr_t)URING_OP_MASK);
+
+            switch (user_data & URING_OP_MASK) {
+                case URING_OP_ACCEPT:
+                    if (result >= 0) {
+                        uring_accept_completed(reactor, result);
+                    } else if (result != -EINTR && result != -EAGAIN) {
+                        log_error("reactor.run_uring_loop", "accept fallita: %s", strerror(-result));
+                    }
+                    uring_arm_accept(reactor);
+                    break;
+
+                case URING_OP_WAKE: {
+                    // Risveglio da reactor_stop o da un thread che ha accodato frame per le connessioni del reactor
+                    uint64_t value;
+                    if (read(reactor->wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                        log_error("reactor.run_uring_loop", "Lettura dell'eventfd di risveglio fallita");
+                    }
+                    if (!atomic_load(&reactor->stopping)) uring_arm_wake(reactor);
+                    break;
+                }
+
+                case URING_OP_SEND:
+                    uring_send_completed(reactor, (int)(user_data >> 2), result);
+                    break;
+
+                case URING_OP_RECV: {
+                    connection_t* conn = target;
+                    bool keep;
+
+                    if (result > 0) {
+                        keep = uring_recv_completed(reactor, conn, (size_t)result);
+                    } else if (result == -EINTR || result == -EAGAIN) {
+                        keep = uring_arm_recv(reactor, conn);
+                    } else {
+                        keep = false;
+                    }
+
+                    if (!keep) {
+                        close_connection(reactor, conn);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    uring_drain_sends(reactor);
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Inizializza il reactor: crea l'istanza epoll e registra la socket di ascolto del server in modalità edge-triggered.
+ * Ritorna true se l'inizializzazione è andata a buon fine, false altrimenti
+ */
+bool reactor_init(reactor_t* reactor, server_t* server, int listen_fd, worker_pool_t* pool) {
+    reactor->server = server;
+    reactor->pool = pool;
+    reactor->listen_fd = listen_fd;
+    reactor->epoll_fd = -1;
+    reactor->connections = NULL;
+    reactor->capacity = 0;
+    reactor->use_uring = false;
+    atomic_init(&reactor->stopping, false);
+
+    reactor->wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (reactor->wake_fd < 0) {
+        log_error("reactor.reactor_init", "Creazione dell'eventfd fallita");
+        return false;
+    }
+
+    slab_init(&reactor->connections_slab, "connessioni", sizeof(connection_t), CONNECTION_SLAB_CHUNK, true);
+
+    if (server->io_backend == IO_BACKEND_URING) {
+        if (uring_supported() && uring_init(&reactor->ring, URING_ENTRIES)) {
+            reactor->use_uring = true;
+            reactor->pending_sends = 0;
+            output_ring_init(&reactor->output, reactor->wake_fd);
+            log_info("reactor.reactor_init", "Reactor io_uring avviato sulla socket di ascolto %d", listen_fd);
+            return true;
+        }
+
+        log_info("reactor.reactor_init", "io_uring non disponibile, uso epoll");
+    }
+
+    reactor->epoll_fd = epoll_create1(0);
+    if (reactor->epoll_fd < 0) {
+        log_error("reactor.reactor_init", "Creazione dell'istanza epoll fallita");
+        reactor_cleanup(reactor);
+        return false;
+    }
+
+    if (!set_nonblocking(reactor->listen_fd)) {
+        log_error("reactor.reactor_init", "Impossibile impostare la socket di ascolto non bloccante");
+        reactor_cleanup(reactor);
+        return false;
+    }
+
+    // data.ptr a NULL identifica la socket di ascolto, data.ptr uguale al reactor l'eventfd di risveglio
+    struct epoll_event listen_event = {
+        .events = EPOLLIN | EPOLLET,
+        .data.ptr = NULL
+    };
+    struct epoll_event wake_event = {
+        .events = EPOLLIN,
+        .data.ptr = reactor
+    };
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->listen_fd, &listen_event) < 0 ||
+        epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_fd, &wake_event) < 0) {
+        log_error("reactor.reactor_init", "Registrazione delle socket nell'istanza epoll fallita");
+        reactor_cleanup(reactor);
+        return false;
+    }
+
+    log_info("reactor.reactor_init", "Reactor epoll avviato sulla socket di ascolto %d", listen_fd);
+    return true;
+}
+
+/**
+ * Callback del pool invocata dopo l'ultima richiesta di una connessione chiusa dal reactor:
+ * esegue la pulizia del client, chiude la socket e libera la connessione
+ */
+void reactor_release_connection(pool_stream_t* stream) {
+    connection_t* conn = (connection_t*)stream;
+    server_t* server = conn->server;
+
+    handle_disconnect(server, stream->socket);
+    output_unregister(stream->socket);
+    close(stream->socket);
+    frame_reader_free(&conn->input);
+    slab_free(conn->slab, conn);
+}
+
+/**
+ * Loop principale del reactor. Accetta le nuove connessioni, legge i frame in modo non bloccante
+ * e passa ogni messaggio completo a handle_request (o al pool). Termina dopo una chiamata a reactor_stop.
+ */
+void reactor_run(reactor_t* reactor) {
+    if (reactor->use_uring) {
+        run_uring_loop(reactor);
+    } else {
+        run_epoll_loop(reactor);
+    }
+}
+
+/**
+ * Chiede al reactor di terminare il loop principale. Può essere chiamata da qualsiasi thread.
+ */
+void reactor_stop(reactor_t* reactor) {
+    atomic_store(&reactor->stopping, true);
+
+    uint64_t one = 1;
+    if (write(reactor->wake_fd, &one, sizeof(one)) < 0) {
+        log_error("reactor.reactor_stop", "Risveglio del reactor fallito");
+    }
+}
+
+/**
+ * Chiude tutte le connessioni ancora aperte e libera la memoria allocata dal reactor
+ */
+void reactor_cleanup(reactor_t* reactor) {
+    // Chiudere il ring annulla le recv in sospeso prima di liberare i buffer delle connessioni.
+    // Le sendmsg sono già state completate da uring_drain_sends alla terminazione del loop
+    bool had_ring = reactor->use_uring;
+    if (reactor->use_uring) {
+        uring_cleanup(&reactor->ring);
+        reactor->use_uring = false;
+    }
+
+    for (size_t fd = 0; fd < reactor->capacity; fd++) {
+        connection_t* conn = reactor->connections[fd];
+        if (conn) {
+            handle_disconnect(reactor->server, conn->stream.socket);
+            output_unregister(conn->stream.socket);
+            close(conn->stream.socket);
+            frame_reader_free(&conn->input);
+            slab_free(conn->slab, conn);
+        }
+    }
+
+    free(reactor->connections);
+    reactor->connections = NULL;
+    reactor->capacity = 0;
+
+    // Le code delle connessioni sono state rimosse: nessuno usa più la lista delle scritture del ring
+    if (had_ring) output_ring_destroy(&reactor->output);
+
+    if (reactor->wake_fd != -1) {
+        close(reactor->wake_fd);
+        reactor->wake_fd = -1;
+    }
+
+    if (reactor->epoll_fd != -1) {
+        close(reactor->epoll_fd);
+        reactor->epoll_fd = -1;
+    }
+
+    slab_destroy(&reactor->connections_slab);
+}
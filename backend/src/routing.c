@@ -1,339 +1,526 @@
-#include "routing.h"
-
-#include "stdlib.h"
-#include "stdio.h"
-#include "string.h"
-
-#include "server.h"
-#include "client.h"
-#include "game.h"
-#include "messages.h"
-
-
-//============ METODI PRIVATI ==================//
-/**
- * Gestione richiesta login. Il metodo verifica che l'username sia univoco rispetto alla lista dei giocatori presenti nel server.
- * Se il nome è univoco allora il metodo invia la risposta la client di login con successo, altrimenti lo notifica dell'errore
- */
-void handle_login(server_t* server, const int client_sock, const json_t* data) {
-    const char* username = json_string_value(json_object_get(data, "username"));
-    json_t* response;
-
-    // Verifica unicità del nome
-    if (!is_username_unique(server, username)) {
-        response = create_response("login", false, "Username già in uso, riprova", NULL);
-        send_json_message(response, client_sock);
-        json_decref(response);
-        return;
-    }
-
-    // Crea un nuovo client
-    client_t* new_client = (client_t*)malloc(sizeof(client_t));
-    if (!new_client) {
-        response = create_response("login", false, "Errore Server", NULL);
-        send_json_message(response, client_sock);
-        json_decref(response);
-        return;
-    }
-    
-    memset(new_client, 0, sizeof(client_t));
-    new_client->socket = client_sock;
-    strncpy(new_client->username, username, sizeof(new_client->username) - 1);
-    new_client->username[sizeof(new_client->username) - 1] = '\0';
-
-    // Aggiunge il client alla lista di client connessi
-    if (!client_add(server, new_client)) {
-        free(new_client);
-
-        response = create_response("login", false, "Errore Server", NULL);
-        send_json_message(response, client_sock);
-        json_decref(response);
-        return;
-    }
-    free(new_client);
-    
-    response = create_response("login", true, "Benvenuto nel gioco", NULL);
-    send_json_message(response, client_sock);
-    json_decref(response);
-}
-
-/**
- * Gestisce la creazione di un nuovo gioco.
- * Crea la partita e invia al client le informazioni relative ad essa, altrimenti lo notifica dell'errore
- */
-void handle_create_game(server_t* server, const int client_sock){
-    const char* username = find_username_by_client(server, client_sock);
-    ssize_t game_id = create_game(server, username);
-
-    json_t* response;
-
-    if(game_id >= 0){
-        response = create_response("create_game", true, "Partita creata con successo", create_json(server, game_id, false));
-        send_json_message(response, client_sock);
-        json_decref(response);
-
-        // Notifica tutti i client della creazione di un nuovo gioco
-        send_broadcast(server, "new_game_available", create_json(server, game_id, false), client_sock, -1);
-        return;
-    }
-
-    response = create_response("create_game", false, "Errore interno al server", NULL);
-    send_json_message(response, client_sock);
-    json_decref(response);
-}
-
-/**
- * Ricerca ed invia al client tutte le partite presenti tranne quelle create da se stesso.
- */
-void handle_list_games(server_t* server, const int client_sock){
-    const char* username = find_username_by_client(server, client_sock);
-    json_t* games = list_games(server, username);
-    json_t* response;
-
-    if(games){
-        response = create_response("list_games", true, "Lista delle partite disponibili", games);
-        send_json_message(response, client_sock);
-        json_decref(response);
-        return;
-    }
-
-    response = create_response("list_games", false, "Errore nel recupero delle partite", NULL);
-    send_json_message(response, client_sock);
-    json_decref(response);
-}
-
-/**
- * Gestisce la richiesta per unirsi.
- * Viene creata e inviata la richiesta di unione al creatore della partita e notifica il richiedente se:
- * 0 - La richiesta è stata inviata correttamente
- * 1 - Id della partita non esiste
- * 2 - La partita è terminata
- * 3 - La partita è gia avviata
- * 4 - Errore generico lato server
- */
-void handle_join_request(server_t* server, const int client_sock, const json_t* data){
-    const char* username = find_username_by_client(server, client_sock);
-    ssize_t game_id = json_integer_value(json_object_get(data, "game_id"));
-
-    if (game_id >= 0) {
-        short result = request_join_game(server, game_id, username);
-
-        json_t* response;
-        switch(result){
-            case 0:
-                response = create_response("join_request", true, "Richiesta inviata correttamente", NULL);
-                send_json_message(response, client_sock);
-                break;;
-            case -1:
-                response = create_response("join_request", false, "Id partita inesistente", NULL);
-                send_json_message(response, client_sock);
-                break;
-            case -2:
-                response = create_response("join_request", false, "La partita è terminata", NULL);
-                send_json_message(response, client_sock);
-                break;
-            case -3:
-                response = create_response("join_request", false, "La partita è già avviata", NULL);
-                send_json_message(response, client_sock);
-                break;
-            default:
-                response = create_response("join_request", false, "Errore Server", NULL);
-                send_json_message(response, client_sock);
-                break;
-        }
-
-        json_decref(response);
-    }
-}
-
-/**
- * Gestisce se la mossa effettuata è valida rispetto al turno e la cella.
- */
-void handle_game_move(server_t* server, const int client_sock, const json_t* data){
-    json_t* response;
-
-    size_t game_id = json_integer_value(json_object_get(data, "game_id"));
-    game_t* game = find_game_by_id(server, game_id);
-    
-    if(!game){
-        response = create_response("game_move", false, "Partita non trovata", NULL);
-        send_json_message(response, client_sock);
-        json_decref(response);
-        return;
-    }
-
-    short x = json_integer_value(json_object_get(data, "x"));
-    short y = json_integer_value(json_object_get(data, "y"));
-
-    const char* username = find_username_by_client(server, client_sock);
-    short result = make_move(server, game, username, x, y);
-
-    switch(result){
-        case 0 :
-            send_game_update(server, game, username);
-            return;
-        case -1:
-            response = create_response("game_move", false, "La partita non è in gioco", NULL);
-            send_json_message(response, client_sock);
-            break;
-        case -2:
-            response = create_response("game_move", false, "Attendi che sia il tuo turno per effettuare la mossa", NULL);
-            send_json_message(response, client_sock);
-            break;
-        case -3:
-            response = create_response("game_move", false, "Cella già occupata", NULL);
-            send_json_message(response, client_sock);
-            break;
-        default:
-            response = create_response("game_move", false, "Errore interno al server", NULL);
-            send_json_message(response, client_sock);
-            break;
-    }
-
-    json_decref(response);
-}
-
-/**
- * Gestione caso in cui il creatore della partita accetta la richiesta di join da parte di client_sock.
- */
-void handle_accept_join(server_t* server, const int client_sock, const json_t* data){
-    json_t* response;
-
-    size_t game_id = json_integer_value(json_object_get(data, "game_id"));
-    const char* opponent = json_string_value(json_object_get(data, "player2"));
-
-    short result = accept_join_request(server, game_id, opponent);
-    json_t* game_json = create_json(server, game_id, false);
-
-    switch(result){
-        case 0:
-            // Notifica il creatore che la partita sta stata accettata con successo e può essere avviata
-            response = create_response("accept_join", true, "Richiesta accettata con successo", game_json);
-            json_t* request = create_request("game_started", "La partita sta per cominciare", json_deep_copy(game_json));
-            
-            send_json_message(response, client_sock);
-            send_json_message(request, client_sock);
-
-            // Notifica tutti i client che il game con id game_id non é piu disponibile
-            ssize_t sock_client2 = find_client_by_username(server, opponent);
-            send_broadcast(server, "game_not_available", game_json, client_sock, sock_client2);
-            
-            json_decref(request);
-            break;
-        case -1:
-            response = create_response("accept_join", false, "La partita non esiste", NULL);
-            send_json_message(response, client_sock);
-            break;
-        case -2:
-            response = create_response("accept_join", false, "Partita non disponibile", NULL);
-            send_json_message(response, client_sock);
-            break;
-        case -4:
-            response = create_response("accept_join", false ,"Avversario impegnato in un'altra partita", NULL);
-            send_json_message(response, client_sock);
-            break;
-        case -5:
-            response = create_response("accept_join", false ,"Impossibile accettare la richiesta,causa disconnessione del player", NULL);
-            send_json_message(response, client_sock);
-            break;
-        default:
-            response = create_response("accept_join", false ,"Errore interno al server", NULL);
-            send_json_message(response, client_sock);
-            break;
-    }
-
-    json_decref(response);
-    json_decref(game_json);
-}
-
-/**
- * Gestisce il caso in cui un giocatore abbandona la parita o si arrende.
- */
-void handle_quit(server_t* server, const int client_sock, const json_t* data){
-    json_t* response;
-    size_t game_id = json_integer_value(json_object_get(data, "game_id"));
-    game_t* game = find_game_by_id(server,game_id);
-
-    if(!game){
-        response = create_response("game_quit", false, "La partita non esiste", NULL);
-        send_json_message(response, client_sock);
-        json_decref(response);
-        return;
-    }
-
-    const char* username = find_username_by_client(server, client_sock);
-    short result = quit(server,game,username);
-
-    switch(result){
-        case 0:
-            response = create_response("game_quit", true, "Partita abbandonata con successo", create_json(server, game->id, false));
-            send_json_message(response, client_sock);
-
-            ssize_t owner = find_client_by_username(server, game->player1);
-            send_broadcast(server, "game_ended", create_json(server, game->id, false), owner , -1);
-            break;
-        case -1:
-            response = create_response("game_quit", false, "La partita non è in corso", NULL);
-            send_json_message(response, client_sock);
-            break;
-        case -2:
-            response = create_response("game_quit", false, "Impossibile notificare l'avversario dell'abbandono", NULL);
-            send_json_message(response, client_sock);
-            break;
-        default:
-            response = create_response("game_quit", false ,"Errore interno al server", NULL);
-            send_json_message(response, client_sock);
-            break;
-    }
-
-    json_decref(response);
-}
-
-//============ INTERFACCIA PUBBLICA ==================//
-
-/** 
- * Gestisce le varie richieste inviate dal client 
-*/
-void handle_request(server_t* server, const int client_sock, const json_t* json_request){
-    const char* request = json_string_value(json_object_get(json_request, "request"));
-    json_t* data = json_object_get(json_request, "data");
-
-
-    if(strcmp(request, "login") == 0){
-        handle_login(server, client_sock, data);
-        return;
-    }
-    if(strcmp(request, "create_game") == 0){
-        handle_create_game(server, client_sock);
-        return;
-    }
-
-    if(strcmp(request, "join_request") == 0){
-        handle_join_request(server, client_sock, data);
-        return;
-    }
-
-    if(strcmp(request, "accept_join") == 0){
-        handle_accept_join(server, client_sock, data);
-        return;
-    }
-
-    if (strcmp(request, "list_games") == 0){
-        handle_list_games(server, client_sock);
-        return;
-    }
-
-    if (strcmp(request, "game_move") == 0){
-        handle_game_move(server, client_sock, data);
-        return;
-    }
-
-    if (strcmp(request, "game_quit") == 0){
-        handle_quit(server, client_sock, data);
-        return;
-    }
-    
-    json_t* response = create_response("error", false, "Richiesta non valida", NULL);
-    send_json_message(response, client_sock);
-    json_decref(response);
-}
+#include "routing.h"
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "server.h"
+#include "client.h"
+#include "game.h"
+#include "messages.h"
+#include "lobby.h"
+#include "matchmaking.h"
+#include "output.h"
+#include "binary.h"
+#include "bot.h"
+#include "logger.h"
+
+
+//============ METODI PRIVATI ==================//
+/**
+ * Gestione richiesta login. Il metodo verifica che l'username sia univoco rispetto alla lista dei giocatori presenti nel server.
+ * Se il nome è univoco allora il metodo invia la risposta la client di login con successo, altrimenti lo notifica dell'errore.
+ * Il campo opzionale "protocol" sceglie il formato dei messaggi: "binary" abilita il protocollo binario (vedi binary.h),
+ * qualsiasi altro valore mantiene il json. Il campo opzionale "updates" con valore "delta" abilita gli aggiornamenti
+ * incrementali della partita, disponibili solo in json. Le scelte adottate vengono confermate solo ai client che le hanno chieste.
+ */
+void handle_login(server_t* server, const int client_sock, const json_t* data) {
+    const char* username = json_string_value(json_object_get(data, "username"));
+    const char* requested = json_string_value(json_object_get(data, "protocol"));
+    client_protocol_t protocol = (requested && strcmp(requested, "binary") == 0) ? PROTOCOL_BINARY : PROTOCOL_JSON;
+    const char* updates = json_string_value(json_object_get(data, "updates"));
+    bool delta_updates = protocol == PROTOCOL_JSON && updates && strcmp(updates, "delta") == 0;
+    json_t* response;
+
+    // Verifica unicità del nome: quello del bot è sempre in uso
+    if (!is_username_unique(server, username) || strcmp(username, BOT_USERNAME) == 0) {
+        response = create_response("login", false, "Username già in uso, riprova", NULL);
+        send_json_message(response, client_sock);
+        json_decref(response);
+        return;
+    }
+
+    // Aggiunge il client alla lista di client connessi
+    if (!client_add(server, client_sock, username, protocol, delta_updates)) {
+        response = create_response("login", false, "Errore Server", NULL);
+        send_json_message(response, client_sock);
+        json_decref(response);
+        return;
+    }
+
+    json_t* accepted = NULL;
+    if (requested || updates) {
+        accepted = json_object();
+        if (requested) json_object_set_new(accepted, "protocol", json_string(protocol == PROTOCOL_BINARY ? "binary" : "json"));
+        if (updates) json_object_set_new(accepted, "updates", json_string(delta_updates ? "delta" : "full"));
+    }
+    
+    response = create_response("login", true, "Benvenuto nel gioco", accepted);
+    send_json_message(response, client_sock);
+    json_decref(response);
+}
+
+/**
+ * Gestisce la creazione di un nuovo gioco.
+ * Crea la partita e invia al client le informazioni relative ad essa, altrimenti lo notifica dell'errore
+ */
+void handle_create_game(server_t* server, const int client_sock){
+    player_id_t player = find_player_by_client(server, client_sock);
+    ssize_t game_id = create_game(server, player);
+
+    json_t* response;
+
+    if(game_id >= 0){
+        response = create_response("create_game", true, "Partita creata con successo", create_json(server, game_id, false));
+        send_json_message(response, client_sock);
+        json_decref(response);
+
+        // Notifica tutti i client della creazione di un nuovo gioco
+        send_broadcast(server, "new_game_available", create_json(server, game_id, false), client_sock, -1);
+        return;
+    }
+
+    response = create_response("create_game", false, "Errore interno al server", NULL);
+    send_json_message(response, client_sock);
+    json_decref(response);
+}
+
+/**
+ * Ricerca ed invia al client tutte le partite presenti tranne quelle create da se stesso.
+ */
+void handle_list_games(server_t* server, const int client_sock){
+    player_id_t player = find_player_by_client(server, client_sock);
+    json_t* response;
+
+    // La lista viene composta dalle viste già serializzate della lobby, senza costruire l'albero json
+    size_t games_len;
+    char* games = lobby_list(player, &games_len);
+    if(games){
+        frame_t* frame = create_response_frame("list_games", true, "Lista delle partite disponibili", games, games_len);
+        free(games);
+
+        if(frame){
+            send_frame(frame, client_sock);
+            frame_release(frame);
+            return;
+        }
+    }
+
+    response = create_response("list_games", false, "Errore nel recupero delle partite", NULL);
+    send_json_message(response, client_sock);
+    json_decref(response);
+}
+
+/**
+ * Gestisce la richiesta per unirsi.
+ * Viene creata e inviata la richiesta di unione al creatore della partita e notifica il richiedente se:
+ * 0 - La richiesta è stata inviata correttamente
+ * 1 - Id della partita non esiste
+ * 2 - La partita è terminata
+ * 3 - La partita è gia avviata
+ * 4 - Errore generico lato server
+ */
+void handle_join_request(server_t* server, const int client_sock, const json_t* data){
+    player_id_t player = find_player_by_client(server, client_sock);
+    ssize_t game_id = json_integer_value(json_object_get(data, "game_id"));
+
+    if (game_id >= 0) {
+        short result = request_join_game(server, game_id, player);
+
+        json_t* response;
+        switch(result){
+            case 0:
+                response = create_response("join_request", true, "Richiesta inviata correttamente", NULL);
+                send_json_message(response, client_sock);
+                break;;
+            case -1:
+                response = create_response("join_request", false, "Id partita inesistente", NULL);
+                send_json_message(response, client_sock);
+                break;
+            case -2:
+                response = create_response("join_request", false, "La partita è terminata", NULL);
+                send_json_message(response, client_sock);
+                break;
+            case -3:
+                response = create_response("join_request", false, "La partita è già avviata", NULL);
+                send_json_message(response, client_sock);
+                break;
+            default:
+                response = create_response("join_request", false, "Errore Server", NULL);
+                send_json_message(response, client_sock);
+                break;
+        }
+
+        json_decref(response);
+    }
+}
+
+/**
+ * Invia al client l'errore della mossa sulla partita game_id: BINARY_MOVE_ERROR se il client ha scelto
+ * il protocollo binario, altrimenti la risposta json game_move con la descrizione indicata.
+ */
+static void send_move_error(server_t* server, const int client_sock, size_t game_id, binary_move_error_t error, const char* description){
+    if (find_protocol_by_client(server, client_sock) == PROTOCOL_BINARY) {
+        frame_t* frame = binary_move_error(game_id, error);
+        send_frame(frame, client_sock);
+        if (frame) frame_release(frame);
+        return;
+    }
+
+    json_t* response = create_response("game_move", false, description, NULL);
+    send_json_message(response, client_sock);
+    json_decref(response);
+}
+
+/**
+ * Esegue la mossa (x, y) del client sulla partita game_id, qualunque sia il formato della richiesta.
+ * In caso di successo invia lo stato aggiornato ad entrambi i giocatori, altrimenti l'errore al solo client.
+ */
+static void process_game_move(server_t* server, const int client_sock, size_t game_id, int x, int y){
+    game_t* game = game_get(server, game_id);
+    
+    if(!game){
+        send_move_error(server, client_sock, game_id, BINARY_ERROR_GAME_NOT_FOUND, "Partita non trovata");
+        return;
+    }
+
+    player_id_t player = find_player_by_client(server, client_sock);
+    short result = make_move(server, game, player, x, y);
+
+    switch(result){
+        case 0 :
+            send_game_update(server, game, player);
+
+            // Nelle partite contro il bot la risposta arriva subito, come aggiornamento separato della mossa dell'avversario
+            if (bot_move(server, game) == 0) {
+                send_game_update(server, game, bot_player());
+            }
+            break;
+        case -1:
+            send_move_error(server, client_sock, game_id, BINARY_ERROR_NOT_ONGOING, "La partita non è in gioco");
+            break;
+        case -2:
+            send_move_error(server, client_sock, game_id, BINARY_ERROR_NOT_YOUR_TURN, "Attendi che sia il tuo turno per effettuare la mossa");
+            break;
+        case -3:
+            send_move_error(server, client_sock, game_id, BINARY_ERROR_CELL_TAKEN, "Cella già occupata");
+            break;
+        case -4:
+            send_move_error(server, client_sock, game_id, BINARY_ERROR_INVALID_CELL, "Cella non valida");
+            break;
+        default:
+            send_move_error(server, client_sock, game_id, BINARY_ERROR_SERVER, "Errore interno al server");
+            break;
+    }
+
+    game_put(server, game);
+}
+
+/**
+ * Gestisce se la mossa effettuata è valida rispetto al turno e la cella.
+ */
+void handle_game_move(server_t* server, const int client_sock, const json_t* data){
+    size_t game_id = json_integer_value(json_object_get(data, "game_id"));
+    short x = json_integer_value(json_object_get(data, "x"));
+    short y = json_integer_value(json_object_get(data, "y"));
+
+    process_game_move(server, client_sock, game_id, x, y);
+}
+
+/**
+ * Invia lo stato completo della partita con il numero di sequenza della sua ultima mossa,
+ * richiesto dai client con aggiornamenti incrementali quando rilevano un aggiornamento mancante.
+ */
+void handle_game_resync(server_t* server, const int client_sock, const json_t* data){
+    size_t game_id = json_integer_value(json_object_get(data, "game_id"));
+    json_t* resync = create_resync_json(server, game_id);
+
+    json_t* response;
+    if (resync) {
+        response = create_response("game_resync", true, "Stato della partita", resync);
+    } else {
+        response = create_response("game_resync", false, "La partita non esiste", NULL);
+    }
+
+    send_json_message(response, client_sock);
+    json_decref(response);
+}
+
+/**
+ * Gestione caso in cui il creatore della partita accetta la richiesta di join da parte di client_sock.
+ */
+void handle_accept_join(server_t* server, const int client_sock, const json_t* data){
+    json_t* response;
+
+    size_t game_id = json_integer_value(json_object_get(data, "game_id"));
+    const char* opponent = json_string_value(json_object_get(data, "player2"));
+
+    short result = accept_join_request(server, game_id, opponent);
+    json_t* game_json = create_json(server, game_id, false);
+
+    switch(result){
+        case 0:
+            // Notifica il creatore che la partita sta stata accettata con successo e può essere avviata
+            response = create_response("accept_join", true, "Richiesta accettata con successo", json_incref(game_json));
+            json_t* request = create_request("game_started", "La partita sta per cominciare", json_deep_copy(game_json));
+            
+            send_json_message(response, client_sock);
+            send_json_message(request, client_sock);
+
+            // Notifica tutti i client che il game con id game_id non é piu disponibile
+            ssize_t sock_client2 = find_client_by_username(server, opponent);
+            send_broadcast(server, "game_not_available", json_incref(game_json), client_sock, sock_client2);
+            
+            json_decref(request);
+            break;
+        case -1:
+            response = create_response("accept_join", false, "La partita non esiste", NULL);
+            send_json_message(response, client_sock);
+            break;
+        case -2:
+            response = create_response("accept_join", false, "Partita non disponibile", NULL);
+            send_json_message(response, client_sock);
+            break;
+        case -4:
+            response = create_response("accept_join", false ,"Avversario impegnato in un'altra partita", NULL);
+            send_json_message(response, client_sock);
+            break;
+        case -5:
+            response = create_response("accept_join", false ,"Impossibile accettare la richiesta,causa disconnessione del player", NULL);
+            send_json_message(response, client_sock);
+            break;
+        default:
+            response = create_response("accept_join", false ,"Errore interno al server", NULL);
+            send_json_message(response, client_sock);
+            break;
+    }
+
+    json_decref(response);
+    json_decref(game_json);
+}
+
+/**
+ * Gestisce la richiesta di partita rapida: il client viene abbinato al giocatore in attesa e la partita
+ * viene avviata subito (entrambi ricevono game_started), altrimenti il client resta in attesa di un avversario.
+ */
+void handle_quick_match(server_t* server, const int client_sock){
+    player_id_t player = find_player_by_client(server, client_sock);
+    ssize_t game_id = -1;
+
+    json_t* response;
+    switch(quick_match(server, player, &game_id)){
+        case 0:
+            response = create_response("quick_match", true, "Avversario trovato", create_json(server, game_id, false));
+            break;
+        case 1:
+            response = create_response("quick_match", true, "In attesa di un avversario", NULL);
+            break;
+        case -1:
+            response = create_response("quick_match", false, "Sei già impegnato in un'altra partita", NULL);
+            break;
+        default:
+            response = create_response("quick_match", false, "Errore interno al server", NULL);
+            break;
+    }
+
+    send_json_message(response, client_sock);
+    json_decref(response);
+}
+
+/**
+ * Gestisce la richiesta di partita contro il bot del server. Il campo opzionale "difficulty" ("easy", "medium" o "hard",
+ * default "hard") sceglie il livello del bot. La partita viene avviata subito e il client, che muove per primo, riceve game_started.
+ */
+void handle_bot_game(server_t* server, const int client_sock, const json_t* data){
+    bot_level_t level = bot_level_from_string(json_string_value(json_object_get(data, "difficulty")));
+
+    json_t* response;
+    if (level == BOT_NONE) {
+        response = create_response("bot_game", false, "Livello del bot non valido", NULL);
+        send_json_message(response, client_sock);
+        json_decref(response);
+        return;
+    }
+
+    player_id_t player = find_player_by_client(server, client_sock);
+    ssize_t game_id = create_bot_game(server, player, level);
+
+    switch(game_id){
+        case -1:
+            response = create_response("bot_game", false, "Sei già impegnato in un'altra partita", NULL);
+            send_json_message(response, client_sock);
+            break;
+        case -2:
+            response = create_response("bot_game", false, "Errore interno al server", NULL);
+            send_json_message(response, client_sock);
+            break;
+        default: {
+            json_t* game_json = create_json(server, game_id, false);
+            response = create_response("bot_game", true, "Partita contro il bot creata con successo", json_incref(game_json));
+            json_t* request = create_request("game_started", "La partita sta per cominciare", game_json);
+
+            send_json_message(response, client_sock);
+            send_json_message(request, client_sock);
+            json_decref(request);
+            break;
+        }
+    }
+
+    json_decref(response);
+}
+
+/**
+ * Gestisce il caso in cui un giocatore abbandona la parita o si arrende.
+ */
+void handle_quit(server_t* server, const int client_sock, const json_t* data){
+    json_t* response;
+    size_t game_id = json_integer_value(json_object_get(data, "game_id"));
+    game_t* game = game_get(server, game_id);
+
+    if(!game){
+        response = create_response("game_quit", false, "La partita non esiste", NULL);
+        send_json_message(response, client_sock);
+        json_decref(response);
+        return;
+    }
+
+    player_id_t player = find_player_by_client(server, client_sock);
+    short result = quit(server,game,player);
+
+    switch(result){
+        case 0:
+            response = create_response("game_quit", true, "Partita abbandonata con successo", create_json(server, game->id, false));
+            send_json_message(response, client_sock);
+
+            ssize_t owner = find_client_by_username(server, player_name(game->player1));
+            send_broadcast(server, "game_ended", create_json(server, game->id, false), owner , -1);
+            break;
+        case -1:
+            response = create_response("game_quit", false, "La partita non è in corso", NULL);
+            send_json_message(response, client_sock);
+            break;
+        case -2:
+            response = create_response("game_quit", false, "Impossibile notificare l'avversario dell'abbandono", NULL);
+            send_json_message(response, client_sock);
+            break;
+        default:
+            response = create_response("game_quit", false ,"Errore interno al server", NULL);
+            send_json_message(response, client_sock);
+            break;
+    }
+
+    game_put(server, game);
+    json_decref(response);
+}
+
+/** 
+ * Smista la richiesta al gestore corrispondente
+*/
+static void dispatch_request(server_t* server, const int client_sock, const json_t* json_request){
+    const char* request = json_string_value(json_object_get(json_request, "request"));
+    json_t* data = json_object_get(json_request, "data");
+
+
+    if(strcmp(request, "login") == 0){
+        handle_login(server, client_sock, data);
+        return;
+    }
+    if(strcmp(request, "create_game") == 0){
+        handle_create_game(server, client_sock);
+        return;
+    }
+
+    if(strcmp(request, "join_request") == 0){
+        handle_join_request(server, client_sock, data);
+        return;
+    }
+
+    if(strcmp(request, "accept_join") == 0){
+        handle_accept_join(server, client_sock, data);
+        return;
+    }
+
+    if (strcmp(request, "quick_match") == 0){
+        handle_quick_match(server, client_sock);
+        return;
+    }
+
+    if (strcmp(request, "bot_game") == 0){
+        handle_bot_game(server, client_sock, data);
+        return;
+    }
+
+    if (strcmp(request, "list_games") == 0){
+        handle_list_games(server, client_sock);
+        return;
+    }
+
+    if (strcmp(request, "game_move") == 0){
+        handle_game_move(server, client_sock, data);
+        return;
+    }
+
+    if (strcmp(request, "game_resync") == 0){
+        handle_game_resync(server, client_sock, data);
+        return;
+    }
+
+    if (strcmp(request, "game_quit") == 0){
+        handle_quit(server, client_sock, data);
+        return;
+    }
+    
+    json_t* response = create_response("error", false, "Richiesta non valida", NULL);
+    send_json_message(response, client_sock);
+    json_decref(response);
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+
+/** 
+ * Gestisce le varie richieste inviate dal client.
+ * I messaggi prodotti dalla richiesta vengono inviati solo al termine, quando nessun lock è più acquisito
+*/
+void handle_request(server_t* server, const int client_sock, const json_t* json_request){
+    dispatch_request(server, client_sock, json_request);
+    output_flush_pending();
+}
+
+/**
+ * Gestisce una richiesta in formato binario, ammessa solo dai client che hanno scelto il protocollo binario al login.
+ * Come per handle_request i messaggi prodotti vengono inviati solo al termine.
+ * Ritorna false se il messaggio è troppo lungo per essere una richiesta binaria e la connessione va chiusa, true altrimenti
+ */
+bool handle_binary_request(server_t* server, const int client_sock, const char* payload, size_t len){
+    if (len > BINARY_REQUEST_MAX) {
+        log_error("routing.handle_binary_request", "Richiesta binaria di %zu byte non valida dal client %d", len, client_sock);
+        return false;
+    }
+
+    binary_move_t move;
+    if (find_protocol_by_client(server, client_sock) == PROTOCOL_BINARY && binary_decode_move(payload, len, &move)) {
+        process_game_move(server, client_sock, move.game_id, move.x, move.y);
+    } else {
+        json_t* response = create_response("error", false, "Richiesta non valida", NULL);
+        send_json_message(response, client_sock);
+        json_decref(response);
+    }
+
+    output_flush_pending();
+    return true;
+}
+
+/**
+ * Gestisce la disconnessione di un client: rimuove le partite da lui create e lo elimina dalla lista dei client connessi.
+ * La chiusura della socket resta a carico del chiamante.
+ */
+void handle_disconnect(server_t* server, const int client_sock){
+    player_id_t player = find_player_by_client(server, client_sock);
+    if (player != PLAYER_NONE) {
+        matchmaking_cancel(player);
+        remove_games_by_player(server, player, client_sock);
+    }
+
+    client_remove(server, client_sock);
+    output_flush_pending();
+}
\ No newline at end of file
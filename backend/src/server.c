@@ -1,88 +1,136 @@
-#include "server.h"
-
-#include <stdio.h>
-#include <string.h>
-#include <unistd.h>
-#include <sys/time.h>
-
-//============ INTERFACCIA PUBBLICA ==================//
-/**
- * Inizializza le variabili utili a gestire le informazioni del server
- */
-void server_init(server_t *server, const int port) {
-    // Inizializza i campi della struttura
-    server->socket_fd = -1;
-    server->running = false;
-    
-    // Inizializza i mutex
-    pthread_mutex_init(&server->clients_mutex, NULL);
-    pthread_mutex_init(&server->games_mutex, NULL);
-    
-    // Configura l'indirizzo del server
-    memset(&server->address, 0, sizeof(server->address));
-    server->address.sin_family = AF_INET;
-    server->address.sin_addr.s_addr = INADDR_ANY;
-    server->address.sin_port = htons(port);
-}
-
-/**
- * Crea una socket di tipo STREAM per il dominio TCP/IP, la imposta in modalità
- * SO_REUSEADDR in modo da consentire il riutilizzo degli indirizzi.
- */
-bool server_start(server_t *server) {
-    // Crea il socket
-    server->socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server->socket_fd < 0) {
-        printf("[Errore - server.server_start] Creazione della socket fallita\n");
-        return false;
-    }
-    
-    // Imposta opzioni del socket
-    int opt = 1;
-    if (setsockopt(server->socket_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
-        printf("[Errore - server.server_start] setsockopt fallita\n");
-        close(server->socket_fd);
-        return false;
-    }
-
-    // Associa il socket all'indirizzo
-    if (bind(server->socket_fd, (struct sockaddr*)&server->address, sizeof(server->address)) < 0) {
-        printf("[Errore - server.server_start] bind fallita\n");
-        close(server->socket_fd);
-        return false;
-    }
-    
-    // Mette il server in ascolto
-    if (listen(server->socket_fd, MAX_CLIENTS) < 0) {
-        printf("[Errore - server.server_start] listen fallita\n");
-        close(server->socket_fd);
-        return false;
-    }
-    
-    server->running = true;
-    printf("[Info - server.server_start] Server in ascolto sulla porta %d...\n", ntohs(server->address.sin_port));
-    
-    return true;
-}
-
-
-/**
- * Libera la memoria e imposta i campi della struttura ai valori di default prima di chiudere il server
- */
-void server_close(server_t *server) {
-    pthread_mutex_destroy(&server->clients_mutex);
-    pthread_mutex_destroy(&server->games_mutex);
-    
-    if (server->running) {
-        server->running = false;
-    
-        // Chiudi il socket
-        if (server->socket_fd != -1) {
-            close(server->socket_fd);
-            server->socket_fd = -1;
-        }
-        
-        printf("[Info - server.server_close] Server chiuso\n");
-    }
-}
-
+#define _GNU_SOURCE
+
+#include "server.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "logger.h"
+
+//============ METODI PRIVATI ==================//
+/**
+ * Crea, associa all'indirizzo del server e mette in ascolto una socket TCP.
+ * Ritorna il descrittore della socket, -1 in caso di errore
+ */
+static int open_listener(server_t *server, const bool reuseport) {
+    // Crea il socket
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        log_error("server.open_listener", "Creazione della socket fallita");
+        return -1;
+    }
+    
+    // Imposta opzioni del socket
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
+        log_error("server.open_listener", "setsockopt fallita");
+        close(fd);
+        return -1;
+    }
+
+    if (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
+        log_error("server.open_listener", "SO_REUSEPORT non supportata");
+        close(fd);
+        return -1;
+    }
+
+    // Associa il socket all'indirizzo
+    if (bind(fd, (struct sockaddr*)&server->address, sizeof(server->address)) < 0) {
+        log_error("server.open_listener", "bind fallita");
+        close(fd);
+        return -1;
+    }
+    
+    // Mette il server in ascolto
+    if (listen(fd, server->backlog) < 0) {
+        log_error("server.open_listener", "listen fallita");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Inizializza le variabili utili a gestire le informazioni del server
+ */
+void server_init(server_t *server, const int port) {
+    // Inizializza i campi della struttura
+    server->socket_fd = -1;
+    server->running = false;
+    server->mode = SERVER_MODE_THREADS;
+    server->io_backend = IO_BACKEND_EPOLL;
+
+    // Di default un worker per ogni core disponibile
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    server->workers = cores > 0 ? (size_t)cores : 1;
+    server->queue_size = DEFAULT_QUEUE_SIZE;
+    server->listeners = server->workers;
+    server->max_clients = DEFAULT_MAX_CLIENTS;
+    server->max_games = DEFAULT_MAX_GAMES;
+    server->backlog = DEFAULT_BACKLOG;
+    server->output_high_water = DEFAULT_OUTPUT_HIGH_WATER;
+    server->output_limit = DEFAULT_OUTPUT_LIMIT;
+    server->log_level = LOG_LEVEL_INFO;
+    
+    // Inizializza i mutex
+    pthread_mutex_init(&server->clients_mutex, NULL);
+    pthread_mutex_init(&server->games_mutex, NULL);
+    
+    // Configura l'indirizzo del server
+    memset(&server->address, 0, sizeof(server->address));
+    server->address.sin_family = AF_INET;
+    server->address.sin_addr.s_addr = INADDR_ANY;
+    server->address.sin_port = htons(port);
+}
+
+/**
+ * Crea una socket di tipo STREAM per il dominio TCP/IP, la imposta in modalità
+ * SO_REUSEADDR in modo da consentire il riutilizzo degli indirizzi.
+ * In modalità reuseport la socket viene aperta anche con SO_REUSEPORT.
+ */
+bool server_start(server_t *server) {
+    server->socket_fd = open_listener(server, server->mode == SERVER_MODE_REUSEPORT);
+    if (server->socket_fd < 0) {
+        log_error("server.server_start", "Avvio del server fallito");
+        return false;
+    }
+    
+    server->running = true;
+    log_info("server.server_start", "Server in ascolto sulla porta %d...", ntohs(server->address.sin_port));
+    
+    return true;
+}
+
+/**
+ * Apre un'ulteriore socket di ascolto sulla stessa porta con SO_REUSEPORT: il kernel distribuisce
+ * le nuove connessioni tra tutte le socket aperte in questo modo.
+ * Ritorna il descrittore della socket, -1 in caso di errore
+ */
+int server_open_listener(server_t *server) {
+    return open_listener(server, true);
+}
+
+/**
+ * Libera la memoria e imposta i campi della struttura ai valori di default prima di chiudere il server
+ */
+void server_close(server_t *server) {
+    pthread_mutex_destroy(&server->clients_mutex);
+    pthread_mutex_destroy(&server->games_mutex);
+    
+    if (server->running) {
+        server->running = false;
+    
+        // Chiudi il socket
+        if (server->socket_fd != -1) {
+            close(server->socket_fd);
+            server->socket_fd = -1;
+        }
+        
+        log_info("server.server_close", "Server chiuso");
+    }
+}
+
@@ -0,0 +1,154 @@
+#include "slab.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+static slab_t* registered = NULL;
+static pthread_mutex_t registered_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+//============ METODI PRIVATI ==================//
+/**
+ * Alloca un nuovo chunk e ne inserisce gli oggetti nella lista dei liberi. Da chiamare con il lock del pool acquisito.
+ * Ritorna true se il chunk è stato allocato, false altrimenti
+ */
+static bool slab_grow(slab_t* slab) {
+    // Il primo oggetto del chunk è allineato come l'intestazione, gli altri come object_size (multiplo di max_align_t)
+    size_t header = (sizeof(slab_chunk_t) + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1);
+    slab_chunk_t* chunk = malloc(header + slab->per_chunk * slab->object_size);
+    if (!chunk) return false;
+
+    chunk->next = slab->chunks;
+    slab->chunks = chunk;
+    atomic_fetch_add(&slab->chunk_allocs, 1);
+
+    char* objects = (char*)chunk + header;
+    for (size_t i = slab->per_chunk; i-- > 0;) {
+        slab_object_t* object = (slab_object_t*)(objects + i * slab->object_size);
+        object->next = slab->free_list;
+        slab->free_list = object;
+    }
+
+    return true;
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Inizializza un pool di oggetti da object_size byte, allocati a gruppi di per_chunk, e lo registra per i report
+ */
+void slab_init(slab_t* slab, const char* name, size_t object_size, size_t per_chunk, bool locked) {
+    size_t align = _Alignof(max_align_t);
+    if (object_size < sizeof(slab_object_t)) object_size = sizeof(slab_object_t);
+
+    slab->name = name;
+    slab->object_size = (object_size + align - 1) & ~(align - 1);
+    slab->per_chunk = per_chunk > 0 ? per_chunk : 1;
+    slab->locked = locked;
+    slab->free_list = NULL;
+    slab->chunks = NULL;
+    atomic_init(&slab->allocs, 0);
+    atomic_init(&slab->frees, 0);
+    atomic_init(&slab->in_use, 0);
+    atomic_init(&slab->peak_in_use, 0);
+    atomic_init(&slab->chunk_allocs, 0);
+    slab->reported_chunk_allocs = 0;
+
+    if (locked) pthread_mutex_init(&slab->mutex, NULL);
+
+    pthread_mutex_lock(&registered_mutex);
+    slab->next_registered = registered;
+    registered = slab;
+    pthread_mutex_unlock(&registered_mutex);
+}
+
+/**
+ * Preleva un oggetto azzerato dal pool, allocando un nuovo chunk solo se non ci sono oggetti liberi.
+ * Ritorna l'oggetto, NULL in caso di errore di allocazione
+ */
+void* slab_alloc(slab_t* slab) {
+    if (slab->locked) pthread_mutex_lock(&slab->mutex);
+
+    if (!slab->free_list && !slab_grow(slab)) {
+        if (slab->locked) pthread_mutex_unlock(&slab->mutex);
+        log_error("slab.slab_alloc", "Impossibile allocare memoria per il pool %s", slab->name);
+        return NULL;
+    }
+
+    slab_object_t* object = slab->free_list;
+    slab->free_list = object->next;
+
+    if (slab->locked) pthread_mutex_unlock(&slab->mutex);
+
+    atomic_fetch_add(&slab->allocs, 1);
+    size_t in_use = atomic_fetch_add(&slab->in_use, 1) + 1;
+    size_t peak = atomic_load(&slab->peak_in_use);
+    while (in_use > peak && !atomic_compare_exchange_weak(&slab->peak_in_use, &peak, in_use));
+
+    memset(object, 0, slab->object_size);
+    return object;
+}
+
+/**
+ * Restituisce l'oggetto al pool da cui è stato prelevato
+ */
+void slab_free(slab_t* slab, void* object) {
+    if (!object) return;
+
+    slab_object_t* freed = (slab_object_t*)object;
+
+    if (slab->locked) pthread_mutex_lock(&slab->mutex);
+    freed->next = slab->free_list;
+    slab->free_list = freed;
+    if (slab->locked) pthread_mutex_unlock(&slab->mutex);
+
+    atomic_fetch_add(&slab->frees, 1);
+    atomic_fetch_sub(&slab->in_use, 1);
+}
+
+/**
+ * Stampa i contatori del pool e il numero di chunk allocati dall'ultimo report
+ */
+void slab_report(slab_t* slab) {
+    size_t chunk_allocs = atomic_load(&slab->chunk_allocs);
+    size_t new_chunks = chunk_allocs - slab->reported_chunk_allocs;
+    slab->reported_chunk_allocs = chunk_allocs;
+
+    log_info("slab.slab_report", "Pool %s: %zu oggetti in uso (picco %zu), %zu allocazioni, %zu rilasci, %zu chunk da %zu oggetti (%zu dall'ultimo report)",
+        slab->name, atomic_load(&slab->in_use), atomic_load(&slab->peak_in_use), atomic_load(&slab->allocs),
+        atomic_load(&slab->frees), chunk_allocs, slab->per_chunk, new_chunks);
+}
+
+/**
+ * Stampa i contatori di tutti i pool registrati
+ */
+void slab_report_all(void) {
+    pthread_mutex_lock(&registered_mutex);
+    for (slab_t* slab = registered; slab; slab = slab->next_registered) {
+        slab_report(slab);
+    }
+    pthread_mutex_unlock(&registered_mutex);
+}
+
+/**
+ * Libera tutti i chunk del pool e lo rimuove dai report. Gli oggetti del pool non devono più essere in uso
+ */
+void slab_destroy(slab_t* slab) {
+    pthread_mutex_lock(&registered_mutex);
+    slab_t** pp = &registered;
+    while (*pp && *pp != slab) pp = &(*pp)->next_registered;
+    if (*pp) *pp = slab->next_registered;
+    pthread_mutex_unlock(&registered_mutex);
+
+    slab_chunk_t* chunk = slab->chunks;
+    while (chunk) {
+        slab_chunk_t* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    slab->chunks = NULL;
+    slab->free_list = NULL;
+
+    if (slab->locked) pthread_mutex_destroy(&slab->mutex);
+}
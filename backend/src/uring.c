@@ -0,0 +1,182 @@
+#define _GNU_SOURCE
+
+#include "uring.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "logger.h"
+
+//============ METODI PRIVATI ==================//
+static int sys_io_uring_setup(unsigned int entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned int opcode, void* arg, unsigned int nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Verifica a runtime che il kernel supporti io_uring e le operazioni usate dal server (accept, recv, sendmsg, poll).
+ * Ritorna true se il supporto è disponibile, false altrimenti
+ */
+bool uring_supported(void) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    // ENOSYS su kernel troppo vecchi, EPERM se bloccato da seccomp (es. profilo di default di alcuni container)
+    int fd = sys_io_uring_setup(2, &params);
+    if (fd < 0) return false;
+
+    size_t probe_size = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = calloc(1, probe_size);
+    bool supported = false;
+
+    if (probe && sys_io_uring_register(fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0) {
+        const unsigned char required[] = { IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_POLL_ADD };
+
+        supported = (params.features & IORING_FEAT_SINGLE_MMAP) && (params.features & IORING_FEAT_NODROP);
+        for (size_t i = 0; supported && i < sizeof(required); i++) {
+            supported = required[i] <= probe->last_op && (probe->ops[required[i]].flags & IO_URING_OP_SUPPORTED);
+        }
+    }
+
+    free(probe);
+    close(fd);
+    return supported;
+}
+
+/**
+ * Crea un'istanza io_uring con entries posizioni nella coda di submission.
+ * Ritorna true se l'istanza è stata creata, false altrimenti
+ */
+bool uring_init(uring_t* ring, unsigned int entries) {
+    memset(ring, 0, sizeof(uring_t));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring->ring_fd = sys_io_uring_setup(entries, &params);
+    if (ring->ring_fd < 0) {
+        log_error("uring.uring_init", "io_uring_setup fallita: %s", strerror(errno));
+        return false;
+    }
+    ring->entries = params.sq_entries;
+
+    // Con IORING_FEAT_SINGLE_MMAP (verificata da uring_supported) le due code condividono la stessa mappatura
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+    ring->cq_ring_size = ring->sq_ring_size;
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        log_error("uring.uring_init", "Mappatura delle code fallita");
+        close(ring->ring_fd);
+        return false;
+    }
+    ring->cq_ring = ring->sq_ring;
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        log_error("uring.uring_init", "Mappatura delle SQE fallita");
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        close(ring->ring_fd);
+        return false;
+    }
+
+    char* sq = ring->sq_ring;
+    ring->sq_head = (unsigned int*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned int*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned int*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int*)(sq + params.sq_off.array);
+    ring->sq_local_tail = *ring->sq_tail;
+
+    char* cq = ring->cq_ring;
+    ring->cq_head = (unsigned int*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned int*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned int*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    return true;
+}
+
+/**
+ * Ritorna una SQE libera e azzerata, inviando al kernel quelle già preparate se la coda è piena.
+ * Ritorna NULL se non è stato possibile liberare spazio
+ */
+struct io_uring_sqe* uring_get_sqe(uring_t* ring) {
+    unsigned int head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+    if (ring->sq_local_tail - head >= ring->entries) {
+        if (uring_submit_and_wait(ring, 0) < 0) return NULL;
+
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (ring->sq_local_tail - head >= ring->entries) return NULL;
+    }
+
+    unsigned int index = ring->sq_local_tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+    ring->to_submit++;
+    return sqe;
+}
+
+/**
+ * Invia al kernel con un'unica system call tutte le SQE preparate e attende almeno wait_nr completamenti.
+ * Ritorna il numero di SQE inviate, -1 in caso di errore (errno impostato)
+ */
+int uring_submit_and_wait(uring_t* ring, unsigned int wait_nr) {
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+
+    unsigned int flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int submitted = sys_io_uring_enter(ring->ring_fd, ring->to_submit, wait_nr, flags);
+    if (submitted < 0) return -1;
+
+    ring->to_submit -= (unsigned int)submitted;
+    return submitted;
+}
+
+/**
+ * Ritorna il prossimo completamento disponibile senza consumarlo, NULL se non ce ne sono
+ */
+struct io_uring_cqe* uring_peek_cqe(uring_t* ring) {
+    unsigned int head = *ring->cq_head;
+    unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail) return NULL;
+
+    return &ring->cqes[head & *ring->cq_mask];
+}
+
+/**
+ * Segna come consumato il completamento restituito da uring_peek_cqe
+ */
+void uring_cqe_seen(uring_t* ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Chiude l'istanza io_uring e rimuove le mappature di memoria
+ */
+void uring_cleanup(uring_t* ring) {
+    if (ring->ring_fd < 0) return;
+
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->ring_fd);
+    ring->ring_fd = -1;
+}
@@ -0,0 +1,253 @@
+#include "worker_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "routing.h"
+#include "logger.h"
+
+//============ METODI PRIVATI ==================//
+/**
+ * Inserisce la connessione in fondo alla coda dei pronti. Da chiamare con il mutex del pool acquisito
+ */
+static void push_ready(worker_pool_t* pool, pool_stream_t* stream) {
+    stream->state = STREAM_QUEUED;
+    stream->next_ready = NULL;
+
+    if (pool->ready_tail) {
+        pool->ready_tail->next_ready = stream;
+    } else {
+        pool->ready_head = stream;
+    }
+    pool->ready_tail = stream;
+}
+
+/**
+ * Accoda un job sulla connessione, bloccandosi se la coda del pool è piena. Il job contiene la richiesta json
+ * oppure, se binary_len non è 0, la richiesta binaria binary.
+ * Ritorna true se il job è stato accodato, false altrimenti
+ */
+static bool enqueue(worker_pool_t* pool, pool_stream_t* stream, json_t* request, const char* binary, size_t binary_len) {
+    pthread_mutex_lock(&pool->mutex);
+
+    while (pool->pending >= pool->max_pending && !pool->stopping) {
+        pthread_cond_wait(&pool->not_full, &pool->mutex);
+    }
+
+    pool_job_t* job = slab_alloc(&pool->jobs);
+    if (!job) {
+        pthread_mutex_unlock(&pool->mutex);
+        log_error("worker_pool.enqueue", "Impossibile allocare memoria per una richiesta");
+        return false;
+    }
+    job->request = request;
+    job->binary_len = binary_len;
+    if (binary_len > 0) memcpy(job->binary, binary, binary_len);
+    job->next = NULL;
+
+    if (stream->tail) {
+        stream->tail->next = job;
+    } else {
+        stream->head = job;
+    }
+    stream->tail = job;
+
+    pool->pending++;
+    if (pool->pending > pool->peak_pending) {
+        pool->peak_pending = pool->pending;
+    }
+
+    // Solo una connessione inattiva va rimessa in coda: se è già in coda o in esecuzione il job verrà raccolto dopo
+    if (stream->state == STREAM_IDLE) {
+        push_ready(pool, stream);
+        pthread_cond_signal(&pool->not_empty);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+    return true;
+}
+
+/**
+ * Thread worker: preleva una connessione dalla coda dei pronti, ne esegue una richiesta e la rimette
+ * in coda se ne ha altre, così che connessioni diverse si alternino sui worker.
+ */
+static void* worker_loop(void* arg) {
+    worker_pool_t* pool = (worker_pool_t*)arg;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (true) {
+        while (!pool->ready_head && !pool->stopping) {
+            pthread_cond_wait(&pool->not_empty, &pool->mutex);
+        }
+
+        pool_stream_t* stream = pool->ready_head;
+        if (!stream) break;     // Pool in chiusura e nessuna richiesta rimasta
+
+        pool->ready_head = stream->next_ready;
+        if (!pool->ready_head) pool->ready_tail = NULL;
+
+        pool_job_t* job = stream->head;
+        stream->head = job->next;
+        if (!stream->head) stream->tail = NULL;
+        stream->state = STREAM_RUNNING;
+
+        // Il job torna subito al pool: serve solo la richiesta
+        json_t* request = job->request;
+        unsigned char binary[BINARY_REQUEST_MAX];
+        size_t binary_len = job->binary_len;
+        if (binary_len > 0) memcpy(binary, job->binary, binary_len);
+        slab_free(&pool->jobs, job);
+
+        pool->pending--;
+        pthread_cond_signal(&pool->not_full);
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (!request && binary_len == 0) {
+            // Ultimo job della connessione: dopo la chiusura la struttura non va più toccata
+            pool->on_close(stream);
+
+            pthread_mutex_lock(&pool->mutex);
+            pool->processed++;
+            continue;
+        }
+
+        if (binary_len > 0) {
+            handle_binary_request(pool->server, stream->socket, (const char*)binary, binary_len);
+        } else {
+            handle_request(pool->server, stream->socket, request);
+            json_decref(request);
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->processed++;
+
+        if (stream->head) {
+            push_ready(pool, stream);
+            pthread_cond_signal(&pool->not_empty);
+        } else {
+            stream->state = STREAM_IDLE;
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+/**
+ * Avvia workers thread che eseguono le richieste accodate. La coda accetta al più queue_size richieste,
+ * oltre le quali worker_pool_submit si blocca finché un worker non libera spazio.
+ * on_close viene invocata da un worker dopo l'ultima richiesta di una connessione chiusa.
+ * Ritorna true se il pool è stato avviato, false altrimenti
+ */
+bool worker_pool_init(worker_pool_t* pool, server_t* server, size_t workers, size_t queue_size, stream_close_fn on_close) {
+    pool->server = server;
+    pool->workers = 0;
+    pool->ready_head = NULL;
+    pool->ready_tail = NULL;
+    pool->pending = 0;
+    pool->max_pending = queue_size > 0 ? queue_size : 1;
+    pool->peak_pending = 0;
+    pool->processed = 0;
+    pool->stopping = false;
+    pool->on_close = on_close;
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+    pthread_cond_init(&pool->not_full, NULL);
+    slab_init(&pool->jobs, "richieste", sizeof(pool_job_t), POOL_JOB_SLAB_CHUNK, false);
+
+    pool->threads = malloc(workers * sizeof(pthread_t));
+    if (!pool->threads) {
+        log_error("worker_pool.worker_pool_init", "Impossibile allocare memoria per i worker");
+        return false;
+    }
+
+    for (size_t i = 0; i < workers; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_loop, pool) != 0) {
+            log_error("worker_pool.worker_pool_init", "Creazione del worker %zu fallita", i);
+            worker_pool_destroy(pool);
+            return false;
+        }
+        pool->workers++;
+    }
+
+    log_info("worker_pool.worker_pool_init", "Avviati %zu worker, coda massima %zu richieste", pool->workers, pool->max_pending);
+    return true;
+}
+
+/**
+ * Accoda una richiesta della connessione. Il pool diventa proprietario del json.
+ * Ritorna true se la richiesta è stata accodata, false altrimenti
+ */
+bool worker_pool_submit(worker_pool_t* pool, pool_stream_t* stream, json_t* request) {
+    if (!request) return false;
+
+    if (!enqueue(pool, stream, request, NULL, 0)) {
+        json_decref(request);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Accoda una richiesta binaria della connessione, copiandola nel job.
+ * Ritorna true se la richiesta è stata accodata, false se è troppo lunga o in caso di errore
+ */
+bool worker_pool_submit_binary(worker_pool_t* pool, pool_stream_t* stream, const char* payload, size_t len) {
+    if (len == 0 || len > BINARY_REQUEST_MAX) {
+        log_error("worker_pool.worker_pool_submit_binary", "Richiesta binaria di %zu byte non valida", len);
+        return false;
+    }
+
+    return enqueue(pool, stream, NULL, payload, len);
+}
+
+/**
+ * Accoda la chiusura della connessione, eseguita dopo tutte le sue richieste ancora in coda
+ */
+bool worker_pool_close_stream(worker_pool_t* pool, pool_stream_t* stream) {
+    return enqueue(pool, stream, NULL, NULL, 0);
+}
+
+/**
+ * Stampa la profondità attuale e massima della coda e il numero di richieste eseguite
+ */
+void worker_pool_report(worker_pool_t* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    size_t pending = pool->pending;
+    size_t peak = pool->peak_pending;
+    size_t processed = pool->processed;
+    pool->peak_pending = pending;
+    pthread_mutex_unlock(&pool->mutex);
+
+    log_info("worker_pool.worker_pool_report", "Coda: %zu richieste in attesa (picco %zu dall'ultimo report, limite %zu), %zu eseguite, %zu worker",
+        pending, peak, pool->max_pending, processed, pool->workers);
+}
+
+/**
+ * Esegue le richieste ancora in coda, termina i worker e libera la memoria allocata dal pool
+ */
+void worker_pool_destroy(worker_pool_t* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_cond_broadcast(&pool->not_full);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (size_t i = 0; i < pool->workers; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    free(pool->threads);
+    pool->threads = NULL;
+    pool->workers = 0;
+
+    slab_destroy(&pool->jobs);
+    pthread_cond_destroy(&pool->not_full);
+    pthread_cond_destroy(&pool->not_empty);
+    pthread_mutex_destroy(&pool->mutex);
+}
@@ -0,0 +1,133 @@
+/**
+ * Generatore della tabella delle mosse del bot (vedi bot.h), eseguito durante la compilazione.
+ * Risolve tutte le posizioni del tris con una negamax memorizzata sull'indice in base 3 della board
+ * e scrive su standard output il sorgente C con le tabelle.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bot.h"
+
+/**
+ * Le otto linee vincenti sulla bitboard (bit x * 3 + y), le stesse di WIN_MASKS in game.c
+ */
+static const uint16_t WIN_MASKS[8] = {
+    0x007, 0x038, 0x1C0,
+    0x049, 0x092, 0x124,
+    0x111, 0x054
+};
+
+static int8_t scores[BOT_STATES];
+static uint8_t solved[BOT_STATES];
+static uint32_t outcomes[BOT_STATES];
+static uint8_t best[BOT_STATES];
+static uint16_t ternary[512];
+
+//============ METODI PRIVATI ==================//
+/**
+ * Verifica se la bitboard contiene una linea vincente
+ */
+static int has_line(uint16_t mask) {
+    for (size_t i = 0; i < sizeof(WIN_MASKS) / sizeof(WIN_MASKS[0]); i++) {
+        if ((mask & WIN_MASKS[i]) == WIN_MASKS[i]) return 1;
+    }
+    return 0;
+}
+
+/**
+ * Conta le celle occupate della bitboard
+ */
+static int popcount9(uint16_t mask) {
+    int count = 0;
+    for (; mask; mask &= (uint16_t)(mask - 1)) count++;
+    return count;
+}
+
+/**
+ * Valuta la posizione per il giocatore che deve muovere: positivo se vince, negativo se perde, 0 se pareggia.
+ * Il valore assoluto cresce con la velocità della vittoria (o della sconfitta subita), così che la mossa migliore
+ * vinca il prima possibile e perda il più tardi possibile. Completa outcomes e best della posizione
+ */
+static int negamax(uint16_t mine, uint16_t theirs) {
+    // X muove per primo: è al tratto quando i due giocatori hanno lo stesso numero di celle
+    bool x_to_move = popcount9(mine) == popcount9(theirs);
+    size_t state = ternary[x_to_move ? mine : theirs] + 2u * ternary[x_to_move ? theirs : mine];
+    if (solved[state]) return scores[state];
+
+    uint16_t occupied = mine | theirs;
+    int best_score = -100;
+    uint32_t cell_outcomes = 0;
+    uint8_t best_cell = 0;
+
+    if (!has_line(theirs) && occupied != 0x1FF) {
+        for (int cell = 0; cell < 9; cell++) {
+            uint16_t bit = (uint16_t)(1u << cell);
+            if (occupied & bit) continue;
+
+            uint16_t next = mine | bit;
+            int score;
+            if (has_line(next)) {
+                score = 10 - popcount9(occupied);
+            } else {
+                score = -negamax(theirs, next);
+            }
+
+            unsigned outcome = score > 0 ? BOT_OUTCOME_WIN : score < 0 ? BOT_OUTCOME_LOSS : BOT_OUTCOME_DRAW;
+            cell_outcomes |= (uint32_t)outcome << (cell * 2);
+            if (score > best_score) {
+                best_score = score;
+                best_cell = (uint8_t)cell;
+            }
+        }
+    } else {
+        best_score = 0;     // Posizione finale: nessuna mossa
+    }
+
+    solved[state] = 1;
+    scores[state] = (int8_t)best_score;
+    outcomes[state] = cell_outcomes;
+    best[state] = best_cell;
+    return best_score;
+}
+
+/**
+ * Scrive l'array di nome name con count valori
+ */
+static void print_array(const char* type, const char* name, const char* size, const uint32_t* values, size_t count) {
+    printf("const %s %s[%s] = {", type, name, size);
+    for (size_t i = 0; i < count; i++) {
+        printf(i % 12 == 0 ? "\n    %u," : " %u,", (unsigned)values[i]);
+    }
+    printf("\n};\n\n");
+}
+
+//============ INTERFACCIA PUBBLICA ==================//
+int main(void) {
+    for (uint16_t mask = 0; mask < 512; mask++) {
+        uint16_t value = 0, power = 1;
+        for (int cell = 0; cell < 9; cell++, power *= 3) {
+            if (mask & (1u << cell)) value += power;
+        }
+        ternary[mask] = value;
+    }
+
+    // Tutte le posizioni raggiungibili discendono dalla board vuota con X al tratto
+    negamax(0, 0);
+
+    static uint32_t values[BOT_STATES];
+
+    printf("// Generato da tools/bot_table_gen.c durante la compilazione: non modificare\n\n");
+    printf("#include \"bot.h\"\n\n");
+
+    for (size_t i = 0; i < 512; i++) values[i] = ternary[i];
+    print_array("uint16_t", "bot_ternary", "512", values, 512);
+
+    print_array("uint32_t", "bot_outcomes", "BOT_STATES", outcomes, BOT_STATES);
+
+    for (size_t i = 0; i < BOT_STATES; i++) values[i] = best[i];
+    print_array("uint8_t", "bot_best", "BOT_STATES", values, BOT_STATES);
+
+    return EXIT_SUCCESS;
+}